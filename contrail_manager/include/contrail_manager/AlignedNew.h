@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Gives a class (T, which must derive from AlignedNew<T>) an operator new
+// that honours its alignment, which plain new is not required to do before
+// C++17 (see contrail_spline_lib::aligned_allocator)
+//
+// Anything holding a ContrailManager is over-aligned (by its trajectories),
+// so must use this if it is ever created with new (e.g. in a nodelet).
+template<typename T>
+class AlignedNew {
+	public:
+		static void* operator new( const std::size_t size ) {
+			void* p = NULL;
+
+			if( posix_memalign(&p, alignof(T), size) )
+				throw std::bad_alloc();
+
+			return p;
+		}
+
+		static void operator delete( void* p ) {
+			free(p);
+		}
+};
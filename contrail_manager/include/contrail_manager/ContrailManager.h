@@ -12,6 +12,17 @@
 #include <contrail_manager/TrajectoryAction.h>
 #include <contrail_manager/ManagerParamsConfig.h>
 #include <contrail_spline_lib/interpolated_quintic_spline.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/packed_quintic_cursor.h>
+#include <contrail_spline_lib/trajectory_limits.h>
+#include <contrail_spline_lib/arc_length_table.h>
+#include <contrail_spline_lib/closest_point_tree.h>
+#include <contrail_spline_lib/trajectory_geofence.h>
+#include <contrail_spline_lib/trajectory_sampling.h>
+
+#include <contrail_manager/TripleBuffer.h>
+#include <contrail_manager/SpscQueue.h>
+#include <contrail_manager/WorkerPool.h>
 
 #include <actionlib/server/simple_action_server.h>
 
@@ -21,10 +32,87 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <stdint.h>
 #include <math.h>
 
 class ContrailManager {
 	private:
+		//Storage precision of the packed trajectory (see CONTRAIL_MANAGER_SINGLE_PRECISION
+		//in CMakeLists.txt), the splines are always solved in double precision
+#ifdef CONTRAIL_MANAGER_SINGLE_PRECISION
+		typedef float trajectory_scalar_t;
+#else
+		typedef double trajectory_scalar_t;
+#endif
+
+		//Settings from dynamic reconfigure (and the frame ID)
+		typedef struct params_s {
+			std::string frame_id;
+			int spline_approx_res;	//Most points per second in the approximation (0 for no limit)
+			double spline_approx_tolerance;
+			double spline_approx_max_angle;
+			double end_position_accuracy;
+			double end_yaw_accuracy;
+			bool ref_position;
+			bool ref_velocity;
+			bool ref_acceleration;
+			contrail_spline_lib::kinematic_peaks_t limits;	//Kinematic limits for goals (0 to disable)
+			bool rescale_to_limits;
+			bool follow_path;
+			double follow_path_lookahead;	//Furthest the reference may lead the vehicle along the path (trajectory seconds)
+			double stitch_lead;	//How far ahead of the reference goals are joined on (seconds)
+			bool match_state;	//Start new goals from the current reference state
+			double feedback_rate;	//Rate of the action feedback (Hz, 0 for every control step)
+
+			params_s( void );
+		} params_t;
+
+		//Everything the control loop needs to track a goal. Snapshots are
+		//built by the goal callback, and never modified once published
+		class TrajectorySnapshot {
+			public:
+				uint32_t generation;	//Counts up from 1 for each published goal
+				uint32_t continues;		//Generation this snapshot carries on from (0 for a fresh start)
+				ros::Time start;
+				ros::Duration duration;
+				bool constant_speed;
+				double speed;	//Speed along the path (constant speed tracking only)
+				bool follow_path;
+				Eigen::Vector3d pos_start;
+				Eigen::Vector3d pos_end;
+				double rot_start;
+				double rot_end;
+
+				contrail_spline_lib::BasicPackedQuinticTrajectory<trajectory_scalar_t> trajectory;
+				contrail_spline_lib::ArcLengthTable arc_length;	//Used for constant speed tracking
+				contrail_spline_lib::ClosestPointTree closest;	//Used for path following
+
+				explicit TrajectorySnapshot( const size_t capacity );
+		};
+
+		//Result of a goal that has reached its end, to be sent by the publisher
+		typedef struct {
+			uint32_t generation;	//Goal the result is for
+			contrail_manager::TrajectoryResult result;
+		} goal_result_t;
+
+		//A copy of a goal for the visualisation worker, which may still be
+		//sampling it long after the snapshot has been replaced
+		class VisualisationJob {
+			public:
+				ros::Time stamp;
+				ros::Time start;
+				std::string frame_id;
+				contrail_spline_lib::sampling_tolerance_t tolerance;
+				contrail_spline_lib::BasicPackedQuinticTrajectory<trajectory_scalar_t> trajectory;
+
+				explicit VisualisationJob( const size_t capacity );
+		};
+
 		ros::NodeHandle nhp_;
 
 		ros::Publisher pub_is_ready_;		//Publishes feedback from the parent node to show when we will accept inputs
@@ -33,42 +121,106 @@ class ContrailManager {
 
 		dynamic_reconfigure::Server<contrail_manager::ManagerParamsConfig> dyncfg_settings_;
 
-		std::string param_frame_id_;
-		int param_spline_approx_res_;
-		double param_end_position_accuracy_;
-		double param_end_yaw_accuracy_;
-		bool param_ref_position_;
-		bool param_ref_velocity_;
-		bool param_ref_acceleration_;
+		int param_max_vias_;	//Fixed capacity for goals (0 to grow as needed)
+		contrail_spline_lib::geofence_t param_geofence_;	//Bounds that goals must stay within (fixed at startup)
 
-		ros::Time spline_start_;
-		ros::Duration spline_duration_;
-		bool spline_in_progress_;
-		bool is_ready_;
-		bool wait_reached_end_;
-		Eigen::Vector3d spline_pos_start_;
-		Eigen::Vector3d spline_pos_end_;
-		double spline_rot_start_;
-		double spline_rot_end_;
+		//The settings are changed under the mutex, and handed to the control
+		//loop as a whole, so it never sees a half-applied reconfigure
+		std::mutex params_mutex_;
+		params_t params_;
+		TripleBuffer<params_t> params_snapshot_;
+
+		std::atomic<bool> is_ready_;
 
+		//Goal handling (actionlib callbacks)
+		//------------------------------------
+		//Scratch buffers for building the splines, reused between goals
+		std::vector<double> vias_x_;
+		std::vector<double> vias_y_;
+		std::vector<double> vias_z_;
+		std::vector<double> vias_r_;
+
+		//Per-axis splines, only used to build the packed trajectory
 		contrail_spline_lib::InterpolatedQuinticSpline spline_x_;
 		contrail_spline_lib::InterpolatedQuinticSpline spline_y_;
 		contrail_spline_lib::InterpolatedQuinticSpline spline_z_;
 		contrail_spline_lib::InterpolatedQuinticSpline spline_r_;
 
+		//Scratch knots and trajectory for joining appended goals on
+		std::vector<double> knots_p_;
+		std::vector<double> knots_r_;
+		contrail_spline_lib::BasicPackedQuinticTrajectory<trajectory_scalar_t> stitch_tail_;
+
+		TripleBuffer<TrajectorySnapshot> snapshot_;
+		std::atomic<uint32_t> published_generation_;
+		std::atomic<uint32_t> preempt_generation_;	//Goals up to this one stop, and hold their last reference
+		std::atomic<uint32_t> clear_generation_;	//Goals up to this one are dropped entirely
+
+		//Tracking (control loop)
+		//------------------------------------
+		uint32_t tracking_generation_;	//Generation of the snapshot being tracked (0 if none)
+		ros::Time spline_start_;	//Start of the snapshot, plus any time held back by path following
+		ros::Time tracking_start_;	//Start of the snapshot being tracked
+		std::atomic<double> tracking_delay_;	//spline_start_ - tracking_start_ (seconds), read by the goal callback
+		bool spline_in_progress_;
+		bool wait_reached_end_;
+		double follow_progress_;	//Trajectory time of the closest point to the vehicle (path following only)
+		ros::Time follow_last_tc_;
+
+		contrail_spline_lib::BasicPackedQuinticCursor<trajectory_scalar_t> trajectory_cursor_;	//Used for the (monotonic) control loop lookups
+
 		Eigen::Vector3d output_pos_last_;
 		double output_rot_last_;
 
+		ros::Time feedback_last_;	//Time of the last feedback queued
+
+		//Shared threads to use instead of our own (NULL if not shared)
+		WorkerPool* workers_;
+
+		//Feedback (publisher thread)
+		//------------------------------------
+		//The control loop only queues the feedback (and results), so it
+		//never serialises or sends them (or waits on the action server lock)
+		SpscQueue<contrail_manager::TrajectoryFeedback> feedback_queue_;
+		SpscQueue<goal_result_t> result_queue_;
+		std::atomic<bool> feedback_running_;
+		std::thread feedback_thread_;
+
+		//Visualisation (worker thread)
+		//------------------------------------
+		//The approximation is sampled and published by the worker, so goals
+		//are accepted without waiting on it
+		TripleBuffer<VisualisationJob> visual_jobs_;
+		std::mutex visual_mutex_;
+		std::condition_variable visual_cv_;
+		bool visual_pending_;	//A job has been published (under the mutex)
+		bool visual_running_;	//Under the mutex
+		bool visual_posted_;	//A job is queued or running on the shared workers (under the mutex)
+		std::thread visual_thread_;
+
+		std::vector<double> visual_times_;
+		std::vector<contrail_spline_lib::packed_quintic_point_t> visual_points_;
+
 		actionlib::SimpleActionServer<contrail_manager::TrajectoryAction> as_;
 
 	public:
 		ContrailManager( const ros::NodeHandle &nh, std::string frame_id = "map", const bool is_ready = false );
+		//Uses shared workers instead of starting threads of its own. The
+		//visualisation is sampled on the workers, and the feedback is left
+		//for the owner to send with publish_feedback(). The workers must be
+		//stopped before the manager is destroyed (see WorkerPool)
+		ContrailManager( const ros::NodeHandle &nh, WorkerPool& workers, std::string frame_id = "map", const bool is_ready = false );
 
 		~ContrailManager( void );
 
 		void set_frame_id( std::string frame_id );
 
+		//The tracking interface (has_reference(), get_reference(), and
+		//check_end_reached()) must only be used from the control loop,
+		//and never waits on the goal or reconfigure callbacks. New goals
+		//and settings are picked up at the next call
 		bool has_reference( const ros::Time t );
+		//May be used from any thread
 		void clear_reference( void );
 
 		//Parent node/library should must indicate to contrail that it is ready to go
@@ -99,27 +251,100 @@ class ContrailManager {
 		void check_end_reached( const geometry_msgs::Pose &p_c );
 		void check_end_reached( const Eigen::Affine3d &g_c );
 
+		//Sends any feedback and results queued by the control loop (only
+		//needed when using shared workers), must not be called from more
+		//than one thread at a time
+		void publish_feedback( void );
+
 	private:
+		//Common to both of the above (workers may be NULL)
+		ContrailManager( const ros::NodeHandle &nh, WorkerPool* workers, std::string frame_id, const bool is_ready );
+
 		//ROS callbacks
 		void callback_cfg_settings( contrail_manager::ManagerParamsConfig &config, uint32_t level );
 		void callback_actionlib_goal(void);
 		void callback_actionlib_preempt(void);
 
-		void set_action_goal();
+		//Publishes the queued feedback and results until the manager is destroyed
+		void run_feedback( void );
+		//Samples and publishes each visualisation job until the manager is destroyed
+		void run_visualisation( void );
+		//As above, but on the shared workers, returning once there are no more jobs
+		void run_visualisation_posted( void );
+		//Samples and publishes the latest visualisation job
+		void draw_visualisation( void );
+		//Queues feedback for the publisher thread, decimated to the feedback rate
+		void queue_feedback( const params_t& params, const ros::Time tc, const contrail_manager::TrajectoryFeedback& feedback );
 
-		void get_spline_reference(contrail_spline_lib::InterpolatedQuinticSpline& spline, double& pos, double& vel, double& acc, const double u);
+		void set_action_goal();
+		//Flies a binary trajectory file (see PackedQuinticTrajectory::load())
+		//Returns false if the goal must be rejected
+		bool set_trajectory_file_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params );
+		//Joins an appended goal onto the end of the current trajectory, from
+		//just ahead of the reference, so the join is continuous up to the
+		//acceleration. Returns false if it can't be joined on (the goal is
+		//then started as normal)
+		bool stitch_action_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params, const ros::Time tc );
+		//Starts a goal from the current reference state, with its first
+		//position/yaw replaced by the state just ahead of the reference (the
+		//vias must already be filled). Returns false if there is no goal
+		//in progress to start from (the goal is then started as normal)
+		bool match_action_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params, const ros::Time tc,
+								const contrail_spline_lib::interpolation_mode_t mode, const double* knots_p, const double* knots_r );
+		//Checks the current goal is still being flown on spline timing (and
+		//the new goal will be too), so a new trajectory can be joined onto it
+		bool can_join( const TrajectorySnapshot& current, const contrail_manager::TrajectoryGoal& goal );
+		//Solves the scratch vias into a trajectory starting from p_join
+		//(over d_tail seconds), and joins it onto the current trajectory at
+		//t_join, keeping its segments from "first" onward
+		bool join_trajectory( const TrajectorySnapshot& current, const size_t first, const double t_join,
+							  const contrail_spline_lib::packed_quintic_point_t& p_join, const double d_tail,
+							  const contrail_spline_lib::interpolation_mode_t mode, const double* knots_p, const double* knots_r );
+		//Finishes building a snapshot for a newly packed or loaded trajectory
+		void prepare_tracking( TrajectorySnapshot& snapshot, const bool constant_speed, const params_t& params );
+		//Hands a finished snapshot over to the control loop
+		const TrajectorySnapshot& publish_snapshot( void );
+		//Checks there is one time per position, and they are strictly increasing
+		bool valid_knot_times( const std::vector<double>& times, const size_t num_positions );
+
+		//Checks the packed trajectory against the kinematic limits, stretching
+		//its duration to fit if enabled. Returns false if the goal must be rejected
+		bool check_trajectory_limits( TrajectorySnapshot& snapshot, const params_t& params );
+		//Checks the path of the packed trajectory against the geofence
+		//Returns false if the goal must be rejected
+		bool check_trajectory_geofence( const TrajectorySnapshot& snapshot );
+		//Loads the geofence from the "geofence/..." parameters
+		void load_geofence( void );
+		//Copy of the current settings (for use outside of the control loop)
+		params_t get_params( void );
+
+		//Picks up any new snapshot, preempt, or clear (control loop only)
+		void update_tracking( void );
+
+		contrail_spline_lib::packed_quintic_point_t get_trajectory_reference( const TrajectorySnapshot& snapshot, const double t );
+		//Reference at a constant speed along the path, with the derivatives
+		//rescaled to match (time is still in seconds since the start)
+		contrail_spline_lib::packed_quintic_point_t get_constant_speed_reference( const TrajectorySnapshot& snapshot, const double t );
+		//Holds the trajectory clock while the reference leads the closest
+		//point on the path to the vehicle by more than the lookahead
+		void follow_path( const TrajectorySnapshot& snapshot, const params_t& params, const ros::Time tc, const Eigen::Vector3d& pos_c );
 
 		inline double normalize(double x, const double min, const double max) const {
 			return (x - min) / (max - min);
 		}
 
-		std::vector<double> make_yaw_continuous( const std::vector<double>& yaw );
+		void make_yaw_continuous( const std::vector<double>& yaw, std::vector<double>& cont_yaw );
 
-		void publish_approx_spline( const ros::Time& stamp );
-		void publish_spline_points( const ros::Time& stamp, const std::vector<geometry_msgs::Vector3>& pos, const std::vector<double>& yaw );
+		//Hands the trajectory over to the visualisation worker
+		void publish_approx_spline( const ros::Time& stamp, const TrajectorySnapshot& snapshot, const params_t& params );
+		void publish_spline_points( const ros::Time& stamp, const TrajectorySnapshot& snapshot, const params_t& params,
+									const std::vector<geometry_msgs::Vector3>& pos, const std::vector<double>& yaw );
+		//Publishes the trajectory at its knots (for goals without positions)
+		void publish_trajectory_knots( const ros::Time& stamp, const TrajectorySnapshot& snapshot, const params_t& params );
 
 		//Returns true of the tracking point has been reached
-		bool check_endpoint_reached( const Eigen::Vector3d& pos_s,
+		bool check_endpoint_reached( const params_t& params,
+									 const Eigen::Vector3d& pos_s,
 									 const double yaw_s,
 									 const Eigen::Vector3d& pos_c,
 									 const double yaw_c );
@@ -3,12 +3,13 @@
 #include <ros/ros.h>
 
 #include <contrail_manager/ContrailManager.h>
+#include <contrail_manager/AlignedNew.h>
 
 #include <nav_msgs/Odometry.h>
 
 #include <eigen3/Eigen/Dense>
 
-class Guidance {
+class Guidance : public AlignedNew<Guidance> {
 	private:
 		ros::NodeHandle nh_;
 		ros::NodeHandle nhp_;
@@ -31,6 +32,9 @@ class Guidance {
 
 	public:
 		Guidance( void );
+		//Uses the given node handles in place of the global and private
+		//namespaces of the node (e.g. those of a nodelet)
+		Guidance( const ros::NodeHandle& nh, const ros::NodeHandle& nhp );
 		~Guidance( void );
 
 	private:
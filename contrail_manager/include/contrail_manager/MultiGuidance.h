@@ -0,0 +1,100 @@
+#pragma once
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include <contrail_manager/ContrailManager.h>
+#include <contrail_manager/TripleBuffer.h>
+#include <contrail_manager/WorkerPool.h>
+#include <contrail_manager/AlignedNew.h>
+
+#include <nav_msgs/Odometry.h>
+#include <mavros_msgs/PositionTarget.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+
+#include <eigen3/Eigen/Dense>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+// Runs the guidance of many vehicles in one process, each with the same
+// interface as a contrail_guidance_node (in the vehicle's namespace)
+//
+// All of the vehicles are tracked in a single control step, on a thread of
+// its own (which also takes the odometry), so they all get their references
+// for the same time. The step is a plain loop over the vehicles (each one
+// is evaluated on its own), which never waits on any of their goals being
+// solved, as the results are sent by the workers. Everything else (the
+// goals and reconfigures of every vehicle, and the publishing of their
+// outputs, feedback, and visualisation) runs on one shared pool of workers.
+class MultiGuidance {
+	private:
+		class Vehicle : public AlignedNew<Vehicle> {
+			public:
+				std::string name;
+
+				ros::Publisher pub_output_triplet;
+				ros::Publisher pub_output_position;
+				ros::Publisher pub_output_velocity;
+
+				ros::Subscriber sub_state_odometry;
+
+				//Only used by the control thread
+				Eigen::Affine3d current_g;
+				ros::Time odom_stamp;
+
+				ContrailManager ref_path;
+
+				//The goals are served by the workers, and the odometry by the control thread
+				Vehicle( const std::string& vehicle_name, const ros::NodeHandle& nh, WorkerPool& workers, ros::CallbackQueue& control_queue );
+
+				void callback_odom( const nav_msgs::Odometry::ConstPtr& msg_in );
+		};
+
+		//Output of one vehicle for a control step
+		typedef struct {
+			bool has_output;
+			mavros_msgs::PositionTarget triplet;
+			geometry_msgs::PoseStamped pose;
+			geometry_msgs::TwistStamped twist;
+		} vehicle_output_t;
+
+		ros::NodeHandle nh_;
+		ros::NodeHandle nhp_;
+
+		double param_rate_;
+		bool param_do_feedback_;
+		std::vector<std::string> param_vehicles_;	//Namespaces of the vehicles
+
+		//Must be stopped before the vehicles are destroyed
+		WorkerPool workers_;
+
+		ros::CallbackQueue control_queue_;
+		ros::AsyncSpinner control_spinner_;
+		ros::Timer timer_;
+
+		std::vector<std::unique_ptr<Vehicle>> vehicles_;
+
+		//The outputs of each control step are handed to the workers to be
+		//published, so the control thread never serialises or sends them
+		TripleBuffer<std::vector<vehicle_output_t>> outputs_;
+		std::atomic<bool> outputs_posted_;
+		std::mutex outputs_mutex_;	//Held by the worker reading the outputs
+
+	public:
+		MultiGuidance( void );
+		~MultiGuidance( void );
+
+	private:
+		void callback_timer( const ros::TimerEvent& e );
+
+		//Publishes the latest outputs, and any queued feedback (on the workers)
+		void publish_outputs( void );
+
+		//Fills in the pose and twist to show the reference of a vehicle
+		void make_feedback( const Vehicle& vehicle, vehicle_output_t& output );
+};
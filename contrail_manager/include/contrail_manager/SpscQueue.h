@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+// Fixed-capacity queue from one producer thread to one consumer thread,
+// without either of them ever waiting on the other
+//
+// The producer only writes the tail, and the consumer only writes the
+// head, so each side is a single atomic store per item. The storage is
+// allocated up front, and push() drops the item rather than waiting (or
+// allocating) if the queue is full.
+template<typename T>
+class SpscQueue {
+	private:
+		std::vector<T> items_;
+		const size_t mask_;
+
+		std::atomic<size_t> head_;	//Next item to pop (only written by the consumer)
+		std::atomic<size_t> tail_;	//Next slot to push (only written by the producer)
+
+		static size_t round_up_pow2( const size_t n ) {
+			size_t p = 1;
+			while( p < n )
+				p <<= 1;
+
+			return p;
+		}
+
+	public:
+		//The capacity is rounded up to a power of 2
+		explicit SpscQueue( const size_t capacity ) :
+			items_( round_up_pow2(capacity) ),
+			mask_( items_.size() - 1 ),
+			head_(0),
+			tail_(0) {
+		}
+
+		//Producer: returns false (dropping the item) if the queue is full
+		inline bool push( const T& item ) {
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+
+			if( ( tail - head_.load(std::memory_order_acquire) ) > mask_ )
+				return false;
+
+			items_[tail & mask_] = item;
+			tail_.store(tail + 1, std::memory_order_release);
+
+			return true;
+		};
+
+		//Consumer: returns false if the queue is empty
+		inline bool pop( T& item ) {
+			const size_t head = head_.load(std::memory_order_relaxed);
+
+			if( head == tail_.load(std::memory_order_acquire) )
+				return false;
+
+			item = items_[head & mask_];
+			head_.store(head + 1, std::memory_order_release);
+
+			return true;
+		};
+};
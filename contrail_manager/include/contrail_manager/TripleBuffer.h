@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Hands whole objects from one writer thread to one reader thread, without
+// either of them ever waiting on the other
+//
+// There are 3 slots: the writer fills its "back" slot and publishes it by
+// swapping it with the "middle" slot, and the reader picks up the latest
+// published slot by swapping its "front" slot with the middle one. Each
+// swap is a single atomic exchange, so neither side can block, and a slot
+// is only ever written by the writer while neither side can see it.
+//
+// The writer is handed back an older slot after each publish, so it must
+// fill in the whole object (nothing carries over from the last publish).
+// Published objects stay valid (and unchanged) for the writer to read
+// until its next publish.
+//
+// All slots are constructed up front with the same arguments, so objects
+// with fixed-capacity storage never allocate while being handed over.
+template<typename T>
+class TripleBuffer {
+	private:
+		static const uint8_t index_mask_ = 0x03;
+		static const uint8_t fresh_flag_ = 0x04;	//Set on the middle slot when it holds an unread publish
+
+		T slot_a_;
+		T slot_b_;
+		T slot_c_;
+		T* const slots_[3];
+
+		uint8_t back_;		//Only used by the writer
+		uint8_t published_;	//Only used by the writer
+		uint8_t front_;		//Only used by the reader
+		std::atomic<uint8_t> middle_;
+
+	public:
+		template<typename... Args>
+		explicit TripleBuffer( const Args&... args ) :
+			slot_a_(args...),
+			slot_b_(args...),
+			slot_c_(args...),
+			slots_{&slot_a_, &slot_b_, &slot_c_},
+			back_(0),
+			published_(2),
+			front_(1),
+			middle_(2) {
+		}
+
+		//Writer: the slot to fill in before the next publish()
+		inline T& back( void ) { return *slots_[back_]; };
+
+		//Writer: makes the back slot the latest object for the reader,
+		//returning the (just published) object
+		inline const T& publish( void ) {
+			published_ = back_;
+			back_ = middle_.exchange( published_ | fresh_flag_, std::memory_order_acq_rel ) & index_mask_;
+
+			return *slots_[published_];
+		};
+
+		//Writer: the last published object (as constructed if there hasn't
+		//been a publish yet), e.g. to build the next one from
+		inline const T& published( void ) const { return *slots_[published_]; };
+
+		//Reader: picks up the latest published object (if there is a new
+		//one), returning true if front() has changed
+		inline bool update( void ) {
+			if( !( middle_.load(std::memory_order_acquire) & fresh_flag_ ) )
+				return false;
+
+			front_ = middle_.exchange( front_, std::memory_order_acq_rel ) & index_mask_;
+
+			return true;
+		};
+
+		//Reader: the latest object picked up by update()
+		inline const T& front( void ) const { return *slots_[front_]; };
+};
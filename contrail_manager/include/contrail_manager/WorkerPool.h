@@ -0,0 +1,40 @@
+#pragma once
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include <boost/function.hpp>
+
+#include <stdint.h>
+
+// A fixed set of threads that can be shared between many managers (e.g.
+// every vehicle of the multi-vehicle guidance node), so the number of
+// threads doesn't grow with the number of managers
+//
+// The threads serve a single ROS callback queue. Node handles that are
+// given the queue (see queue()) have their callbacks (goals, reconfigures,
+// etc.) run by the pool, and post() runs one-off jobs on it as well.
+//
+// Jobs refer to the objects that posted them, so the pool must be stopped
+// before any of those objects are destroyed. Anything still queued when
+// the pool is stopped is dropped, and nothing more is accepted.
+class WorkerPool {
+	private:
+		ros::CallbackQueue queue_;
+		ros::AsyncSpinner spinner_;
+
+		bool is_running_;
+
+	public:
+		explicit WorkerPool( const uint32_t num_threads );
+		~WorkerPool( void );
+
+		//Queue for node handles to be served by the pool
+		inline ros::CallbackQueue* queue( void ) { return &queue_; };
+
+		//Runs a job on one of the threads (may be used from any thread)
+		void post( const boost::function<void(void)>& job );
+
+		//Waits for any running jobs, then stops the threads
+		void stop( void );
+};
@@ -0,0 +1,65 @@
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <contrail_msgs/WaypointList.h>
+#include <nav_msgs/Path.h>
+#include <geometry_msgs/PoseStamped.h>
+
+#include <boost/make_shared.hpp>
+
+#include <math.h>
+
+namespace contrail_manager {
+
+// Converts a contrail_msgs/WaypointList to a nav_msgs/Path, as for the
+// converter_waypoints_path script, with the messages passed as pointers
+// within a nodelet manager
+class WaypointsPathConverterNodelet : public nodelet::Nodelet {
+	private:
+		ros::Subscriber sub_waypoints_;
+		ros::Publisher pub_path_;
+
+		virtual void onInit( void ) {
+			ros::NodeHandle& nhp = getPrivateNodeHandle();
+
+			sub_waypoints_ = nhp.subscribe<contrail_msgs::WaypointList>( "waypoints", 10, &WaypointsPathConverterNodelet::callback_waypoints, this );
+			pub_path_ = nhp.advertise<nav_msgs::Path>( "path", 10, true );
+
+			NODELET_INFO("Waypoint-Path converter running");
+		}
+
+		void callback_waypoints( const contrail_msgs::WaypointList::ConstPtr& msg_in ) {
+			//Make sure it is a valid waypoint message
+			if( msg_in->header.stamp.isZero() || msg_in->waypoints.empty() )
+				return;
+
+			NODELET_INFO("Converting %lu waypoints to path", msg_in->waypoints.size());
+
+			nav_msgs::Path::Ptr msg_out = boost::make_shared<nav_msgs::Path>();
+			msg_out->header = msg_in->header;
+
+			msg_out->poses.resize( msg_in->waypoints.size() );
+			for(size_t i=0; i<msg_in->waypoints.size(); i++) {
+				geometry_msgs::PoseStamped& p = msg_out->poses[i];
+				const double r = 0.5*msg_in->waypoints[i].yaw;
+
+				p.header = msg_in->header;
+				p.header.seq = i;
+				p.pose.position = msg_in->waypoints[i].position;
+
+				//A rotation about z only, so the quaternion is direct from the yaw
+				p.pose.orientation.w = cos(r);
+				p.pose.orientation.x = 0.0;
+				p.pose.orientation.y = 0.0;
+				p.pose.orientation.z = sin(r);
+			}
+
+			//Never modified after, so subscribers in the same nodelet manager can share it
+			pub_path_.publish(msg_out);
+		}
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(contrail_manager::WaypointsPathConverterNodelet, nodelet::Nodelet)
@@ -9,9 +9,15 @@
 
 #include <eigen3/Eigen/Dense>
 
+#include <boost/make_shared.hpp>
+
 Guidance::Guidance( void ) :
-	nh_(),
-	nhp_("~"),
+	Guidance( ros::NodeHandle(), ros::NodeHandle("~") ) {
+}
+
+Guidance::Guidance( const ros::NodeHandle& nh, const ros::NodeHandle& nhp ) :
+	nh_(nh),
+	nhp_(nhp),
 	ref_path_(nhp_),
 	param_do_feedback_(false),
 	odom_stamp_(0),
@@ -56,32 +62,34 @@ void Guidance::callback_timer( const ros::TimerEvent& e ) {
 
 		ROS_INFO_ONCE("Guidance outputting command!");
 
-		mavros_msgs::PositionTarget traj;
-		ref_path_.get_reference(traj, e.current_real, current_g_);
+		//Published as shared pointers (and never modified after), so
+		//subscribers in the same nodelet manager get them without a copy
+		mavros_msgs::PositionTarget::Ptr traj = boost::make_shared<mavros_msgs::PositionTarget>();
+		ref_path_.get_reference(*traj, e.current_real, current_g_);
 
 		pub_output_triplet_.publish(traj);
 
 		if(param_do_feedback_) {
-			geometry_msgs::PoseStamped p;
-			geometry_msgs::TwistStamped t;
-
-			p.header = traj.header;
-			t.header = traj.header;
-
-			p.pose.position = traj.position;
-			Eigen::Quaterniond q(Eigen::AngleAxisd(traj.yaw, Eigen::Vector3d::UnitZ()));
-			p.pose.orientation.w = q.w();
-			p.pose.orientation.x = q.x();
-			p.pose.orientation.y = q.y();
-			p.pose.orientation.z = q.z();
-
-			Eigen::Vector3d bv = current_g_.linear().inverse()*Eigen::Vector3d(traj.velocity.x, traj.velocity.y, traj.velocity.z);
-			t.twist.linear.x = bv.x();
-			t.twist.linear.y = bv.y();
-			t.twist.linear.z = bv.z();
-			t.twist.angular.x = 0.0;
-			t.twist.angular.y = 0.0;
-			t.twist.angular.z = traj.yaw_rate;
+			geometry_msgs::PoseStamped::Ptr p = boost::make_shared<geometry_msgs::PoseStamped>();
+			geometry_msgs::TwistStamped::Ptr t = boost::make_shared<geometry_msgs::TwistStamped>();
+
+			p->header = traj->header;
+			t->header = traj->header;
+
+			p->pose.position = traj->position;
+			Eigen::Quaterniond q(Eigen::AngleAxisd(traj->yaw, Eigen::Vector3d::UnitZ()));
+			p->pose.orientation.w = q.w();
+			p->pose.orientation.x = q.x();
+			p->pose.orientation.y = q.y();
+			p->pose.orientation.z = q.z();
+
+			Eigen::Vector3d bv = current_g_.linear().inverse()*Eigen::Vector3d(traj->velocity.x, traj->velocity.y, traj->velocity.z);
+			t->twist.linear.x = bv.x();
+			t->twist.linear.y = bv.y();
+			t->twist.linear.z = bv.z();
+			t->twist.angular.x = 0.0;
+			t->twist.angular.y = 0.0;
+			t->twist.angular.z = traj->yaw_rate;
 
 			pub_output_position_.publish(p);
 			pub_output_velocity_.publish(t);
@@ -0,0 +1,29 @@
+#include <ros/ros.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <contrail_manager/Guidance.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace contrail_manager {
+
+// Guidance as a nodelet, with the same interface as the contrail_guidance_node
+//
+// Loaded into the same nodelet manager as the estimator and the autopilot
+// bridge, the odometry and commands are passed as pointers, rather than
+// being serialised and sent over loopback each control step.
+class GuidanceNodelet : public nodelet::Nodelet {
+	private:
+		boost::shared_ptr<Guidance> guidance_;
+
+		virtual void onInit( void ) {
+			//Callbacks are kept to one thread (as for the node), so the
+			//odometry and the control steps never overlap
+			guidance_.reset( new Guidance( getNodeHandle(), getPrivateNodeHandle() ) );
+		}
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(contrail_manager::GuidanceNodelet, nodelet::Nodelet)
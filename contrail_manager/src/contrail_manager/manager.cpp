@@ -14,35 +14,167 @@
 #include <contrail_manager/ManagerParamsConfig.h>
 #include <contrail_spline_lib/quintic_spline_types.h>
 #include <contrail_spline_lib/interpolated_quintic_spline.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/packed_quintic_cursor.h>
+#include <contrail_spline_lib/trajectory_limits.h>
+#include <contrail_spline_lib/arc_length_table.h>
+
+#include <contrail_manager/TripleBuffer.h>
 
 #include <mavros_msgs/PositionTarget.h>
 
 #include <eigen3/Eigen/Dense>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
 #include <math.h>
 
+//Feedback held for the publisher thread (several control steps' worth),
+//and how often it checks for more
+static const size_t feedback_queue_size = 64;
+static const size_t result_queue_size = 4;
+static const std::chrono::milliseconds feedback_poll_period(5);
+
+//Speed floor (relative to the average path speed) that constant speed
+//tracking measures the path with, so time passes at a bounded rate
+//where the path stops
+static const double constant_speed_min_path_speed = 0.1;
+
+//A trajectory has a segment between every knot of its positions and of its
+//yaws, so can need almost twice as many segments as vias
+static size_t max_segments( const int max_vias ) {
+	return 2*(size_t)max_vias;
+}
+
+
+//Raises a generation to (at least) value, the clears may come from any thread
+static void raise_generation( std::atomic<uint32_t>& generation, const uint32_t value ) {
+	uint32_t current = generation.load();
+
+	while( ( current < value ) && !generation.compare_exchange_weak(current, value) );
+}
 
 //=======================
 // Public
 //=======================
 
+ContrailManager::params_s::params_s( void ) :
+	frame_id("map"),
+	spline_approx_res(0),
+	spline_approx_tolerance(0.0),
+	spline_approx_max_angle(0.0),
+	end_position_accuracy(0.0),
+	end_yaw_accuracy(0.0),
+	ref_position(false),
+	ref_velocity(false),
+	ref_acceleration(false),
+	rescale_to_limits(false),
+	follow_path(false),
+	follow_path_lookahead(0.0),
+	stitch_lead(0.0),
+	match_state(false),
+	feedback_rate(0.0) {
+
+	limits.velocity = 0.0;
+	limits.acceleration = 0.0;
+	limits.yaw_rate = 0.0;
+}
+
+ContrailManager::TrajectorySnapshot::TrajectorySnapshot( const size_t capacity ) :
+	generation(0),
+	continues(0),
+	start(0),
+	duration(0),
+	constant_speed(false),
+	speed(0.0),
+	follow_path(false),
+	pos_start(Eigen::Vector3d::Zero()),
+	pos_end(Eigen::Vector3d::Zero()),
+	rot_start(0.0),
+	rot_end(0.0),
+	trajectory(capacity),
+	arc_length(capacity),
+	closest(capacity) {
+
+#ifdef CONTRAIL_MANAGER_SINGLE_PRECISION
+	//Keep float positions accurate far from the origin of the frame
+	trajectory.set_rebasing(true);
+#endif
+}
+
+ContrailManager::VisualisationJob::VisualisationJob( const size_t capacity ) :
+	stamp(0),
+	start(0),
+	trajectory(capacity) {
+
+	tolerance.tolerance = 0.0;
+	tolerance.max_angle = 0.0;
+	tolerance.min_dt = 0.0;
+}
+
 ContrailManager::ContrailManager( const ros::NodeHandle &nh, std::string frame_id, const bool is_ready ) :
+	ContrailManager( nh, NULL, frame_id, is_ready ) {
+}
+
+ContrailManager::ContrailManager( const ros::NodeHandle &nh, WorkerPool& workers, std::string frame_id, const bool is_ready ) :
+	ContrailManager( nh, &workers, frame_id, is_ready ) {
+}
+
+ContrailManager::ContrailManager( const ros::NodeHandle &nh, WorkerPool* workers, std::string frame_id, const bool is_ready ) :
 	nhp_( nh, "contrail" ),
-	param_frame_id_(frame_id),
-	param_spline_approx_res_(0),
-	param_end_position_accuracy_(0.0),
-	param_end_yaw_accuracy_(0.0),
-	param_ref_position_(false),
-	param_ref_velocity_(false),
-	param_ref_acceleration_(false),
+	dyncfg_settings_( nhp_ ),
+	param_max_vias_( std::max( nhp_.param<int>( "max_vias", 0 ), 0 ) ),
 	is_ready_(is_ready),
+	spline_x_( param_max_vias_ ),
+	spline_y_( param_max_vias_ ),
+	spline_z_( param_max_vias_ ),
+	spline_r_( param_max_vias_ ),
+	stitch_tail_( max_segments(param_max_vias_) ),
+	snapshot_( max_segments(param_max_vias_) ),
+	published_generation_(0),
+	preempt_generation_(0),
+	clear_generation_(0),
+	tracking_generation_(0),
 	spline_start_(0),
-	spline_duration_(0),
+	tracking_start_(0),
+	tracking_delay_(0.0),
 	spline_in_progress_(false),
 	wait_reached_end_(false),
-	as_(nh, "contrail", false),
-	dyncfg_settings_( nhp_ ) {
+	follow_progress_(0.0),
+	follow_last_tc_(0),
+	output_pos_last_(Eigen::Vector3d::Zero()),
+	output_rot_last_(0.0),
+	feedback_last_(0),
+	workers_(workers),
+	feedback_queue_(feedback_queue_size),
+	result_queue_(result_queue_size),
+	feedback_running_(true),
+	visual_jobs_( max_segments(param_max_vias_) ),
+	visual_pending_(false),
+	visual_running_(true),
+	visual_posted_(false),
+	as_(nh, "contrail", false) {
+
+	load_geofence();
+
+	//Allocate the goal storage up front (if a capacity has been set)
+	vias_x_.reserve(param_max_vias_);
+	vias_y_.reserve(param_max_vias_);
+	vias_z_.reserve(param_max_vias_);
+	vias_r_.reserve(param_max_vias_);
+	knots_p_.reserve(param_max_vias_);
+	knots_r_.reserve(param_max_vias_);
+
+#ifdef CONTRAIL_MANAGER_SINGLE_PRECISION
+	//Must match the snapshots to be spliced onto them
+	stitch_tail_.set_rebasing(true);
+#endif
+
+	set_frame_id(frame_id);
 
 	dyncfg_settings_.setCallback(boost::bind(&ContrailManager::callback_cfg_settings, this, _1, _2));
 
@@ -56,23 +188,47 @@ ContrailManager::ContrailManager( const ros::NodeHandle &nh, std::string frame_i
     as_.registerGoalCallback(boost::bind(&ContrailManager::callback_actionlib_goal, this));
     as_.registerPreemptCallback(boost::bind(&ContrailManager::callback_actionlib_preempt, this));
 	as_.start();
+
+	if( workers_ == NULL ) {
+		feedback_thread_ = std::thread(&ContrailManager::run_feedback, this);
+		visual_thread_ = std::thread(&ContrailManager::run_visualisation, this);
+	}
 }
 
 ContrailManager::~ContrailManager( void ) {
+	feedback_running_ = false;
+
+	{
+		std::lock_guard<std::mutex> lock(visual_mutex_);
+		visual_running_ = false;
+	}
+	visual_cv_.notify_one();
+
+	if( feedback_thread_.joinable() )
+		feedback_thread_.join();
+
+	if( visual_thread_.joinable() )
+		visual_thread_.join();
 }
 
 
 void ContrailManager::set_frame_id( std::string frame_id ) {
-	param_frame_id_ = frame_id;
+	std::lock_guard<std::mutex> lock(params_mutex_);
+
+	params_.frame_id = frame_id;
+
+	params_snapshot_.back() = params_;
+	params_snapshot_.publish();
 }
 
 bool ContrailManager::has_reference( const ros::Time t ) {
-	return ( spline_start_ > ros::Time(0) );
+	update_tracking();
+
+	return ( tracking_generation_ > 0 );
 }
 
 void ContrailManager::clear_reference( void ) {
-	spline_start_ = ros::Time(0);
-	spline_in_progress_ = false;
+	raise_generation( clear_generation_, published_generation_.load() );
 
 	if( as_.isActive() )
 		as_.setAborted();
@@ -82,7 +238,7 @@ void ContrailManager::allow_new_goals( const bool ready ) {
 	is_ready_ = ready;
 
 	std_msgs::Bool msg_out;
-	msg_out.data = is_ready_;
+	msg_out.data = ready;
 	pub_is_ready_.publish(msg_out);
 }
 
@@ -91,10 +247,14 @@ bool ContrailManager::is_allowing_new_goals( void ) {
 }
 
 void ContrailManager::callback_actionlib_preempt(void) {
+	//A new goal replaces (or is appended to) the current one when it is
+	//accepted, so the current trajectory must not be stopped here
+	if( as_.isNewGoalAvailable() )
+		return;
+
 	ROS_INFO("Contrail: Preempted goal");
 	as_.setPreempted();
-	spline_in_progress_ = false;
-	wait_reached_end_ = false;
+	raise_generation( preempt_generation_, published_generation_.load() );
 }
 
 void ContrailManager::callback_actionlib_goal(void) {
@@ -109,51 +269,115 @@ void ContrailManager::callback_actionlib_goal(void) {
 
 void ContrailManager::set_action_goal( void ) {
 	boost::shared_ptr<const contrail_manager::TrajectoryGoal> goal = as_.acceptNewGoal();
+	const params_t params = get_params();
 
 	if(is_ready_) {
-		if( (goal->duration > ros::Duration(0) ) &&
+		if( !goal->trajectory_file.empty() ) {
+			if( !set_trajectory_file_goal( *goal, params ) )
+				clear_reference();
+		} else if( (goal->duration > ros::Duration(0) ) &&
 			(goal->positions.size() >= 2) &&
-			(goal->yaws.size() >= 2) ) {
+			(goal->yaws.size() >= 2) &&
+			( goal->times.empty() || valid_knot_times(goal->times, goal->positions.size()) ) &&
+			( goal->interpolation <= contrail_manager::TrajectoryGoal::INTERPOLATION_MIN_JERK ) &&
+			( (param_max_vias_ == 0) || ( (goal->positions.size() <= (size_t)param_max_vias_) && (goal->yaws.size() <= (size_t)param_max_vias_) ) ) ) {
 
 			ros::Time tc = ros::Time::now();
 
-			spline_in_progress_ = true;
-			wait_reached_end_ = false;
+			//The control loop can't see the snapshot until it is published,
+			//so it keeps tracking the current goal while this one is built
+			TrajectorySnapshot& snapshot = snapshot_.back();
 
-			spline_start_ = ( goal->start == ros::Time(0) ) ? tc : goal->start;
-			spline_duration_ = goal->duration;
+			const bool stitched = goal->append && stitch_action_goal( *goal, params, tc );
+			bool matched = false;
 
-			std::vector<double> positions_yaw = make_yaw_continuous( goal->yaws );
+			if( stitched ) {
+				ROS_INFO( "Contrail: Appending to trajectory [p:%u; y:%u]", (unsigned int)goal->positions.size(), (unsigned int)goal->yaws.size() );
+			} else {
+				if( goal->append )
+					ROS_WARN( "Contrail: unable to append goal to the current trajectory, starting it as normal" );
+
+				snapshot.continues = 0;
+				snapshot.start = ( goal->start == ros::Time(0) ) ? tc : goal->start;
+				snapshot.duration = goal->duration;
 
-			Eigen::VectorXd vias_x = Eigen::VectorXd::Zero(goal->positions.size());
-			Eigen::VectorXd vias_y = Eigen::VectorXd::Zero(goal->positions.size());
-			Eigen::VectorXd vias_z = Eigen::VectorXd::Zero(goal->positions.size());
-			Eigen::VectorXd vias_r = Eigen::VectorXd::Zero(positions_yaw.size());
+				//Fill the scratch buffers (no allocation if within max_vias)
+				make_yaw_continuous( goal->yaws, vias_r_ );
 
-			ROS_INFO( "Contrail: Creating trajectory [p:%u; y:%u]", (unsigned int)goal->positions.size(), (unsigned int)goal->yaws.size() );
+				vias_x_.resize(goal->positions.size());
+				vias_y_.resize(goal->positions.size());
+				vias_z_.resize(goal->positions.size());
 
-			for(int i=0; i<goal->positions.size(); i++) {
-				vias_x(i) = goal->positions[i].x;
-				vias_y(i) = goal->positions[i].y;
-				vias_z(i) = goal->positions[i].z;
+				ROS_INFO( "Contrail: Creating trajectory [p:%u; y:%u]", (unsigned int)goal->positions.size(), (unsigned int)goal->yaws.size() );
+
+				for(int i=0; i<goal->positions.size(); i++) {
+					vias_x_[i] = goal->positions[i].x;
+					vias_y_[i] = goal->positions[i].y;
+					vias_z_[i] = goal->positions[i].z;
+				}
+
+				const contrail_spline_lib::interpolation_mode_t mode =
+					( goal->interpolation == contrail_manager::TrajectoryGoal::INTERPOLATION_MIN_JERK ) ?
+					contrail_spline_lib::INTERPOLATION_MIN_JERK : contrail_spline_lib::INTERPOLATION_LINEAR_EST;
+
+				spline_x_.set_mode(mode);
+				spline_y_.set_mode(mode);
+				spline_z_.set_mode(mode);
+				spline_r_.set_mode(mode);
+
+				//Knot times (if given) are used directly from the goal
+				const double* knots = goal->times.empty() ? NULL : goal->times.data();
+				//Yaw shares the position knots if it has a matching set of vias
+				const double* knots_r = ( vias_r_.size() == goal->times.size() ) ? knots : NULL;
+
+				//A goal set to start in the future keeps its start time (and starts as normal)
+				matched = params.match_state && ( goal->start <= tc ) &&
+						  match_action_goal( *goal, params, tc, mode, knots, knots_r );
+
+				//Called directly (not in an assert), as they must run in every build
+				if( !matched &&
+					!( spline_x_.interpolate(vias_x_.data(), vias_x_.size(), knots) &&
+					   spline_y_.interpolate(vias_y_.data(), vias_y_.size(), knots) &&
+					   spline_z_.interpolate(vias_z_.data(), vias_z_.size(), knots) &&
+					   spline_r_.interpolate(vias_r_.data(), vias_r_.size(), knots_r) &&
+					   snapshot.trajectory.pack(spline_x_, spline_y_, spline_z_, spline_r_, snapshot.duration.toSec()) ) ) {
+					ROS_ERROR( "Contrail: unable to interpolate the trajectory, rejecting" );
+					clear_reference();
+					return;
+				}
 			}
 
-			for(int i=0; i<positions_yaw.size(); i++) {
-				vias_r(i) = positions_yaw[i];
+			if( !check_trajectory_limits(snapshot, params) || !check_trajectory_geofence(snapshot) ) {
+				clear_reference();
+				return;
 			}
 
-			ROS_ASSERT_MSG( spline_x_.interpolate(vias_x), "Spline X interpolation failed!!!" );
-			ROS_ASSERT_MSG( spline_y_.interpolate(vias_y), "Spline Y interpolation failed!!!" );
-			ROS_ASSERT_MSG( spline_z_.interpolate(vias_z), "Spline Z interpolation failed!!!" );
-			ROS_ASSERT_MSG( spline_r_.interpolate(vias_r), "Spline Yaw interpolation failed!!!" );
+			prepare_tracking( snapshot, goal->constant_speed, params );
+
+			if( stitched || matched ) {
+				//The yaws are unwrapped onto the current trajectory
+				const contrail_spline_lib::packed_quintic_point_t p_start = snapshot.trajectory.lookup(0.0);
+				const contrail_spline_lib::packed_quintic_point_t p_end = snapshot.trajectory.lookup(snapshot.trajectory.get_duration());
+
+				snapshot.pos_start = Eigen::Vector3d(p_start.q[0], p_start.q[1], p_start.q[2]);
+				snapshot.pos_end = Eigen::Vector3d(p_end.q[0], p_end.q[1], p_end.q[2]);
+				snapshot.rot_start = p_start.q[3];
+				snapshot.rot_end = p_end.q[3];
+			} else {
+				snapshot.pos_start = vector_from_msg(goal->positions.front());
+				snapshot.pos_end = vector_from_msg(goal->positions.back());
+				snapshot.rot_start = goal->yaws.front();
+				snapshot.rot_end = goal->yaws.back();
+			}
 
-			spline_pos_start_ = vector_from_msg(goal->positions.front());
-			spline_pos_end_ = vector_from_msg(goal->positions.back());
-			spline_rot_start_ = goal->yaws.front();
-			spline_rot_end_ = goal->yaws.back();
+			const TrajectorySnapshot& published = publish_snapshot();
 
-			publish_approx_spline(tc);
-			publish_spline_points(tc, goal->positions, goal->yaws);
+			publish_approx_spline(tc, published, params);
+			if( stitched || matched ) {
+				publish_trajectory_knots(tc, published, params);
+			} else {
+				publish_spline_points(tc, published, params, goal->positions, goal->yaws);
+			}
 
 			ROS_DEBUG( "Contrail: creating position spline connecting %i points", (int)goal->positions.size() );
 			ROS_DEBUG( "Contrail: creating rotation spline connecting %i points", (int)goal->yaws.size() );
@@ -161,6 +385,12 @@ void ContrailManager::set_action_goal( void ) {
 			clear_reference();
 
 			ROS_ERROR( "Contrail: at least 2 positions/yaws must be specified (%i/%i), and duration must be >0 (%0.4f)", (int)goal->positions.size(), (int)goal->yaws.size(), goal->duration.toSec() );
+			if( !goal->times.empty() )
+				ROS_ERROR( "Contrail: times must be strictly increasing, with one time per position (%i/%i)", (int)goal->times.size(), (int)goal->positions.size() );
+			if( goal->interpolation > contrail_manager::TrajectoryGoal::INTERPOLATION_MIN_JERK )
+				ROS_ERROR( "Contrail: unknown interpolation method (%i)", (int)goal->interpolation );
+			if( param_max_vias_ > 0 )
+				ROS_ERROR( "Contrail: at most %i positions/yaws may be specified (max_vias)", param_max_vias_ );
 		}
 	} else {
 		clear_reference();
@@ -187,27 +417,29 @@ bool ContrailManager::get_reference( mavros_msgs::PositionTarget &ref,
 	double rrate;
 
 	if(	get_reference( pos, vel, acc, rpos, rrate, tc, g_c ) ) {
+		const params_t& params = params_snapshot_.front();
+
 		ref.header.stamp = tc;
-		ref.header.frame_id = param_frame_id_;
+		ref.header.frame_id = params.frame_id;
 
 		ref.coordinate_frame = ref.FRAME_LOCAL_NED;
 		ref.type_mask = 0;
 
 		ref.position = point_from_eig(pos);
 		ref.yaw = rpos;
-		if(!param_ref_position_) {
+		if(!params.ref_position) {
 			ref.type_mask |= ref.IGNORE_PX | ref.IGNORE_PY | ref.IGNORE_PZ | ref.IGNORE_YAW;
 		}
 		ref.velocity = vector_from_eig(vel);
 		ref.yaw_rate = rrate;
-		if(!param_ref_velocity_) {
+		if(!params.ref_velocity) {
 			ref.type_mask |= ref.IGNORE_VX | ref.IGNORE_VY | ref.IGNORE_VZ | ref.IGNORE_YAW_RATE;
 		}
 
 		ref.acceleration_or_force = vector_from_eig(acc);
-		if(!param_ref_acceleration_) {
+		if(!params.ref_acceleration) {
 			ref.type_mask |= ref.IGNORE_AFX | ref.IGNORE_AFY | ref.IGNORE_AFZ;
-		} else if (param_ref_acceleration_ && !param_ref_position_ && !param_ref_velocity_) {
+		} else if (params.ref_acceleration && !params.ref_position && !params.ref_velocity) {
 			// Edge-case for accel-only reference,
 			// then we need to set yaw-rate to 0 at
 			// the very least
@@ -232,12 +464,15 @@ bool ContrailManager::get_reference( Eigen::Vector3d &pos,
 
 	//If a valid input has been received
 	if( has_reference( tc ) ) {
+		const TrajectorySnapshot& snapshot = snapshot_.front();
+		const params_t& params = params_snapshot_.front();
+
 		//If in progress, calculate the lastest reference
 		if( spline_in_progress_ ) {
 			if( tc < spline_start_ ) {
 				//Have no begun, stay at start position
-				pos = spline_pos_start_;
-				rpos = spline_rot_start_;
+				pos = snapshot.pos_start;
+				rpos = snapshot.rot_start;
 				vel = Eigen::Vector3d::Zero();
 				acc = Eigen::Vector3d::Zero();
 				rrate = 0.0;
@@ -250,44 +485,34 @@ bool ContrailManager::get_reference( Eigen::Vector3d &pos,
 				feedback.yaw = rpos;
 				feedback.yawrate = rrate;
 
-				as_.publishFeedback(feedback);
-			} else if( tc <= (spline_start_ + spline_duration_) ) {
-				double t_norm = normalize((tc - spline_start_).toSec(), 0.0, spline_duration_.toSec());
-				double npx = 0.0;
-				double npy = 0.0;
-				double npz = 0.0;
-				double npr = 0.0;
-				double nvx = 0.0;
-				double nvy = 0.0;
-				double nvz = 0.0;
-				double nvr = 0.0;
-				double nax = 0.0;
-				double nay = 0.0;
-				double naz = 0.0;
-				double nar = 0.0;
-
-				get_spline_reference(spline_x_, npx, nvx, nax, t_norm);
-				get_spline_reference(spline_y_, npy, nvy, nay, t_norm);
-				get_spline_reference(spline_z_, npz, nvz, naz, t_norm);
-				get_spline_reference(spline_r_, npr, nvr, nar, t_norm);
-
-				pos = Eigen::Vector3d(npx,npy,npz);
-				rpos = npr;
-
-				if(param_ref_velocity_) {
-					vel = Eigen::Vector3d(nvx,nvy,nvz) / spline_duration_.toSec();
-					rrate = nvr / spline_duration_.toSec();
+				queue_feedback(params, tc, feedback);
+			} else if( tc <= (spline_start_ + snapshot.duration) ) {
+				if( snapshot.follow_path )
+					follow_path( snapshot, params, tc, g_c.translation() );
+
+				double t = (tc - spline_start_).toSec();
+				double t_norm = normalize(t, 0.0, snapshot.duration.toSec());
+
+				contrail_spline_lib::packed_quintic_point_t ref = snapshot.constant_speed ? get_constant_speed_reference(snapshot, t) : get_trajectory_reference(snapshot, t);
+
+				pos = Eigen::Vector3d(ref.q[0], ref.q[1], ref.q[2]);
+				rpos = ref.q[3];
+
+				if(params.ref_velocity) {
+					vel = Eigen::Vector3d(ref.qd[0], ref.qd[1], ref.qd[2]);
+					rrate = ref.qd[3];
 				} else {
-					acc = Eigen::Vector3d::Zero();
+					vel = Eigen::Vector3d::Zero();
+					rrate = 0.0;
 				}
 
-				if(param_ref_acceleration_) {
-					acc = Eigen::Vector3d(nax,nay,naz) / ( spline_duration_.toSec() * spline_duration_.toSec() );
+				if(params.ref_acceleration) {
+					acc = Eigen::Vector3d(ref.qdd[0], ref.qdd[1], ref.qdd[2]);
 				} else {
 					acc = Eigen::Vector3d::Zero();
 				}
 
-				//nar is discarded
+				//Yaw acceleration is discarded
 
 				contrail_manager::TrajectoryFeedback feedback;
 				feedback.progress = t_norm;
@@ -297,13 +522,13 @@ bool ContrailManager::get_reference( Eigen::Vector3d &pos,
 				feedback.yaw = rpos;
 				feedback.yawrate = rrate;
 
-				as_.publishFeedback(feedback);
+				queue_feedback(params, tc, feedback);
 			} else {
 				wait_reached_end_ = true;
 				spline_in_progress_ = false;
 
-				pos = spline_pos_end_;
-				rpos = spline_rot_end_;
+				pos = snapshot.pos_end;
+				rpos = snapshot.rot_end;
 				vel = Eigen::Vector3d::Zero();
 				acc = Eigen::Vector3d::Zero();
 				rrate = 0.0;
@@ -337,19 +562,27 @@ void ContrailManager::check_end_reached( const geometry_msgs::Pose &p_c ) {
 
 void ContrailManager::check_end_reached( const Eigen::Affine3d &g_c ) {
 	if(wait_reached_end_) {
+		const TrajectorySnapshot& snapshot = snapshot_.front();
+
 		double yaw_c = yaw_from_quaternion( Eigen::Quaterniond(g_c.linear()) );
-		if( check_endpoint_reached( spline_pos_end_,
-									spline_rot_end_,
+		if( check_endpoint_reached( params_snapshot_.front(),
+									snapshot.pos_end,
+									snapshot.rot_end,
 									g_c.translation(),
 									yaw_c ) ) {
 
-			contrail_manager::TrajectoryResult result;
-			result.position_final = vector_from_eig( g_c.translation() );
-			result.yaw_final = yaw_c;
-			as_.setSucceeded(result);
-
-			wait_reached_end_ = false;
-			ROS_INFO( "Contrail: Trajectory complete" );
+			goal_result_t result;
+			result.generation = tracking_generation_;
+			result.result.position_final = vector_from_eig( g_c.translation() );
+			result.result.yaw_final = yaw_c;
+
+			//Sent by the publisher, as the action server lock may be held
+			//for a whole goal callback. Tried again next step if the
+			//publisher has fallen behind
+			if( result_queue_.push(result) ) {
+				wait_reached_end_ = false;
+				ROS_INFO( "Contrail: Trajectory complete" );
+			}
 		}
 	}
 }
@@ -359,27 +592,607 @@ void ContrailManager::check_end_reached( const Eigen::Affine3d &g_c ) {
 //=======================
 
 void ContrailManager::callback_cfg_settings( contrail_manager::ManagerParamsConfig &config, uint32_t level ) {
-	param_end_position_accuracy_ = config.end_position_accuracy;
-	param_end_yaw_accuracy_ = config.end_yaw_accuracy;
-	param_spline_approx_res_ = config.spline_res_per_sec;
-	param_ref_position_ = config.use_position_ref;
-	param_ref_velocity_ = config.use_velocity_ref;
-	param_ref_acceleration_ = config.use_acceleration_ref;
+	std::lock_guard<std::mutex> lock(params_mutex_);
+
+	params_.end_position_accuracy = config.end_position_accuracy;
+	params_.end_yaw_accuracy = config.end_yaw_accuracy;
+	params_.spline_approx_res = config.spline_res_per_sec;
+	params_.spline_approx_tolerance = config.spline_approx_tolerance;
+	params_.spline_approx_max_angle = config.spline_approx_max_angle;
+	params_.ref_position = config.use_position_ref;
+	params_.ref_velocity = config.use_velocity_ref;
+	params_.ref_acceleration = config.use_acceleration_ref;
+	params_.limits.velocity = config.max_velocity;
+	params_.limits.acceleration = config.max_acceleration;
+	params_.limits.yaw_rate = config.max_yaw_rate;
+	params_.rescale_to_limits = config.rescale_to_limits;
+	params_.follow_path = config.follow_path;
+	params_.follow_path_lookahead = config.follow_path_lookahead;
+	params_.stitch_lead = config.stitch_lead;
+	params_.match_state = config.match_state;
+	params_.feedback_rate = config.feedback_rate;
+
+	//Only published whole, so the control loop sees all of the changes at once
+	params_snapshot_.back() = params_;
+	params_snapshot_.publish();
+}
+
+void ContrailManager::publish_feedback( void ) {
+	contrail_manager::TrajectoryFeedback feedback;
+
+	while( feedback_queue_.pop(feedback) ) {
+		//Feedback may still be queued from a goal that has since finished
+		if( as_.isActive() )
+			as_.publishFeedback(feedback);
+	}
+
+	goal_result_t result;
+
+	while( result_queue_.pop(result) ) {
+		//A newer goal has replaced the one that finished
+		if( ( result.generation == published_generation_.load() ) && as_.isActive() )
+			as_.setSucceeded(result.result);
+	}
+}
+
+void ContrailManager::run_feedback( void ) {
+	while( feedback_running_ ) {
+		publish_feedback();
+
+		std::this_thread::sleep_for(feedback_poll_period);
+	}
+}
+
+void ContrailManager::run_visualisation( void ) {
+	while( true ) {
+		{
+			std::unique_lock<std::mutex> lock(visual_mutex_);
+			visual_cv_.wait( lock, [this]{ return visual_pending_ || !visual_running_; } );
+
+			if( !visual_running_ )
+				break;
+
+			visual_pending_ = false;
+		}
+
+		draw_visualisation();
+	}
+}
+
+void ContrailManager::run_visualisation_posted( void ) {
+	while( true ) {
+		{
+			std::lock_guard<std::mutex> lock(visual_mutex_);
+
+			//Only one job is posted at a time, so the jobs are never read
+			//from two workers at once
+			if( !visual_pending_ ) {
+				visual_posted_ = false;
+				break;
+			}
+
+			visual_pending_ = false;
+		}
+
+		draw_visualisation();
+	}
+}
+
+void ContrailManager::draw_visualisation( void ) {
+	//Only the latest job is worth drawing if several arrived meanwhile
+	visual_jobs_.update();
+	const VisualisationJob& job = visual_jobs_.front();
+
+	contrail_spline_lib::adaptive_sample( job.trajectory, job.tolerance, visual_times_, visual_points_ );
+
+	nav_msgs::Path msg_out;
+	msg_out.header.frame_id = job.frame_id;
+	msg_out.header.stamp = job.stamp;
+
+	msg_out.poses.resize( visual_points_.size() );
+	for(size_t i=0; i<visual_points_.size(); i++) {
+		geometry_msgs::PoseStamped& p = msg_out.poses[i];
+		const double r = 0.5*visual_points_[i].q[3];
+
+		p.header.frame_id = msg_out.header.frame_id;
+		p.header.stamp = job.start + ros::Duration(visual_times_[i]);
+		p.header.seq = i;
+
+		p.pose.position.x = visual_points_[i].q[0];
+		p.pose.position.y = visual_points_[i].q[1];
+		p.pose.position.z = visual_points_[i].q[2];
+
+		//A rotation about z only, so the quaternion is direct from the yaw
+		p.pose.orientation.w = std::cos(r);
+		p.pose.orientation.x = 0.0;
+		p.pose.orientation.y = 0.0;
+		p.pose.orientation.z = std::sin(r);
+	}
+
+	pub_spline_approx_.publish(msg_out);
+}
+
+void ContrailManager::queue_feedback( const params_t& params, const ros::Time tc, const contrail_manager::TrajectoryFeedback& feedback ) {
+	const double dt = (tc - feedback_last_).toSec();
+
+	//Decimated to the feedback rate (allowing for time jumping backwards)
+	if( ( params.feedback_rate > 0.0 ) && ( dt >= 0.0 ) && ( dt < ( 1.0 / params.feedback_rate ) ) )
+		return;
+
+	//Dropped if the publisher thread has fallen behind, it will catch up
+	//with the next one
+	if( feedback_queue_.push(feedback) )
+		feedback_last_ = tc;
 }
 
-void ContrailManager::get_spline_reference( contrail_spline_lib::InterpolatedQuinticSpline& spline,
-											double& pos,
-											double& vel,
-											double& acc,
-											const double u) {
-	// x values need to be scaled down in extraction as well.
-	ROS_ASSERT_MSG((u >= 0.0) && (u <= 1.0), "Invalid time point given for spline interpolation (0.0 <= t <= 1.0)");
-	ROS_ASSERT_MSG(spline.is_valid(), "Invalid spline request (not initialized?)");
+ContrailManager::params_t ContrailManager::get_params( void ) {
+	std::lock_guard<std::mutex> lock(params_mutex_);
 
-	contrail_spline_lib::quintic_spline_point_t point = spline.lookup(u);
-	pos = point.q;
-	vel = point.qd;
-	acc = point.qdd;
+	return params_;
+}
+
+bool ContrailManager::check_trajectory_limits( TrajectorySnapshot& snapshot, const params_t& params ) {
+	//Finding the peaks reads every segment, so skip it if there is nothing to check
+	if( !( ( params.limits.velocity > 0.0 ) || ( params.limits.acceleration > 0.0 ) || ( params.limits.yaw_rate > 0.0 ) ) )
+		return true;
+
+	const contrail_spline_lib::kinematic_peaks_t peaks = contrail_spline_lib::trajectory_peaks(snapshot.trajectory);
+	const double k = contrail_spline_lib::trajectory_limit_scale(peaks, params.limits);
+
+	if( k > 1.0 ) {
+		//A mapped trajectory file (or a trajectory joined onto the current
+		//one) can't be re-packed, so it can only be rejected
+		if( !params.rescale_to_limits || snapshot.trajectory.is_mapped() || ( snapshot.continues != 0 ) ) {
+			ROS_ERROR( "Contrail: goal exceeds kinematic limits [v:%0.2f/%0.2f; a:%0.2f/%0.2f; r:%0.2f/%0.2f], rejecting",
+					   peaks.velocity, params.limits.velocity,
+					   peaks.acceleration, params.limits.acceleration,
+					   peaks.yaw_rate, params.limits.yaw_rate );
+			return false;
+		}
+
+		//Stretching the duration by k scales the velocities by 1/k, and the
+		//accelerations by 1/k^2, so only the packed timing needs to change
+		snapshot.duration = ros::Duration( snapshot.duration.toSec() * k );
+		if( !snapshot.trajectory.pack(spline_x_, spline_y_, spline_z_, spline_r_, snapshot.duration.toSec()) ) {
+			ROS_ERROR( "Contrail: unable to re-pack the stretched trajectory, rejecting" );
+			return false;
+		}
+
+		ROS_WARN( "Contrail: goal exceeds kinematic limits, stretched duration by %0.2fx to %0.2fs", k, snapshot.duration.toSec() );
+	}
+
+	return true;
+}
+
+bool ContrailManager::set_trajectory_file_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params ) {
+	ros::Time tc = ros::Time::now();
+
+	TrajectorySnapshot& snapshot = snapshot_.back();
+
+	//Nothing is solved here, the file is only mapped and checked
+	if( !snapshot.trajectory.load(goal.trajectory_file) ) {
+		ROS_ERROR( "Contrail: unable to load trajectory file (%s precision expected): %s",
+				   ( sizeof(trajectory_scalar_t) == sizeof(float) ) ? "single" : "double",
+				   goal.trajectory_file.c_str() );
+		return false;
+	}
+
+	ROS_INFO( "Contrail: Loaded trajectory [s:%u; t:%0.2f]", (unsigned int)snapshot.trajectory.get_num_segments(), snapshot.trajectory.get_duration() );
+
+	snapshot.continues = 0;
+	snapshot.start = ( goal.start == ros::Time(0) ) ? tc : goal.start;
+	snapshot.duration = ros::Duration( snapshot.trajectory.get_duration() );
+
+	if( !check_trajectory_limits(snapshot, params) || !check_trajectory_geofence(snapshot) )
+		return false;
+
+	prepare_tracking( snapshot, goal.constant_speed, params );
+
+	const contrail_spline_lib::packed_quintic_point_t p_start = snapshot.trajectory.lookup(0.0);
+	const contrail_spline_lib::packed_quintic_point_t p_end = snapshot.trajectory.lookup(snapshot.trajectory.get_duration());
+
+	snapshot.pos_start = Eigen::Vector3d(p_start.q[0], p_start.q[1], p_start.q[2]);
+	snapshot.pos_end = Eigen::Vector3d(p_end.q[0], p_end.q[1], p_end.q[2]);
+	snapshot.rot_start = p_start.q[3];
+	snapshot.rot_end = p_end.q[3];
+
+	const TrajectorySnapshot& published = publish_snapshot();
+
+	publish_approx_spline(tc, published, params);
+	publish_trajectory_knots(tc, published, params);
+
+	return true;
+}
+
+bool ContrailManager::check_trajectory_geofence( const TrajectorySnapshot& snapshot ) {
+	const contrail_spline_lib::geofence_result_t r = contrail_spline_lib::trajectory_geofence_check(snapshot.trajectory, param_geofence_);
+
+	switch( r.violation ) {
+		case contrail_spline_lib::GEOFENCE_ARENA:
+			ROS_ERROR( "Contrail: goal leaves the geofence arena at t=%0.2fs, rejecting", r.t );
+			break;
+		case contrail_spline_lib::GEOFENCE_HALF_SPACE:
+			ROS_ERROR( "Contrail: goal crosses geofence half space %u at t=%0.2fs, rejecting", (unsigned int)r.constraint, r.t );
+			break;
+		case contrail_spline_lib::GEOFENCE_KEEP_OUT:
+			ROS_ERROR( "Contrail: goal enters geofence keep-out box %u at t=%0.2fs, rejecting", (unsigned int)r.constraint, r.t );
+			break;
+		default:
+			break;
+	}
+
+	return r.violation == contrail_spline_lib::GEOFENCE_CLEAR;
+}
+
+void ContrailManager::load_geofence( void ) {
+	std::vector<double> arena;
+	std::vector<double> half_spaces;
+	std::vector<double> keep_out;
+
+	nhp_.param( "geofence/arena", arena, std::vector<double>() );
+	nhp_.param( "geofence/half_spaces", half_spaces, std::vector<double>() );
+	nhp_.param( "geofence/keep_out", keep_out, std::vector<double>() );
+
+	param_geofence_.has_arena = ( arena.size() == 6 );
+	if( param_geofence_.has_arena ) {
+		for(int i=0; i<3; i++) {
+			param_geofence_.arena.lo[i] = arena[i];
+			param_geofence_.arena.hi[i] = arena[i+3];
+		}
+	} else if( !arena.empty() ) {
+		ROS_WARN( "Contrail: geofence arena must be [x_min, y_min, z_min, x_max, y_max, z_max], ignoring" );
+	}
+
+	if( half_spaces.size() % 4 != 0 ) {
+		ROS_WARN( "Contrail: geofence half spaces must be a list of [n_x, n_y, n_z, offset], ignoring" );
+		half_spaces.clear();
+	}
+
+	for(size_t i=0; i<half_spaces.size(); i+=4) {
+		contrail_spline_lib::half_space_t h = {{half_spaces[i], half_spaces[i+1], half_spaces[i+2]}, half_spaces[i+3]};
+		param_geofence_.half_spaces.push_back(h);
+	}
+
+	if( keep_out.size() % 6 != 0 ) {
+		ROS_WARN( "Contrail: geofence keep-out boxes must be a list of [x_min, y_min, z_min, x_max, y_max, z_max], ignoring" );
+		keep_out.clear();
+	}
+
+	for(size_t i=0; i<keep_out.size(); i+=6) {
+		contrail_spline_lib::aabb_t box = {{keep_out[i], keep_out[i+1], keep_out[i+2]}, {keep_out[i+3], keep_out[i+4], keep_out[i+5]}};
+		param_geofence_.keep_out.push_back(box);
+	}
+
+	if( param_geofence_.has_arena || !param_geofence_.half_spaces.empty() || !param_geofence_.keep_out.empty() ) {
+		ROS_INFO( "Contrail: geofence loaded [a:%s; h:%u; k:%u]", param_geofence_.has_arena ? "yes" : "no",
+				  (unsigned int)param_geofence_.half_spaces.size(), (unsigned int)param_geofence_.keep_out.size() );
+	}
+}
+
+bool ContrailManager::stitch_action_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params, const ros::Time tc ) {
+	//The last published goal is still ours to read until the next publish
+	const TrajectorySnapshot& current = snapshot_.published();
+	const contrail_spline_lib::BasicPackedQuinticTrajectory<trajectory_scalar_t>& trajectory = current.trajectory;
+
+	if( !can_join(current, goal) )
+		return false;
+
+	//Trajectory time of the reference (less any time held back by path following)
+	const double duration = trajectory.get_duration();
+	const double t_now = (tc - current.start).toSec() - tracking_delay_.load();
+
+	if( ( t_now + params.stitch_lead ) > duration )
+		return false;
+
+	//Segments from just behind the reference are kept as they are, so the
+	//control loop has the same trajectory under it until it picks this one
+	//up, and the rest is re-solved from the first knot past the lead
+	const double* knots = trajectory.get_knots();
+	const size_t num_seg = trajectory.get_num_segments();
+	const size_t k_keep = trajectory.locate( std::max( t_now - params.stitch_lead, 0.0 ) );
+	const size_t k_s = std::lower_bound( knots, knots + num_seg + 1, t_now + params.stitch_lead ) - knots;
+
+	//The state at the join, then the remaining knots of the current
+	//trajectory, with the first position of the goal in place of its end
+	//point (unless the join is at the end point)
+	const size_t num_old = ( k_s < num_seg ) ? num_seg - k_s : 1;
+	const size_t new_first = ( k_s < num_seg ) ? 0 : 1;
+	const size_t num_p = num_old + goal.positions.size() - new_first;
+	const size_t num_r = num_old + goal.yaws.size() - new_first;
+
+	if( ( param_max_vias_ > 0 ) && ( ( num_p > (size_t)param_max_vias_ ) || ( num_r > (size_t)param_max_vias_ ) ) ) {
+		ROS_WARN( "Contrail: appended trajectory would need %u positions (max_vias)", (unsigned int)std::max(num_p, num_r) );
+		return false;
+	}
+
+	const double t_s = knots[k_s];
+	const double t_end = duration - t_s;	//Time from the join to the old end point
+	const double d_tail = t_end + goal.duration.toSec();
+
+	vias_x_.resize(num_p);
+	vias_y_.resize(num_p);
+	vias_z_.resize(num_p);
+	vias_r_.resize(num_r);
+	knots_p_.resize(num_p);
+	knots_r_.resize(num_r);
+
+	const contrail_spline_lib::packed_quintic_point_t p_s = trajectory.lookup(t_s);
+
+	for(size_t i=0; i<num_old; i++) {
+		const contrail_spline_lib::packed_quintic_point_t p = ( i == 0 ) ? p_s : trajectory.lookup(knots[k_s + i]);
+
+		vias_x_[i] = p.q[0];
+		vias_y_[i] = p.q[1];
+		vias_z_[i] = p.q[2];
+		vias_r_[i] = p.q[3];
+		knots_p_[i] = ( knots[k_s + i] - t_s ) / d_tail;
+		knots_r_[i] = knots_p_[i];
+	}
+
+	//The goal is spread over its duration after the old end point, with
+	//its times (if given) scaled to match
+	const double goal_t0 = goal.times.empty() ? 0.0 : goal.times.front();
+	const double goal_dt = goal.times.empty() ? 0.0 : goal.times.back() - goal.times.front();
+
+	for(size_t i=new_first; i<goal.positions.size(); i++) {
+		const size_t j = num_old + i - new_first;
+		const double u = goal.times.empty() ? (double)i / ( goal.positions.size() - 1 ) : ( goal.times[i] - goal_t0 ) / goal_dt;
+
+		vias_x_[j] = goal.positions[i].x;
+		vias_y_[j] = goal.positions[i].y;
+		vias_z_[j] = goal.positions[i].z;
+		knots_p_[j] = ( t_end + u*goal.duration.toSec() ) / d_tail;
+	}
+
+	//Yaw shares the position times if it has a matching set of vias, and
+	//is unwrapped to carry on from the current trajectory
+	double r_last = trajectory.lookup(duration).q[3];
+	for(size_t i=0; i<goal.yaws.size(); i++) {
+		const double r = r_last + yaw_error_shortest_path(goal.yaws[i], r_last);
+		r_last = r;
+
+		if( i < new_first )
+			continue;
+
+		const size_t j = num_old + i - new_first;
+		const double u = ( goal.yaws.size() == goal.times.size() ) ? ( goal.times[i] - goal_t0 ) / goal_dt : (double)i / ( goal.yaws.size() - 1 );
+
+		vias_r_[j] = r;
+		knots_r_[j] = ( t_end + u*goal.duration.toSec() ) / d_tail;
+	}
+
+	const contrail_spline_lib::interpolation_mode_t mode =
+		( goal.interpolation == contrail_manager::TrajectoryGoal::INTERPOLATION_MIN_JERK ) ?
+		contrail_spline_lib::INTERPOLATION_MIN_JERK : contrail_spline_lib::INTERPOLATION_LINEAR_EST;
+
+	return join_trajectory( current, k_keep, t_s, p_s, d_tail, mode, knots_p_.data(), knots_r_.data() );
+}
+
+bool ContrailManager::match_action_goal( const contrail_manager::TrajectoryGoal& goal, const params_t& params, const ros::Time tc,
+										 const contrail_spline_lib::interpolation_mode_t mode, const double* knots_p, const double* knots_r ) {
+	const TrajectorySnapshot& current = snapshot_.published();
+	const contrail_spline_lib::BasicPackedQuinticTrajectory<trajectory_scalar_t>& trajectory = current.trajectory;
+
+	if( !can_join(current, goal) )
+		return false;
+
+	//Switch over just ahead of the reference, with the segments from just
+	//behind it kept until the control loop picks the new goal up
+	const double t_now = (tc - current.start).toSec() - tracking_delay_.load();
+	const double t_join = t_now + params.stitch_lead;
+
+	if( t_join > trajectory.get_duration() )
+		return false;
+
+	const size_t k_keep = trajectory.locate( std::max( t_now - params.stitch_lead, 0.0 ) );
+	const contrail_spline_lib::packed_quintic_point_t p = trajectory.lookup(t_join);
+
+	//The rest of the yaws are unwrapped to carry on from the current one
+	const double r_shift = p.q[3] + yaw_error_shortest_path(vias_r_[0], p.q[3]) - vias_r_[0];
+	for(size_t i=0; i<vias_r_.size(); i++)
+		vias_r_[i] += r_shift;
+
+	vias_x_[0] = p.q[0];
+	vias_y_[0] = p.q[1];
+	vias_z_[0] = p.q[2];
+	vias_r_[0] = p.q[3];
+
+	if( !join_trajectory( current, k_keep, t_join, p, goal.duration.toSec(), mode, knots_p, knots_r ) ) {
+		//Put the goal back as it was, to be started as normal
+		vias_x_[0] = goal.positions[0].x;
+		vias_y_[0] = goal.positions[0].y;
+		vias_z_[0] = goal.positions[0].z;
+		make_yaw_continuous( goal.yaws, vias_r_ );
+
+		return false;
+	}
+
+	ROS_INFO( "Contrail: Starting from the current reference [t:%0.2f]", t_join );
+
+	return true;
+}
+
+bool ContrailManager::can_join( const TrajectorySnapshot& current, const contrail_manager::TrajectoryGoal& goal ) {
+	return ( current.generation > 0 ) &&
+		   ( current.generation > preempt_generation_.load() ) &&
+		   ( current.generation > clear_generation_.load() ) &&
+		   !current.constant_speed && !goal.constant_speed;
+}
+
+bool ContrailManager::join_trajectory( const TrajectorySnapshot& current, const size_t first, const double t_join,
+									   const contrail_spline_lib::packed_quintic_point_t& p_join, const double d_tail,
+									   const contrail_spline_lib::interpolation_mode_t mode, const double* knots_p, const double* knots_r ) {
+	contrail_spline_lib::InterpolatedQuinticSpline* splines[4] = {&spline_x_, &spline_y_, &spline_z_, &spline_r_};
+	const std::vector<double>* vias[4] = {&vias_x_, &vias_y_, &vias_z_, &vias_r_};
+	bool success = true;
+
+	for(int c=0; c<4; c++) {
+		//Start from the state at the join (in the normalised time of the tail)
+		splines[c]->set_mode(mode);
+		splines[c]->set_start_derivatives( p_join.qd[c]*d_tail, p_join.qdd[c]*d_tail*d_tail );
+		success &= splines[c]->interpolate( vias[c]->data(), vias[c]->size(), ( c < 3 ) ? knots_p : knots_r );
+		splines[c]->set_start_derivatives( 0.0, 0.0 );
+	}
+
+	TrajectorySnapshot& snapshot = snapshot_.back();
+
+	if( !success ||
+		!stitch_tail_.pack(spline_x_, spline_y_, spline_z_, spline_r_, d_tail) ||
+		!snapshot.trajectory.splice_at(current.trajectory, first, t_join, stitch_tail_) ) {
+		ROS_WARN( "Contrail: unable to join the new trajectory onto the current one (max_vias)" );
+		return false;
+	}
+
+	snapshot.continues = current.generation;
+	snapshot.start = current.start + ros::Duration( current.trajectory.get_knots()[first] );
+	snapshot.duration = ros::Duration( snapshot.trajectory.get_duration() );
+
+	return true;
+}
+
+void ContrailManager::prepare_tracking( TrajectorySnapshot& snapshot, const bool constant_speed, const params_t& params ) {
+	//All of the arc-length inversion is done here, not at control rate
+	snapshot.constant_speed = false;
+	if( constant_speed ) {
+		if( snapshot.arc_length.build(snapshot.trajectory, constant_speed_min_path_speed) ) {
+			snapshot.constant_speed = true;
+			snapshot.speed = snapshot.arc_length.get_length() / snapshot.duration.toSec();
+		} else {
+			ROS_WARN( "Contrail: path has no length, falling back to spline timing" );
+		}
+	}
+
+	//The search tree is built here, so each control step only queries it
+	snapshot.follow_path = false;
+	if( params.follow_path ) {
+		if( snapshot.closest.build(snapshot.trajectory) ) {
+			snapshot.follow_path = true;
+		} else {
+			ROS_WARN( "Contrail: unable to build the path search tree, falling back to spline timing" );
+		}
+	}
+}
+
+const ContrailManager::TrajectorySnapshot& ContrailManager::publish_snapshot( void ) {
+	//Only the goal callback publishes, so the generations can't be raced here
+	const uint32_t generation = published_generation_.load() + 1;
+	snapshot_.back().generation = generation;
+
+	const TrajectorySnapshot& published = snapshot_.publish();
+	published_generation_.store(generation);
+
+	return published;
+}
+
+void ContrailManager::update_tracking( void ) {
+	params_snapshot_.update();
+
+	if( snapshot_.update() ) {
+		const TrajectorySnapshot& snapshot = snapshot_.front();
+
+		if( ( snapshot.continues != 0 ) && ( snapshot.continues == tracking_generation_ ) ) {
+			//The joined trajectory matches the current one up to the join,
+			//so carry on from the same point, only shifted to its new start
+			const ros::Duration shift = snapshot.start - tracking_start_;
+
+			spline_start_ += shift;
+			follow_progress_ = std::max( follow_progress_ - shift.toSec(), 0.0 );
+		} else {
+			//Start tracking a new goal from scratch
+			spline_start_ = snapshot.start;
+			follow_progress_ = 0.0;
+			follow_last_tc_ = snapshot.start;
+		}
+
+		tracking_generation_ = snapshot.generation;
+		tracking_start_ = snapshot.start;
+		tracking_delay_.store( (spline_start_ - tracking_start_).toSec() );
+		spline_in_progress_ = true;
+		wait_reached_end_ = false;
+
+		trajectory_cursor_.reset(snapshot.trajectory);
+	}
+
+	//Preempts and clears apply to every goal published before them
+	if( tracking_generation_ <= clear_generation_.load() ) {
+		tracking_generation_ = 0;
+		spline_in_progress_ = false;
+		wait_reached_end_ = false;
+	} else if( tracking_generation_ <= preempt_generation_.load() ) {
+		spline_in_progress_ = false;
+		wait_reached_end_ = false;
+	}
+}
+
+bool ContrailManager::valid_knot_times( const std::vector<double>& times, const size_t num_positions ) {
+	bool valid = (times.size() == num_positions);
+
+	for(size_t i = 1; valid && (i < times.size()); i++)
+		valid = (times[i] > times[i-1]);
+
+	return valid;
+}
+
+contrail_spline_lib::packed_quintic_point_t ContrailManager::get_trajectory_reference( const TrajectorySnapshot& snapshot, const double t ) {
+	ROS_ASSERT_MSG((t >= 0.0) && (t <= snapshot.duration.toSec()), "Invalid time point given for trajectory lookup (0.0 <= t <= duration)");
+	ROS_ASSERT_MSG(snapshot.trajectory.is_valid(), "Invalid trajectory request (not initialized?)");
+
+	return trajectory_cursor_.lookup(t);
+}
+
+contrail_spline_lib::packed_quintic_point_t ContrailManager::get_constant_speed_reference( const TrajectorySnapshot& snapshot, const double t ) {
+	ROS_ASSERT_MSG(snapshot.arc_length.is_valid(), "Invalid arc-length request (not initialized?)");
+
+	//Trajectory time at which the path has covered the distance for t, and
+	//its derivatives from the same table, so the position, velocity, and
+	//acceleration all follow the same tau(t) (the speed floor in the table
+	//keeps them bounded where the path stops)
+	double dtds;
+	double d2tds2;
+	const double tau = snapshot.arc_length.lookup( snapshot.speed * t, dtds, d2tds2 );
+	contrail_spline_lib::packed_quintic_point_t ref = get_trajectory_reference(snapshot, tau);
+
+	//Chain rule with dtau/dt = speed*dtau/ds, and d2tau/dt2 = speed^2*d2tau/ds2
+	const double k = snapshot.speed * dtds;
+	const double kk = snapshot.speed * snapshot.speed * d2tds2;
+
+	const Eigen::Vector3d v(ref.qd[0], ref.qd[1], ref.qd[2]);
+	const Eigen::Vector3d a(ref.qdd[0], ref.qdd[1], ref.qdd[2]);
+
+	const Eigen::Vector3d vel = k*v;
+	const Eigen::Vector3d acc = k*k*a + kk*v;
+	const double rrate = k*ref.qd[3];
+	const double racc = k*k*ref.qdd[3] + kk*ref.qd[3];
+
+	for(int i=0; i<3; i++) {
+		ref.qd[i] = vel[i];
+		ref.qdd[i] = acc[i];
+	}
+
+	ref.qd[3] = rrate;
+	ref.qdd[3] = racc;
+
+	return ref;
+}
+
+void ContrailManager::follow_path( const TrajectorySnapshot& snapshot, const params_t& params, const ros::Time tc, const Eigen::Vector3d& pos_c ) {
+	//Trajectory time currently being referenced
+	const double t = (tc - spline_start_).toSec();
+	const double tau = snapshot.constant_speed ? snapshot.arc_length.lookup( snapshot.speed * t ) : t;
+
+	//Progress only moves forward, and is only searched for up to just past
+	//the reference, so it can't jump to another pass of a crossing path
+	contrail_spline_lib::closest_point_t closest;
+	if( snapshot.closest.query( pos_c.data(), follow_progress_, std::max(tau, follow_progress_) + params.follow_path_lookahead, closest ) )
+		follow_progress_ = closest.t;
+
+	//Delay the start by the time since the last step, pausing the reference
+	if( ( tau - follow_progress_ ) > params.follow_path_lookahead ) {
+		spline_start_ += tc - follow_last_tc_;
+		tracking_delay_.store( (spline_start_ - tracking_start_).toSec() );
+	}
+
+	follow_last_tc_ = tc;
 }
 
 double ContrailManager::yaw_error_shortest_path(const double y_sp, const double y) {
@@ -391,12 +1204,11 @@ double ContrailManager::yaw_error_shortest_path(const double y_sp, const double
 	return ye;
 }
 
-std::vector<double> ContrailManager::make_yaw_continuous( const std::vector<double>& yaw ) {
-	std::vector<double> cont_yaw;
-	cont_yaw.reserve( yaw.size() );
+void ContrailManager::make_yaw_continuous( const std::vector<double>& yaw, std::vector<double>& cont_yaw ) {
+	cont_yaw.resize( yaw.size() );
 
 	for(unsigned int i=0; i<yaw.size(); i++) {
-		cont_yaw.push_back(yaw[i]);
+		cont_yaw[i] = yaw[i];
 
 		if ( i >= 1) {
 			while(fabs(cont_yaw[i] - cont_yaw[i-1]) > M_PI) {
@@ -408,66 +1220,102 @@ std::vector<double> ContrailManager::make_yaw_continuous( const std::vector<doub
 			}
 		}
 	}
-
-	return cont_yaw;
 }
 
-void ContrailManager::publish_approx_spline( const ros::Time& stamp ) {
-	nav_msgs::Path msg_out;
-
-	msg_out.header.frame_id = param_frame_id_;
-	msg_out.header.stamp = stamp;
+void ContrailManager::publish_approx_spline( const ros::Time& stamp, const TrajectorySnapshot& snapshot, const params_t& params ) {
+	//Only the trajectory is copied here (a mapped trajectory file is shared
+	//rather than read in), the sampling is left to the worker
+	VisualisationJob& job = visual_jobs_.back();
 
-	int num_points = spline_duration_.toSec() * param_spline_approx_res_;
-	ros::Time t = spline_start_;
-	ros::Duration dt = ros::Duration(spline_duration_.toSec() / num_points);
-	int i = 0;
-	for(int i=0; i<(num_points+1); i++) {
-		//Reticulate the data of the current time
-		double u = normalize(i,0,num_points);
-		contrail_spline_lib::quintic_spline_point_t x = spline_x_.lookup(u);
-		contrail_spline_lib::quintic_spline_point_t y = spline_y_.lookup(u);
-		contrail_spline_lib::quintic_spline_point_t z = spline_z_.lookup(u);
-		contrail_spline_lib::quintic_spline_point_t yaw = spline_r_.lookup(u);
+	if( !job.trajectory.assign(snapshot.trajectory) ) {
+		ROS_WARN( "Contrail: unable to copy the trajectory for visualisation (max_vias)" );
+		return;
+	}
 
-		geometry_msgs::PoseStamped p;
-		p.header.frame_id = msg_out.header.frame_id;
-		p.header.stamp = t;
-		p.header.seq = i;
+	job.stamp = stamp;
+	job.start = snapshot.start;
+	job.frame_id = params.frame_id;
+	job.tolerance.tolerance = params.spline_approx_tolerance;
+	job.tolerance.max_angle = params.spline_approx_max_angle;
+	job.tolerance.min_dt = ( params.spline_approx_res > 0 ) ? 1.0 / params.spline_approx_res : 0.0;
 
-		p.pose.position.x = x.q;
-		p.pose.position.y = y.q;
-		p.pose.position.z = z.q;
-		p.pose.orientation = quaternion_from_eig(quaternion_from_yaw(yaw.q));
+	visual_jobs_.publish();
 
-		msg_out.poses.push_back(p);
+	bool post = false;
+	{
+		std::lock_guard<std::mutex> lock(visual_mutex_);
+		visual_pending_ = true;
 
-		t += dt;
+		//A job that is already posted will pick this one up before it finishes
+		if( ( workers_ != NULL ) && !visual_posted_ ) {
+			visual_posted_ = true;
+			post = true;
+		}
 	}
 
-	pub_spline_approx_.publish(msg_out);
+	if( workers_ == NULL ) {
+		visual_cv_.notify_one();
+	} else if( post ) {
+		workers_->post( boost::bind(&ContrailManager::run_visualisation_posted, this) );
+	}
 }
 
 void ContrailManager::publish_spline_points( const ros::Time& stamp,
+											 const TrajectorySnapshot& snapshot,
+											 const params_t& params,
 											 const std::vector<geometry_msgs::Vector3>& pos,
 											 const std::vector<double>& yaw ) {
 	nav_msgs::Path msg_out;
 
 	msg_out.header.stamp = stamp;
-	msg_out.header.frame_id = param_frame_id_;
+	msg_out.header.frame_id = params.frame_id;
 
-	double dt = spline_duration_.toSec() / (pos.size() - 1);
+	//Stamp each point with the time it will be reached
+	const std::vector<double>& knots = spline_x_.get_knots();
 
 	for(int i=0; i<pos.size(); i++) {
+		double t = snapshot.duration.toSec()*knots[i];
+
 		geometry_msgs::PoseStamped p;
 		p.header.frame_id = msg_out.header.frame_id;
-		p.header.stamp = spline_start_ + ros::Duration(dt*i);
+		p.header.stamp = snapshot.start + ros::Duration(t);
 		p.header.seq = i;
 
 		p.pose.position.x = pos[i].x;
 		p.pose.position.y = pos[i].y;
 		p.pose.position.z = pos[i].z;
-		p.pose.orientation = quaternion_from_eig(quaternion_from_yaw(yaw[i]));
+
+		//Yaw may have a different number of vias, if so sample the trajectory instead
+		double r = ( yaw.size() == pos.size() ) ? yaw[i] : snapshot.trajectory.lookup(t).q[3];
+		p.pose.orientation = quaternion_from_eig(quaternion_from_yaw(r));
+
+		msg_out.poses.push_back(p);
+	}
+
+	pub_spline_points_.publish(msg_out);
+}
+
+void ContrailManager::publish_trajectory_knots( const ros::Time& stamp, const TrajectorySnapshot& snapshot, const params_t& params ) {
+	nav_msgs::Path msg_out;
+
+	msg_out.header.stamp = stamp;
+	msg_out.header.frame_id = params.frame_id;
+
+	const double* knots = snapshot.trajectory.get_knots();
+	msg_out.poses.reserve(snapshot.trajectory.get_num_segments() + 1);
+
+	for(size_t i=0; i<=snapshot.trajectory.get_num_segments(); i++) {
+		const contrail_spline_lib::packed_quintic_point_t point = snapshot.trajectory.lookup(knots[i]);
+
+		geometry_msgs::PoseStamped p;
+		p.header.frame_id = msg_out.header.frame_id;
+		p.header.stamp = snapshot.start + ros::Duration(knots[i]);
+		p.header.seq = i;
+
+		p.pose.position.x = point.q[0];
+		p.pose.position.y = point.q[1];
+		p.pose.position.z = point.q[2];
+		p.pose.orientation = quaternion_from_eig(quaternion_from_yaw(point.q[3]));
 
 		msg_out.poses.push_back(p);
 	}
@@ -475,8 +1323,8 @@ void ContrailManager::publish_spline_points( const ros::Time& stamp,
 	pub_spline_points_.publish(msg_out);
 }
 
-bool ContrailManager::check_endpoint_reached( const Eigen::Vector3d& pos_s, const double yaw_s, const Eigen::Vector3d& pos_c, const double yaw_c ) {
-	return ( (radial_dist(pos_s, pos_c) < param_end_position_accuracy_) && (yaw_error_shortest_path(yaw_s, yaw_c) < param_end_yaw_accuracy_) );
+bool ContrailManager::check_endpoint_reached( const params_t& params, const Eigen::Vector3d& pos_s, const double yaw_s, const Eigen::Vector3d& pos_c, const double yaw_c ) {
+	return ( (radial_dist(pos_s, pos_c) < params.end_position_accuracy) && (yaw_error_shortest_path(yaw_s, yaw_c) < params.end_yaw_accuracy) );
 }
 
 double ContrailManager::radial_dist( const Eigen::Vector3d& a, const Eigen::Vector3d& b ) {
@@ -0,0 +1,185 @@
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include <contrail_manager/MultiGuidance.h>
+
+#include <nav_msgs/Odometry.h>
+#include <mavros_msgs/PositionTarget.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+
+#include <eigen3/Eigen/Dense>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+
+static std::vector<std::string> load_vehicles( const ros::NodeHandle& nhp ) {
+	std::vector<std::string> vehicles;
+
+	if( !nhp.getParam( "vehicles", vehicles ) || vehicles.empty() )
+		ROS_WARN("Multi-guidance: no vehicles set (~vehicles)");
+
+	return vehicles;
+}
+
+//=======================
+// Public
+//=======================
+
+MultiGuidance::Vehicle::Vehicle( const std::string& vehicle_name, const ros::NodeHandle& nh, WorkerPool& workers, ros::CallbackQueue& control_queue ) :
+	name(vehicle_name),
+	current_g(Eigen::Affine3d::Identity()),
+	odom_stamp(0),
+	ref_path(nh, workers) {
+
+	ros::NodeHandle nh_control(nh);
+	nh_control.setCallbackQueue(&control_queue);
+
+	sub_state_odometry = nh_control.subscribe<nav_msgs::Odometry>( "state/odom", 10, &Vehicle::callback_odom, this );
+
+	pub_output_triplet = nh_control.advertise<mavros_msgs::PositionTarget>( "command/triplet", 10 );
+	pub_output_position = nh_control.advertise<geometry_msgs::PoseStamped>( "feedback/pose", 10 );
+	pub_output_velocity = nh_control.advertise<geometry_msgs::TwistStamped>( "feedback/twist", 10 );
+}
+
+void MultiGuidance::Vehicle::callback_odom( const nav_msgs::Odometry::ConstPtr& msg_in ) {
+	odom_stamp = msg_in->header.stamp;
+
+	current_g.translation() = Eigen::Vector3d(msg_in->pose.pose.position.x,
+											  msg_in->pose.pose.position.y,
+											  msg_in->pose.pose.position.z);
+
+	current_g.linear() = Eigen::Quaterniond(msg_in->pose.pose.orientation.w,
+											msg_in->pose.pose.orientation.x,
+											msg_in->pose.pose.orientation.y,
+											msg_in->pose.pose.orientation.z).normalized().toRotationMatrix();
+}
+
+MultiGuidance::MultiGuidance( void ) :
+	nh_(),
+	nhp_("~"),
+	param_rate_( nhp_.param( "update_rate", 50.0 ) ),
+	param_do_feedback_( nhp_.param( "do_feedback", false ) ),
+	param_vehicles_( load_vehicles(nhp_) ),
+	workers_( std::max( nhp_.param( "worker_threads", (int)std::thread::hardware_concurrency() ), 1 ) ),
+	control_spinner_( 1, &control_queue_ ),
+	outputs_( param_vehicles_.size() ),
+	outputs_posted_(false) {
+
+	//Each vehicle has the same interface as a guidance node in its namespace
+	const std::string node_name = nhp_.param<std::string>( "vehicle_node_name", "guidance" );
+
+	vehicles_.reserve( param_vehicles_.size() );
+	for(size_t i=0; i<param_vehicles_.size(); i++) {
+		ros::NodeHandle nh_vehicle( nh_, param_vehicles_[i] + "/" + node_name );
+		nh_vehicle.setCallbackQueue( workers_.queue() );
+
+		vehicles_.emplace_back( new Vehicle( param_vehicles_[i], nh_vehicle, workers_, control_queue_ ) );
+	}
+
+	ros::NodeHandle nh_control(nhp_);
+	nh_control.setCallbackQueue(&control_queue_);
+	timer_ = nh_control.createTimer( ros::Duration( 1.0 / param_rate_ ), &MultiGuidance::callback_timer, this );
+
+	control_spinner_.start();
+
+	ROS_INFO("Started multi-guidance node for %lu vehicles, waiting for inputs", vehicles_.size());
+}
+
+MultiGuidance::~MultiGuidance( void ) {
+	timer_.stop();
+	control_spinner_.stop();
+
+	//Nothing is left running (or queued) for the vehicles once the workers stop
+	workers_.stop();
+}
+
+//=======================
+// Private
+//=======================
+
+void MultiGuidance::callback_timer( const ros::TimerEvent& e ) {
+	std::vector<vehicle_output_t>& outputs = outputs_.back();
+
+	//Every vehicle is tracked for the same time, one after another. Nothing
+	//here waits on the goal callbacks (the feedback and results are only
+	//queued, and sent by publish_outputs()), so a goal being solved for one
+	//vehicle never holds up the others
+	for(size_t i=0; i<vehicles_.size(); i++) {
+		Vehicle& vehicle = *vehicles_[i];
+		vehicle_output_t& output = outputs[i];
+
+		//Quick check to ensure our odom is relatively recent
+		//  and that we have a reference
+		output.has_output = ( (e.current_real - vehicle.odom_stamp) < ros::Duration(5/param_rate_) ) &&
+							vehicle.ref_path.has_reference(e.current_real);
+
+		if( !output.has_output )
+			continue;
+
+		vehicle.ref_path.get_reference(output.triplet, e.current_real, vehicle.current_g);
+
+		if(param_do_feedback_)
+			make_feedback(vehicle, output);
+	}
+
+	outputs_.publish();
+
+	//A job that is already posted will pick these up when it runs
+	if( !outputs_posted_.exchange(true) )
+		workers_.post( boost::bind(&MultiGuidance::publish_outputs, this) );
+}
+
+void MultiGuidance::publish_outputs( void ) {
+	//Cleared first, so any outputs published after this are sure to get a job of their own
+	outputs_posted_ = false;
+
+	std::lock_guard<std::mutex> lock(outputs_mutex_);
+
+	if( outputs_.update() ) {
+		const std::vector<vehicle_output_t>& outputs = outputs_.front();
+
+		for(size_t i=0; i<vehicles_.size(); i++) {
+			if( !outputs[i].has_output )
+				continue;
+
+			vehicles_[i]->pub_output_triplet.publish(outputs[i].triplet);
+
+			if(param_do_feedback_) {
+				vehicles_[i]->pub_output_position.publish(outputs[i].pose);
+				vehicles_[i]->pub_output_velocity.publish(outputs[i].twist);
+			}
+		}
+	}
+
+	//Feedback and results, only ever sent from one worker at a time (under the mutex)
+	for(size_t i=0; i<vehicles_.size(); i++)
+		vehicles_[i]->ref_path.publish_feedback();
+}
+
+void MultiGuidance::make_feedback( const Vehicle& vehicle, vehicle_output_t& output ) {
+	const mavros_msgs::PositionTarget& traj = output.triplet;
+	geometry_msgs::PoseStamped& p = output.pose;
+	geometry_msgs::TwistStamped& t = output.twist;
+
+	p.header = traj.header;
+	t.header = traj.header;
+
+	p.pose.position = traj.position;
+	Eigen::Quaterniond q(Eigen::AngleAxisd(traj.yaw, Eigen::Vector3d::UnitZ()));
+	p.pose.orientation.w = q.w();
+	p.pose.orientation.x = q.x();
+	p.pose.orientation.y = q.y();
+	p.pose.orientation.z = q.z();
+
+	Eigen::Vector3d bv = vehicle.current_g.linear().inverse()*Eigen::Vector3d(traj.velocity.x, traj.velocity.y, traj.velocity.z);
+	t.twist.linear.x = bv.x();
+	t.twist.linear.y = bv.y();
+	t.twist.linear.z = bv.z();
+	t.twist.angular.x = 0.0;
+	t.twist.angular.y = 0.0;
+	t.twist.angular.z = traj.yaw_rate;
+}
@@ -0,0 +1,57 @@
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+
+#include <contrail_manager/WorkerPool.h>
+
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+
+//Wraps a job so it can be run from the callback queue
+class PostedJob : public ros::CallbackInterface {
+	private:
+		boost::function<void(void)> job_;
+
+	public:
+		explicit PostedJob( const boost::function<void(void)>& job ) :
+			job_(job) {
+		}
+
+		virtual CallResult call( void ) {
+			job_();
+
+			return Success;
+		}
+};
+
+//=======================
+// Public
+//=======================
+
+WorkerPool::WorkerPool( const uint32_t num_threads ) :
+	spinner_( std::max( num_threads, (uint32_t)1 ), &queue_ ),
+	is_running_(true) {
+
+	spinner_.start();
+}
+
+WorkerPool::~WorkerPool( void ) {
+	stop();
+}
+
+void WorkerPool::post( const boost::function<void(void)>& job ) {
+	//Dropped by the queue once it has been disabled
+	queue_.addCallback( boost::make_shared<PostedJob>(job) );
+}
+
+void WorkerPool::stop( void ) {
+	if( !is_running_ )
+		return;
+
+	is_running_ = false;
+
+	queue_.disable();
+	spinner_.stop();
+	queue_.clear();
+}
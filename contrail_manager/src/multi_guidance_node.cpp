@@ -0,0 +1,12 @@
+#include <ros/ros.h>
+#include <contrail_manager/MultiGuidance.h>
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "multi_guidance");
+	MultiGuidance mg;
+
+	//Everything else runs on the control thread and the workers
+	ros::spin();
+
+	return 0;
+}
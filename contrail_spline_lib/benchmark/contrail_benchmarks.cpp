@@ -0,0 +1,1608 @@
+#include <benchmark/benchmark.h>
+
+#include <contrail_spline_lib/common_spline_solver.h>
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/quintic_spline_solver.h>
+#include <contrail_spline_lib/interpolated_quintic_spline.h>
+#include <contrail_spline_lib/streaming_quintic_spline.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/packed_quintic_cursor.h>
+#include <contrail_spline_lib/trajectory_file.h>
+#include <contrail_spline_lib/closest_point_tree.h>
+#include <contrail_spline_lib/trajectory_geofence.h>
+#include <contrail_spline_lib/trajectory_sampling.h>
+#include <contrail_spline_lib/polynomial_roots.h>
+#include <contrail_spline_lib/trajectory_limits.h>
+#include <contrail_spline_lib/arc_length_table.h>
+
+#include "reference_quintic_spline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace contrail_spline_lib;
+using namespace contrail_benchmarks;
+
+// Benchmarks for the spline library hot paths
+//
+// Before timing, each benchmark checks its results against the reference
+// implementation (reference_quintic_spline.h), and reports the worst
+// relative error as the "max_err" counter. A benchmark that exceeds the
+// tolerance is skipped with an error, so optimisations that lose accuracy
+// show up as failures rather than as speedups.
+
+//The rounding error of the normalised time within a segment grows with
+//the number of segments, so the tolerance is allowed to grow with it
+static const double max_relative_error = 1e-8;
+static const double max_relative_error_per_via = 1e-12;
+static const size_t num_samples = 1024;
+
+//Smooth, but not trivially regular, test data
+static std::vector<double> make_vias( const size_t n, const double phase ) {
+	std::vector<double> vias(n);
+	for(size_t i = 0; i < n; i++)
+		vias[i] = 3.0*std::sin(0.7*i + phase) + 0.01*i;
+
+	return vias;
+}
+
+//Deterministic pseudo-random samples in [0, 1)
+static std::vector<double> make_samples( const size_t n ) {
+	std::vector<double> u(n);
+	unsigned int s = 12345;
+	for(size_t i = 0; i < n; i++) {
+		s = s*1103515245u + 12345u;
+		u[i] = ( (s >> 8) & 0xFFFFFF ) / 16777216.0;
+	}
+
+	return u;
+}
+
+//Records the error, and skips the benchmark if it is over the tolerance
+static bool check_error( benchmark::State& state, const double err, const size_t num_vias = 0,
+						 const double tolerance = max_relative_error ) {
+	state.counters["max_err"] = err;
+
+	if( !( err <= std::max( tolerance, max_relative_error_per_via*num_vias ) ) ) {
+		state.SkipWithError("result does not match the reference implementation");
+		return false;
+	}
+
+	return true;
+}
+
+//Worst error of spline lookups against the reference over some samples
+static double spline_error( InterpolatedQuinticSpline& spline, const std::vector<double>& u ) {
+	const std::vector<double>& knots = spline.get_knots();
+	const Eigen::Map<const Eigen::VectorXd> q = spline.get_vias();
+	const Eigen::Map<const Eigen::VectorXd> qd = spline.get_dvias();
+	const Eigen::Map<const Eigen::VectorXd> qdd = spline.get_ddvias();
+
+	double err = 0.0;
+	for(size_t i = 0; i < u.size(); i++) {
+		const quintic_spline_point_t r = reference_spline_lookup(u[i], knots, q.data(), qd.data(), qdd.data());
+		err = std::max( err, reference_error(spline.lookup(u[i]), r) );
+	}
+
+	//The spline must also pass through every via (checked at up to num_samples knots)
+	const size_t step = std::max( knots.size() / num_samples, (size_t)1 );
+	for(size_t i = 0; i < knots.size(); i += step)
+		err = std::max( err, std::fabs( spline.lookup(knots[i]).q - q[i] ) / ( 1.0 + std::fabs(q[i]) ) );
+
+	return err;
+}
+
+//=======================
+// Interpolation
+//=======================
+
+static void BM_Interpolate( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const std::vector<double> vias = make_vias(n, 0.0);
+
+	InterpolatedQuinticSpline spline(n);
+	spline.set_mode( (interpolation_mode_t)state.range(1) );
+
+	if( !spline.interpolate(vias.data(), n) ) {
+		state.SkipWithError("interpolation failed");
+		return;
+	}
+
+	if( !check_error( state, spline_error( spline, make_samples(num_samples) ), n ) )
+		return;
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize( spline.interpolate(vias.data(), n) );
+
+	state.SetItemsProcessed( state.iterations()*n );
+}
+BENCHMARK(BM_Interpolate)->ArgNames({"vias", "mode"})->RangeMultiplier(8)->Ranges({{2, 1 << 20}, {INTERPOLATION_LINEAR_EST, INTERPOLATION_MIN_JERK}});
+
+//=======================
+// Streaming
+//=======================
+
+// Vias streamed through a sliding window, a few windows' worth, retiring
+// the head whenever the window is full. The window only ever re-solves the
+// segments next to the tail, so after every append it is checked against a
+// batch interpolation of every via streamed so far (with the same knots),
+// over the segments still in the window.
+static const size_t streaming_windows = 3;
+static const size_t streaming_checks = 8;	//Lookups per segment in the window
+
+//Uneven knot spacing, so the window isn't only checked on a uniform grid
+static double streaming_knot( const size_t i ) {
+	return i + 0.3*std::sin(1.3*i);
+}
+
+static double streaming_error( const size_t capacity ) {
+	const size_t n = streaming_windows*capacity;
+	const std::vector<double> vias = make_vias(n, 0.0);
+
+	std::vector<double> knots(n);
+	for(size_t i = 0; i < n; i++)
+		knots[i] = streaming_knot(i);
+
+	StreamingQuinticSpline stream(capacity);
+	InterpolatedQuinticSpline batch(n);
+
+	double err = 0.0;
+	for(size_t k = 0; k < n; k++) {
+		if( stream.is_full() )
+			stream.retire();
+
+		if( !stream.append(vias[k], knots[k]) )
+			return std::numeric_limits<double>::infinity();
+
+		if( !stream.is_valid() )
+			continue;
+
+		if( !batch.interpolate(vias.data(), k + 1, knots.data()) )
+			return std::numeric_limits<double>::infinity();
+
+		//The batch spline is looked up in normalised time
+		const double duration = knots[k] - knots[0];
+		const size_t num = stream.get_num_segments()*streaming_checks;
+
+		for(size_t i = 0; i <= num; i++) {
+			const double t = stream.get_start_time() + ( stream.get_end_time() - stream.get_start_time() )*i / num;
+
+			quintic_spline_point_t r = batch.lookup( (t - knots[0]) / duration );
+			r.qd /= duration;
+			r.qdd /= duration*duration;
+
+			err = std::max( err, reference_error(stream.lookup(t), r) );
+		}
+	}
+
+	return err;
+}
+
+static void BM_StreamingAppend( benchmark::State& state ) {
+	const size_t capacity = state.range(0);
+
+	if( !check_error( state, streaming_error(capacity), streaming_windows*capacity ) )
+		return;
+
+	//Steady state, each via appended retires the oldest one
+	const std::vector<double> vias = make_vias(num_samples, 0.0);
+	StreamingQuinticSpline stream(capacity);
+	size_t k = 0;
+
+	for(auto _ : state) {
+		if( stream.is_full() )
+			stream.retire();
+
+		stream.append(vias[k % num_samples], streaming_knot(k));
+		k++;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_StreamingAppend)->ArgName("window")->RangeMultiplier(8)->Range(8, 1 << 9);
+
+//=======================
+// Lookups
+//=======================
+
+//Lookups at non-finite times must not read outside the spline, infinite
+//times must hold at the ends, and NaN must be looked up at the start, both
+//alone and in a batch (every lane of a full SIMD block, and the remainder)
+static double spline_non_finite_error( InterpolatedQuinticSpline& spline ) {
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	const double inf = std::numeric_limits<double>::infinity();
+	const double u[7] = { nan, inf, -inf, nan, inf, nan, -inf };
+	quintic_spline_point_t out[7];
+
+	spline.lookup_batch(u, 7, out);
+
+	double err = 0.0;
+	for(size_t i = 0; i < 7; i++) {
+		const quintic_spline_point_t p = spline.lookup(u[i]);
+		const quintic_spline_point_t r = spline.lookup( ( u[i] > 0.0 ) ? 1.0 : 0.0 );
+
+		//std::max() would drop a NaN error
+		if( !std::isfinite(p.q + p.qd + p.qdd) || !std::isfinite(out[i].q + out[i].qd + out[i].qdd) )
+			return HUGE_VAL;
+
+		err = std::max( err, std::max( reference_error(p, r), reference_error(out[i], r) ) );
+	}
+
+	return err;
+}
+
+static void BM_Lookup( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const std::vector<double> vias = make_vias(n, 0.0);
+	const std::vector<double> u = make_samples(num_samples);
+
+	InterpolatedQuinticSpline spline;
+	spline.interpolate(vias.data(), n);
+
+	if( !check_error( state, std::max( spline_error(spline, u), spline_non_finite_error(spline) ), n ) )
+		return;
+
+	size_t i = 0;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( spline.lookup(u[i]) );
+		i = (i + 1) % num_samples;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_Lookup)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 18);
+
+static void BM_LookupBatch( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const std::vector<double> vias = make_vias(n, 0.0);
+	const std::vector<double> u = make_samples(num_samples);
+	std::vector<quintic_spline_point_t> out(num_samples);
+
+	InterpolatedQuinticSpline spline;
+	spline.interpolate(vias.data(), n);
+
+	//Batched results must match the reference too
+	spline.lookup_batch(u.data(), num_samples, out.data());
+
+	double err = std::max( spline_error(spline, u), spline_non_finite_error(spline) );
+	for(size_t i = 0; i < num_samples; i++)
+		err = std::max( err, reference_error( out[i], spline.lookup(u[i]) ) );
+
+	//Uneven knots are located by a search rather than by index
+	std::vector<double> knots(n);
+	for(size_t i = 0; i < n; i++)
+		knots[i] = i + 0.3*std::sin(1.3*i);
+
+	InterpolatedQuinticSpline knotted;
+	knotted.interpolate(vias.data(), n, knots.data());
+	err = std::max( err, spline_non_finite_error(knotted) );
+
+	if( !check_error(state, err, n) )
+		return;
+
+	for(auto _ : state) {
+		spline.lookup_batch(u.data(), num_samples, out.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed( state.iterations()*num_samples );
+}
+BENCHMARK(BM_LookupBatch)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 18);
+
+//=======================
+// Segment solver
+//=======================
+
+typedef struct {
+	double q0;
+	double qd0;
+	double qdd0;
+	double qf;
+	double qdf;
+	double qddf;
+} boundary_conditions_t;
+
+static std::vector<boundary_conditions_t> make_conditions( void ) {
+	const std::vector<double> r = make_samples(6*num_samples);
+	std::vector<boundary_conditions_t> bc(num_samples);
+
+	for(size_t i = 0; i < num_samples; i++) {
+		bc[i].q0 = 10.0*r[6*i] - 5.0;
+		bc[i].qd0 = 4.0*r[6*i + 1] - 2.0;
+		bc[i].qdd0 = 2.0*r[6*i + 2] - 1.0;
+		bc[i].qf = 10.0*r[6*i + 3] - 5.0;
+		bc[i].qdf = 4.0*r[6*i + 4] - 2.0;
+		bc[i].qddf = 2.0*r[6*i + 5] - 1.0;
+	}
+
+	return bc;
+}
+
+static double solver_error( const quintic_spline_coeffs_t& c, const quintic_spline_coeffs_t& r ) {
+	const double a[6] = {c.a1, c.a2, c.a3, c.a4, c.a5, c.a6};
+	const double b[6] = {r.a1, r.a2, r.a3, r.a4, r.a5, r.a6};
+
+	double err = 0.0;
+	for(size_t k = 0; k < 6; k++)
+		err = std::max( err, std::fabs(a[k] - b[k]) / ( 1.0 + std::fabs(b[k]) ) );
+
+	return err;
+}
+
+static void BM_Solver( benchmark::State& state ) {
+	const std::vector<boundary_conditions_t> bc = make_conditions();
+	QuinticSplineSolver solver;
+
+	double err = 0.0;
+	for(size_t i = 0; i < num_samples; i++) {
+		const boundary_conditions_t& b = bc[i];
+		err = std::max( err, solver_error( solver.solver(b.q0, b.qd0, b.qdd0, b.qf, b.qdf, b.qddf),
+										   reference_solver(b.q0, b.qd0, b.qdd0, b.qf, b.qdf, b.qddf) ) );
+	}
+
+	if( !check_error(state, err) )
+		return;
+
+	size_t i = 0;
+	for(auto _ : state) {
+		const boundary_conditions_t& b = bc[i];
+		benchmark::DoNotOptimize( solver.solver(b.q0, b.qd0, b.qdd0, b.qf, b.qdf, b.qddf) );
+		i = (i + 1) % num_samples;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_Solver);
+
+//Baseline for BM_Solver (general 6x6 solve)
+static void BM_ReferenceSolver( benchmark::State& state ) {
+	const std::vector<boundary_conditions_t> bc = make_conditions();
+
+	size_t i = 0;
+	for(auto _ : state) {
+		const boundary_conditions_t& b = bc[i];
+		benchmark::DoNotOptimize( reference_solver(b.q0, b.qd0, b.qdd0, b.qf, b.qdf, b.qddf) );
+		i = (i + 1) % num_samples;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_ReferenceSolver);
+
+static void BM_SolverBatch( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const std::vector<double> q = make_vias(n, 0.0);
+	const std::vector<double> qd = make_vias(n, 1.0);
+	const std::vector<double> qdd = make_vias(n, 2.0);
+	std::vector<quintic_spline_coeffs_t> coeffs(n - 1);
+
+	QuinticSplineSolver solver;
+	solver.solver_batch(q.data(), qd.data(), qdd.data(), n, coeffs.data());
+
+	double err = 0.0;
+	const size_t step = std::max( (n - 1) / num_samples, (size_t)1 );
+	for(size_t i = 0; i < (n - 1); i += step)
+		err = std::max( err, solver_error( coeffs[i], reference_solver(q[i], qd[i], qdd[i], q[i+1], qd[i+1], qdd[i+1]) ) );
+
+	if( !check_error(state, err) )
+		return;
+
+	for(auto _ : state) {
+		solver.solver_batch(q.data(), qd.data(), qdd.data(), n, coeffs.data());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed( state.iterations()*(n - 1) );
+}
+BENCHMARK(BM_SolverBatch)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 18);
+
+//=======================
+// Generic segment solver
+//=======================
+
+// The generic (header-only) solver is checked at every order, by solving a
+// spline with uneven segment durations, and checking that each segment
+// meets its via (and the derivatives set there) at both ends.
+
+template<std::size_t N>
+static double common_spline_error( const normalised_spline_t<N>& spline ) {
+	double err = 0.0;
+
+	for(size_t i = 0; i < spline.size(); i++) {
+		const spline_via_t<N> q0 = normalised_spline_lookup(spline[i], 0.0);
+		const spline_via_t<N> qf = normalised_spline_lookup(spline[i], 1.0);
+
+		for(size_t k = 0; k < N; k++) {
+			err = std::max( err, std::fabs(q0[k] - spline[i].start[k]) / ( 1.0 + std::fabs(spline[i].start[k]) ) );
+			err = std::max( err, std::fabs(qf[k] - spline[i].end[k]) / ( 1.0 + std::fabs(spline[i].end[k]) ) );
+		}
+	}
+
+	return err;
+}
+
+template<std::size_t N>
+static void BM_CommonSplineSolver( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const std::vector<double> r = make_samples(n);
+
+	//Via values and derivatives, each derivative level out of phase
+	std::vector< spline_via_t<N> > vias(n);
+	for(size_t k = 0; k < N; k++) {
+		const std::vector<double> q = make_vias(n, 1.0*k);
+		for(size_t i = 0; i < n; i++)
+			vias[i][k] = q[i];
+	}
+
+	normalised_spline_t<N> spline(n - 1);
+	for(size_t i = 0; i < (n - 1); i++) {
+		spline[i].start = vias[i];
+		spline[i].end = vias[i+1];
+		spline[i].duration = 0.5 + r[i];
+	}
+
+	normalised_spline_solver(spline);
+
+	if( !check_error( state, common_spline_error(spline), n ) )
+		return;
+
+	for(auto _ : state) {
+		normalised_spline_solver(spline);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed( state.iterations()*(n - 1) );
+}
+BENCHMARK_TEMPLATE(BM_CommonSplineSolver, dim_sys_cubic/2)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK_TEMPLATE(BM_CommonSplineSolver, dim_sys_quintic/2)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK_TEMPLATE(BM_CommonSplineSolver, dim_sys_septic/2)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 12);
+BENCHMARK_TEMPLATE(BM_CommonSplineSolver, dim_sys_nonic/2)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 12);
+
+//=======================
+// Four-axis reference (manager control loop)
+//=======================
+
+// The manager looks up a position/yaw reference every control step, with
+// time increasing steadily through the trajectory. These compare the
+// per-axis splines, the packed trajectory, and the cursor over it.
+
+static const double control_dt = 0.02;
+
+typedef struct {
+	InterpolatedQuinticSpline axes[packed_channels];
+	PackedQuinticTrajectory trajectory;
+	double duration;
+	double offset[packed_channels];	//Added to each axis, e.g. to fly far from the origin
+} four_axis_fixture_t;
+
+//The path is moved by "offset" in x and y
+static void make_four_axis( four_axis_fixture_t& f, const size_t n, const double offset = 0.0 ) {
+	f.duration = 1.0*n;
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		f.offset[c] = ( c < 2 ) ? offset : 0.0;
+
+		std::vector<double> vias = make_vias(n, 0.5*c);
+		for(size_t i = 0; i < n; i++)
+			vias[i] += f.offset[c];
+
+		f.axes[c].interpolate(vias.data(), n);
+	}
+
+	f.trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration);
+}
+
+//Worst error of a packed point at t against the per-axis reference (the
+//positions are compared relative to the offset, so the errors far from
+//the origin are not hidden by the size of the positions)
+static double four_axis_error( four_axis_fixture_t& f, const double t, const packed_quintic_point_t& p ) {
+	double err = 0.0;
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		const std::vector<double>& knots = f.axes[c].get_knots();
+		quintic_spline_point_t r = reference_spline_lookup( t / f.duration, knots, f.axes[c].get_vias().data(),
+															f.axes[c].get_dvias().data(), f.axes[c].get_ddvias().data() );
+		r.q -= f.offset[c];
+		r.qd /= f.duration;
+		r.qdd /= f.duration*f.duration;
+
+		const quintic_spline_point_t pc = {p.q[c] - f.offset[c], p.qd[c], p.qdd[c]};
+		err = std::max( err, reference_error(pc, r) );
+	}
+
+	return err;
+}
+
+//One lookup per axis, denormalised to seconds
+static packed_quintic_point_t four_axis_separate_lookup( four_axis_fixture_t& f, const double t ) {
+	const double inv_d = 1.0 / f.duration;
+
+	packed_quintic_point_t p;
+	for(size_t c = 0; c < packed_channels; c++) {
+		const quintic_spline_point_t pc = f.axes[c].lookup(t * inv_d);
+		p.q[c] = pc.q;
+		p.qd[c] = pc.qd * inv_d;
+		p.qdd[c] = pc.qdd * inv_d*inv_d;
+	}
+
+	return p;
+}
+
+static void BM_FourAxisSeparate( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, four_axis_separate_lookup(f, t) ) );
+
+	if( !check_error(state, err) )
+		return;
+
+	double t = 0.0;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( four_axis_separate_lookup(f, t) );
+
+		t += control_dt;
+		if( t > f.duration )
+			t = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_FourAxisSeparate)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 15);
+
+//Worst difference between two packed points
+static double packed_point_difference( const packed_quintic_point_t& a, const packed_quintic_point_t& b ) {
+	double err = 0.0;
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		err = std::max( err, std::fabs(a.q[c] - b.q[c]) );
+		err = std::max( err, std::fabs(a.qd[c] - b.qd[c]) );
+		err = std::max( err, std::fabs(a.qdd[c] - b.qdd[c]) );
+	}
+
+	return err;
+}
+
+//Lookups at non-finite times must not read outside the trajectory, and
+//infinite times must hold at the ends (NaN only has to return)
+static double four_axis_non_finite_error( four_axis_fixture_t& f ) {
+	benchmark::DoNotOptimize( f.trajectory.lookup( std::numeric_limits<double>::quiet_NaN() ) );
+
+	return std::max( packed_point_difference( f.trajectory.lookup( std::numeric_limits<double>::infinity() ), f.trajectory.lookup(f.duration) ),
+					 packed_point_difference( f.trajectory.lookup( -std::numeric_limits<double>::infinity() ), f.trajectory.lookup(0.0) ) );
+}
+
+static void BM_FourAxisPacked( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	double err = four_axis_non_finite_error(f);
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, f.trajectory.lookup(t) ) );
+
+	if( !check_error(state, err) )
+		return;
+
+	double t = 0.0;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( f.trajectory.lookup(t) );
+
+		t += control_dt;
+		if( t > f.duration )
+			t = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_FourAxisPacked)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 15);
+
+static void BM_FourAxisCursor( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	PackedQuinticCursor cursor;
+	cursor.reset(f.trajectory);
+
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, cursor.lookup(t) ) );
+
+	if( !check_error(state, err) )
+		return;
+
+	double t = 0.0;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( cursor.lookup(t) );
+
+		t += control_dt;
+		if( t > f.duration )
+			t = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_FourAxisCursor)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 15);
+
+// Dense resampling at a fixed step (e.g. a 1kHz feed or a log), in blocks
+// of one second, which forward differences within each segment
+static const double uniform_dt = 0.001;
+static const size_t uniform_block = 1000;
+
+static void BM_FourAxisUniform( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	std::vector<packed_quintic_point_t> points(uniform_block);
+
+	//Every point is checked, as any drift would build up between resyncs
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += uniform_block*uniform_dt) {
+		f.trajectory.lookup_uniform(t, uniform_dt, uniform_block, points.data());
+
+		for(size_t i = 0; i < uniform_block; i++)
+			err = std::max( err, four_axis_error( f, t + i*uniform_dt, points[i] ) );
+	}
+
+	if( !check_error(state, err) )
+		return;
+
+	double t = 0.0;
+	for(auto _ : state) {
+		f.trajectory.lookup_uniform(t, uniform_dt, uniform_block, points.data());
+		benchmark::DoNotOptimize( points.data() );
+		benchmark::ClobberMemory();
+
+		t += uniform_block*uniform_dt;
+		if( t > f.duration )
+			t = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations()*uniform_block );
+}
+BENCHMARK(BM_FourAxisUniform)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 12);
+
+// Packing a goal with a different number of yaws than positions (which the
+// manager interpolates separately), optionally with uneven yaw knots. Each
+// channel must still follow its own spline, and pass through every one of
+// its vias, however the knots of the others fall.
+static void BM_FourAxisPackMixed( benchmark::State& state ) {
+	const size_t n = state.range(0);
+	const size_t m = state.range(1);
+
+	four_axis_fixture_t f;
+	f.duration = 1.0*n;
+
+	for(size_t c = 0; c < 3; c++) {
+		f.offset[c] = 0.0;
+		f.axes[c].interpolate(make_vias(n, 0.5*c).data(), n);
+	}
+
+	std::vector<double> yaw_knots(m);
+	for(size_t i = 0; i < m; i++)
+		yaw_knots[i] = i + ( state.range(2) ? 0.3*std::sin(1.3*i) : 0.0 );
+
+	f.offset[3] = 0.0;
+	f.axes[3].interpolate(make_vias(m, 1.5).data(), m, yaw_knots.data());
+
+	if( !f.trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration) ) {
+		state.SkipWithError("unable to pack the trajectory");
+		return;
+	}
+
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, f.trajectory.lookup(t) ) );
+
+	//...and at the knots of every channel (i.e. through each via)
+	for(size_t c = 0; c < packed_channels; c++) {
+		const std::vector<double>& knots = f.axes[c].get_knots();
+		for(size_t i = 0; i < knots.size(); i++) {
+			const double q = f.axes[c].get_vias()[i];
+			err = std::max( err, std::fabs( f.trajectory.lookup(knots[i]*f.duration).q[c] - q ) / ( 1.0 + std::fabs(q) ) );
+		}
+	}
+
+	if( !check_error(state, err, n + m) )
+		return;
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize( f.trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration) );
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_FourAxisPackMixed)->ArgNames({"vias", "yaws", "knotted"})->Args({3, 4, 0})->Args({5, 4, 0})->Args({64, 48, 0})->Args({64, 48, 1})->Args({4096, 3000, 1});
+
+//=======================
+// Single precision
+//=======================
+
+// The same lookups from a float trajectory, with and without rebasing.
+// The coefficients are rounded to float (~7 significant digits) after
+// solving, and the derivatives lose about 2 more digits to cancellation
+// between the higher-order coefficients, so the results are checked
+// against a looser tolerance (the worst error measured is ~1.2e-5).
+//
+// The path is also flown 100km from the origin, where float positions
+// are only good to ~1cm. Rebasing must keep the error within tolerance
+// there, and without it the error must show up (or the fixture isn't
+// checking anything).
+static const double max_relative_error_f32 = 1e-4;
+static const double far_offset = 1e5;
+
+static void BM_FourAxisPackedF32( benchmark::State& state ) {
+	const bool rebase = state.range(1) != 0;
+	const bool far = state.range(2) != 0;
+
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0), far ? far_offset : 0.0);
+
+	PackedQuinticTrajectoryF trajectory;
+	trajectory.set_rebasing(rebase);
+	trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration);
+
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, trajectory.lookup(t) ) );
+
+	if( far && !rebase ) {
+		state.counters["max_err"] = err;
+
+		if( !( err > max_relative_error_f32 ) ) {
+			state.SkipWithError("positions far from the origin are not rounded without rebasing");
+			return;
+		}
+	} else if( !check_error(state, err, 0, max_relative_error_f32) ) {
+		return;
+	}
+
+	double t = 0.0;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( trajectory.lookup(t) );
+
+		t += control_dt;
+		if( t > f.duration )
+			t = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_FourAxisPackedF32)->ArgNames({"vias", "rebase", "far"})->RangeMultiplier(8)->Ranges({{8, 1 << 15}, {0, 1}, {0, 1}});
+
+// Random lookups spread over many trajectories (e.g. one per vehicle), so
+// the segments no longer fit in cache, and the lookup rate is limited by
+// memory traffic rather than by the evaluation itself
+static const size_t many_trajectories_vias = 4096;
+
+template<typename Scalar>
+static void BM_ManyTrajectories( benchmark::State& state ) {
+	const size_t num = state.range(0);
+
+	four_axis_fixture_t f;
+	make_four_axis(f, many_trajectories_vias);
+
+	std::vector<BasicPackedQuinticTrajectory<Scalar>*> trajectories(num);
+	for(size_t i = 0; i < num; i++) {
+		trajectories[i] = new BasicPackedQuinticTrajectory<Scalar>();
+		trajectories[i]->set_rebasing( state.range(1) != 0 );
+		trajectories[i]->pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration);
+	}
+
+	double err = 0.0;
+	for(double t = 0.0; t <= f.duration; t += f.duration / num_samples)
+		err = std::max( err, four_axis_error( f, t, trajectories[num - 1]->lookup(t) ) );
+
+	if( check_error(state, err, 0, ( sizeof(Scalar) == sizeof(double) ) ? max_relative_error : max_relative_error_f32) ) {
+		const std::vector<double> u = make_samples(num_samples*num_samples);
+
+		size_t i = 0;
+		for(auto _ : state) {
+			benchmark::DoNotOptimize( trajectories[i % num]->lookup( u[i] * f.duration ) );
+
+			if( ++i >= u.size() )
+				i = 0;
+		}
+
+		state.SetItemsProcessed( state.iterations() );
+		state.counters["bytes"] = num * many_trajectories_vias * sizeof(typename BasicPackedQuinticTrajectory<Scalar>::segment_t);
+	}
+
+	for(size_t i = 0; i < num; i++)
+		delete trajectories[i];
+}
+BENCHMARK_TEMPLATE(BM_ManyTrajectories, double)->ArgNames({"trajectories", "rebase"})->RangeMultiplier(4)->Ranges({{1, 256}, {0, 0}});
+BENCHMARK_TEMPLATE(BM_ManyTrajectories, float)->ArgNames({"trajectories", "rebase"})->RangeMultiplier(4)->Ranges({{1, 256}, {0, 1}});
+
+//=======================
+// Trajectory files
+//=======================
+
+// Loading a saved trajectory (mapping the file). A loaded trajectory is
+// evaluated from exactly the same coefficients, so its lookups must match
+// the original exactly, for every precision and with rebasing. Files from
+// version 1 (double precision only) must still load, and every header that
+// has been corrupted must be rejected rather than trusted.
+static const size_t trajectory_file_corruptions = 9;
+
+static std::string make_temp_file( void ) {
+	char path[] = "/tmp/contrail_benchmarks_XXXXXX";
+	const int fd = mkstemp(path);
+	if( fd >= 0 )
+		close(fd);
+
+	return path;
+}
+
+static std::vector<char> read_file( const std::string& filename ) {
+	std::ifstream file( filename.c_str(), std::ios::in | std::ios::binary );
+	return std::vector<char>( std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() );
+}
+
+static bool write_file( const std::string& filename, const std::vector<char>& data ) {
+	std::ofstream file( filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+	file.write( data.data(), data.size() );
+	file.close();
+
+	return !file.fail();
+}
+
+//Worst (absolute) difference between the lookups of two trajectories
+template<typename Scalar>
+static double trajectory_difference( const BasicPackedQuinticTrajectory<Scalar>& a,
+									 const BasicPackedQuinticTrajectory<Scalar>& b,
+									 const double duration ) {
+	double err = 0.0;
+	for(size_t i = 0; i <= num_samples; i++) {
+		const double t = i*duration / num_samples;
+		const packed_quintic_point_t pa = a.lookup(t);
+		const packed_quintic_point_t pb = b.lookup(t);
+
+		for(size_t c = 0; c < packed_channels; c++) {
+			err = std::max( err, std::fabs( pa.q[c] - pb.q[c] ) );
+			err = std::max( err, std::fabs( pa.qd[c] - pb.qd[c] ) );
+			err = std::max( err, std::fabs( pa.qdd[c] - pb.qdd[c] ) );
+		}
+	}
+
+	return err;
+}
+
+//Breaks one part of a saved file (data holds the whole file)
+static void corrupt_trajectory_file( std::vector<char>& data, const size_t i ) {
+	trajectory_file_header_t header;
+	memcpy(&header, data.data(), sizeof(header));
+
+	switch(i) {
+		case 0:
+			header.magic[0] = 'X';
+			break;
+		case 1:
+			header.version = trajectory_file_version + 1;
+			break;
+		case 2:
+			header.flags |= 0x80;
+			break;
+		case 3:
+			header.segment_size += 8;
+			break;
+		case 4:
+			header.byte_order_mark = 0x04030201;
+			break;
+		case 5:
+			header.num_segments = std::numeric_limits<uint64_t>::max() / 8;
+			break;
+		case 6:
+			//Would wrap back into the mapping if added to the segment sizes
+			header.segments_offset = std::numeric_limits<uint64_t>::max() - 63;
+			break;
+		case 7:
+			header.knots_offset = data.size();
+			break;
+		default:
+			//Truncated (the last segment or origin is missing)
+			data.resize( data.size() - sizeof(double) );
+			return;
+	}
+
+	memcpy(data.data(), &header, sizeof(header));
+}
+
+//Number of corrupted files that were loaded (rather than rejected)
+template<typename Scalar>
+static size_t trajectory_file_corrupted_loads( const std::string& filename ) {
+	const std::vector<char> original = read_file(filename);
+	const std::string corrupted = make_temp_file();
+	BasicPackedQuinticTrajectory<Scalar> loaded;
+
+	size_t num = 0;
+	for(size_t i = 0; i < trajectory_file_corruptions; i++) {
+		std::vector<char> data = original;
+		corrupt_trajectory_file(data, i);
+
+		if( write_file(corrupted, data) && ( loaded.load(corrupted) || loaded.is_valid() ) )
+			num++;
+	}
+
+	std::remove( corrupted.c_str() );
+
+	return num;
+}
+
+//Version 1 files hold double precision segments, with the same layout
+template<typename Scalar>
+static bool trajectory_file_loads_version_1( const std::string& filename, const BasicPackedQuinticTrajectory<Scalar>& original, const double duration ) {
+	std::vector<char> data = read_file(filename);
+	trajectory_file_header_t header;
+	memcpy(&header, data.data(), sizeof(header));
+	header.version = 1;
+	memcpy(data.data(), &header, sizeof(header));
+
+	const std::string old_file = make_temp_file();
+	BasicPackedQuinticTrajectory<Scalar> loaded;
+	const bool ok = write_file(old_file, data) && loaded.load(old_file) &&
+					( trajectory_difference(original, loaded, duration) == 0.0 );
+
+	std::remove( old_file.c_str() );
+
+	return ok;
+}
+
+template<typename Scalar>
+static void BM_TrajectoryLoad( benchmark::State& state ) {
+	const bool rebase = state.range(1) != 0;
+
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0), far_offset);
+
+	BasicPackedQuinticTrajectory<Scalar> trajectory;
+	trajectory.set_rebasing(rebase);
+	trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration);
+
+	const std::string filename = make_temp_file();
+	BasicPackedQuinticTrajectory<Scalar> loaded;
+
+	if( !( trajectory.save(filename) && loaded.load(filename) && loaded.is_mapped() &&
+		   ( loaded.is_rebased() == rebase ) ) ) {
+		std::remove( filename.c_str() );
+		state.SkipWithError("unable to save and load the trajectory");
+		return;
+	}
+
+	if( ( sizeof(Scalar) == sizeof(double) ) && !rebase &&
+		!trajectory_file_loads_version_1(filename, trajectory, f.duration) ) {
+		std::remove( filename.c_str() );
+		state.SkipWithError("unable to load a version 1 file");
+		return;
+	}
+
+	const size_t corrupted = trajectory_file_corrupted_loads<Scalar>(filename);
+	state.counters["corrupted_loads"] = corrupted;
+
+	if( corrupted > 0 ) {
+		std::remove( filename.c_str() );
+		state.SkipWithError("a corrupted file was loaded");
+		return;
+	}
+
+	//An assigned copy shares the mapping (so isn't limited by its capacity),
+	//and keeps it after the trajectory it was assigned from has gone
+	BasicPackedQuinticTrajectory<Scalar> shared(1);
+	{
+		BasicPackedQuinticTrajectory<Scalar> mapped;
+		if( !( mapped.load(filename) && shared.assign(mapped) && shared.is_mapped() ) ) {
+			std::remove( filename.c_str() );
+			state.SkipWithError("unable to share the mapped trajectory");
+			return;
+		}
+	}
+
+	//Saving over a mapped file (here with a shorter trajectory) must leave
+	//the trajectories already mapped from it reading the old one, and is
+	//then put back for the timing below
+	four_axis_fixture_t g;
+	make_four_axis(g, 4);
+
+	BasicPackedQuinticTrajectory<Scalar> replacement;
+	BasicPackedQuinticTrajectory<Scalar> replaced;
+	replacement.pack(g.axes[0], g.axes[1], g.axes[2], g.axes[3], g.duration);
+
+	if( !( replacement.save(filename) && replaced.load(filename) &&
+		   ( replaced.get_num_segments() == replacement.get_num_segments() ) ) ) {
+		std::remove( filename.c_str() );
+		state.SkipWithError("unable to save over the mapped trajectory");
+		return;
+	}
+
+	if( !check_error(state, std::max( trajectory_difference(trajectory, loaded, f.duration),
+									  trajectory_difference(trajectory, shared, f.duration) ), 0, 0.0) ||
+		!trajectory.save(filename) ) {
+		std::remove( filename.c_str() );
+		return;
+	}
+
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( loaded.load(filename) );
+		benchmark::DoNotOptimize( loaded.lookup(0.0) );
+	}
+
+	std::remove( filename.c_str() );
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK_TEMPLATE(BM_TrajectoryLoad, double)->ArgNames({"vias", "rebase"})->RangeMultiplier(8)->Ranges({{8, 1 << 15}, {0, 1}});
+BENCHMARK_TEMPLATE(BM_TrajectoryLoad, float)->ArgNames({"vias", "rebase"})->RangeMultiplier(8)->Ranges({{8, 1 << 15}, {0, 1}});
+
+//=======================
+// Kinematic limits
+//=======================
+
+// The peaks decide whether a goal is accepted, so they are checked against
+// a dense scan of the trajectory. The scan can only fall short of a peak
+// (by about the square of its spacing), so a peak that is missed shows up
+// as the scan being higher. The root finder they are built on is checked
+// first, against polynomials with known roots, including roots that only
+// touch zero (at a turning point, or at the end of the interval), and
+// polynomials with zero leading coefficients.
+//
+// The peaks only refine the segments that could hold them, so they are
+// also checked against refining every segment (which is timed as the
+// baseline), at every size (the dense scan is only run on the smaller
+// trajectories, as it takes too long on the largest).
+static const double max_root_error = 1e-9;
+static const size_t peaks_scan = 4096;	//Scan samples per segment
+static const size_t peaks_scan_max_vias = 512;
+static const double max_peak_error = 1e-6;
+
+typedef struct {
+	std::vector<double> roots;	//With any repeats, in ascending order
+	size_t degree;				//Padded with zero leading coefficients up to this
+} roots_case_t;
+
+//Coefficients (ascending powers) of the product of (u - root)
+static std::vector<double> polynomial_from_roots( const roots_case_t& rc ) {
+	std::vector<double> c(1, 1.0);
+
+	for(size_t i = 0; i < rc.roots.size(); i++) {
+		std::vector<double> p(c.size() + 1, 0.0);
+		for(size_t k = 0; k < c.size(); k++) {
+			p[k + 1] += c[k];
+			p[k] -= rc.roots[i]*c[k];
+		}
+
+		c = p;
+	}
+
+	c.resize(rc.degree + 1, 0.0);
+
+	return c;
+}
+
+//Worst error of the roots found in [0, 1] against the distinct roots of
+//each case (infinite if any are missed, or extra roots are found)
+static double polynomial_roots_error( void ) {
+	const roots_case_t cases[] = { { {0.1, 0.3, 0.5, 0.7, 0.9}, 5 },
+								   { {0.05, 0.2, 0.35, 0.5, 0.65, 0.8, 0.95}, 7 },
+								   { {0.2, 0.5, 0.5, 0.8}, 4 },			//Double root on a turning point
+								   { {0.3, 0.3, 0.6, 0.6, 0.9}, 5 },
+								   { {0.4, 0.4, 0.4}, 3 },
+								   { {0.0, 0.6, 1.0}, 3 },				//Roots at each end
+								   { {0.25, 0.75}, 5 },					//Zero leading coefficients
+								   { {0.25}, 7 },
+								   { {}, 5 } };
+
+	double err = 0.0;
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		const std::vector<double> c = polynomial_from_roots(cases[i]);
+		std::vector<double> expected = cases[i].roots;
+		expected.erase( std::unique( expected.begin(), expected.end() ), expected.end() );
+
+		double roots[polynomial_roots_max_degree];
+		const size_t num = polynomial_roots(c.data(), cases[i].degree, 0.0, 1.0, roots);
+
+		if( num != expected.size() )
+			return std::numeric_limits<double>::infinity();
+
+		for(size_t k = 0; k < num; k++)
+			err = std::max( err, std::fabs( roots[k] - expected[k] ) );
+	}
+
+	return err;
+}
+
+static void BM_PolynomialRoots( benchmark::State& state ) {
+	if( !check_error(state, polynomial_roots_error(), 0, max_root_error) )
+		return;
+
+	//The |v|^2 turning points of a segment (degree 7)
+	const roots_case_t rc = { {-0.5, 0.05, 0.2, 0.35, 0.5, 0.65, 1.5}, 7 };
+	const std::vector<double> c = polynomial_from_roots(rc);
+
+	for(auto _ : state) {
+		double roots[polynomial_roots_max_degree];
+		benchmark::DoNotOptimize( polynomial_roots(c.data(), rc.degree, 0.0, 1.0, roots) );
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_PolynomialRoots);
+
+//Worst relative error of the peaks against a dense scan of lookups
+static double trajectory_peaks_error( const PackedQuinticTrajectory& trajectory, const kinematic_peaks_t& peaks ) {
+	kinematic_peaks_t scan = {0.0, 0.0, 0.0};
+	const double* knots = trajectory.get_knots();
+
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		for(size_t k = 0; k <= peaks_scan; k++) {
+			const double t = knots[i] + ( knots[i + 1] - knots[i] )*k / peaks_scan;
+			const packed_quintic_point_t p = trajectory.lookup(t);
+
+			scan.velocity = std::max( scan.velocity, std::sqrt( p.qd[0]*p.qd[0] + p.qd[1]*p.qd[1] + p.qd[2]*p.qd[2] ) );
+			scan.acceleration = std::max( scan.acceleration, std::sqrt( p.qdd[0]*p.qdd[0] + p.qdd[1]*p.qdd[1] + p.qdd[2]*p.qdd[2] ) );
+			scan.yaw_rate = std::max( scan.yaw_rate, std::fabs(p.qd[3]) );
+		}
+	}
+
+	return std::max( std::fabs( peaks.velocity - scan.velocity ) / ( 1.0 + scan.velocity ),
+		   std::max( std::fabs( peaks.acceleration - scan.acceleration ) / ( 1.0 + scan.acceleration ),
+					 std::fabs( peaks.yaw_rate - scan.yaw_rate ) / ( 1.0 + scan.yaw_rate ) ) );
+}
+
+//Finds the exact peaks of every segment
+static kinematic_peaks_t trajectory_peaks_exhaustive( const PackedQuinticTrajectory& trajectory ) {
+	kinematic_peaks_t peaks = {0.0, 0.0, 0.0};
+
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		const kinematic_peaks_t p = trajectory_segment_peaks(trajectory, i);
+		peaks.velocity = std::max(peaks.velocity, p.velocity);
+		peaks.acceleration = std::max(peaks.acceleration, p.acceleration);
+		peaks.yaw_rate = std::max(peaks.yaw_rate, p.yaw_rate);
+	}
+
+	return peaks;
+}
+
+static void BM_TrajectoryPeaks( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	const kinematic_peaks_t peaks = trajectory_peaks(f.trajectory);
+	const kinematic_peaks_t exhaustive = trajectory_peaks_exhaustive(f.trajectory);
+
+	double err = std::max( std::fabs( peaks.velocity - exhaustive.velocity ) / ( 1.0 + exhaustive.velocity ),
+				 std::max( std::fabs( peaks.acceleration - exhaustive.acceleration ) / ( 1.0 + exhaustive.acceleration ),
+						   std::fabs( peaks.yaw_rate - exhaustive.yaw_rate ) / ( 1.0 + exhaustive.yaw_rate ) ) );
+
+	if( f.trajectory.get_num_segments() < peaks_scan_max_vias )
+		err = std::max( err, trajectory_peaks_error(f.trajectory, peaks) );
+
+	if( !check_error(state, err, 0, max_peak_error) )
+		return;
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize( trajectory_peaks(f.trajectory) );
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_TrajectoryPeaks)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 15);
+
+//Baseline for BM_TrajectoryPeaks (the turning points of every segment)
+static void BM_TrajectoryPeaksExhaustive( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize( trajectory_peaks_exhaustive(f.trajectory) );
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_TrajectoryPeaksExhaustive)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 15);
+
+//=======================
+// Arc length
+//=======================
+
+// Constant speed tracking looks up the trajectory time at a distance along
+// the path every control step. The distance to the time at each station is
+// checked against a dense Simpson integration of the (floored) speed, on
+// a path that stops at its start, end, and around its middle via, with and
+// without the speed floor.
+//
+// Between the stations, the time near a stop changes faster than a cubic
+// can follow (without the floor, as the square root of the distance), so
+// there the lookups are only checked to land within their station. The
+// worst distance error between the stations is reported as the "interp_err"
+// counter (metres). The derivatives of the lookups are checked against
+// finite differences of the lookups (away from the stations, where the
+// second derivative steps). The lookups must also never go back in time,
+// and must hold at the ends of the path for distances outside it and NaN.
+static const size_t arc_length_scan = 256;	//Integration steps per segment
+static const size_t arc_length_checks = 64;	//Monotonicity checks per station
+static const double arc_length_min_speed_ratio = 0.1;
+static const double arc_length_step = 1e-4;	//Finite difference step (in stations)
+//The floored speed bends sharply where the path stops, which the quadrature
+//in the table is less accurate over (relative to the path length)
+static const double max_arc_length_error = 1e-6;
+
+//The path comes to a stop at the middle via (all axes hold it either side,
+//so the linear estimate of its velocity is zero)
+static void make_hover_four_axis( four_axis_fixture_t& f, const size_t n ) {
+	const size_t m = n / 2;
+	f.duration = 1.0*n;
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		f.offset[c] = 0.0;
+
+		std::vector<double> vias = make_vias(n, 0.5*c);
+		vias[m - 1] = vias[m];
+		vias[m + 1] = vias[m];
+
+		f.axes[c].interpolate(vias.data(), n);
+	}
+
+	f.trajectory.pack(f.axes[0], f.axes[1], f.axes[2], f.axes[3], f.duration);
+}
+
+//Distance rate at t, with the speed floor added as in the table
+static double arc_length_rate( const PackedQuinticTrajectory& trajectory, const double min_speed, const double t ) {
+	const packed_quintic_point_t p = trajectory.lookup(t);
+	return std::sqrt( p.qd[0]*p.qd[0] + p.qd[1]*p.qd[1] + p.qd[2]*p.qd[2] + min_speed*min_speed );
+}
+
+//Simpson's rule between t0 and t1
+static double arc_length_simpson( const PackedQuinticTrajectory& trajectory, const double min_speed, const double t0, const double t1 ) {
+	return ( t1 - t0 ) * ( arc_length_rate(trajectory, min_speed, t0) +
+						   4.0*arc_length_rate(trajectory, min_speed, 0.5*(t0 + t1)) +
+						   arc_length_rate(trajectory, min_speed, t1) ) / 6.0;
+}
+
+//Worst error of the table against the dense integration
+static double arc_length_error( const PackedQuinticTrajectory& trajectory, const ArcLengthTable& table, double& interp_err ) {
+	const double* knots = trajectory.get_knots();
+	const double min_speed = table.get_min_speed();
+	const double length = table.get_length();
+
+	//Distance at every integration step
+	std::vector<double> t_scan;
+	std::vector<double> s_scan;
+	double s = 0.0;
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		for(size_t k = 0; k < arc_length_scan; k++) {
+			const double t0 = knots[i] + ( knots[i + 1] - knots[i] )*k / arc_length_scan;
+			const double t1 = knots[i] + ( knots[i + 1] - knots[i] )*(k + 1) / arc_length_scan;
+
+			t_scan.push_back(t0);
+			s_scan.push_back(s);
+			s += arc_length_simpson(trajectory, min_speed, t0, t1);
+		}
+	}
+	t_scan.push_back( knots[trajectory.get_num_segments()] );
+	s_scan.push_back(s);
+
+	const size_t num_stations = table.get_num_stations();
+	const double ds = length / (num_stations - 1);
+	const std::vector<double> u = make_samples(num_samples);
+
+	double err = std::fabs(length - s) / length;
+	interp_err = 0.0;
+
+	//Distance to the time at the stations (up to num_samples of them), then
+	//between them
+	const size_t step = std::max( num_stations / num_samples, (size_t)1 );
+	for(size_t i = 0; i < num_stations + u.size(); i += ( i < num_stations ) ? step : 1) {
+		const double sj = ( i < num_stations ) ? i*ds : u[i - num_stations]*length;
+		const double t = table.lookup(sj);
+		const size_t k = std::min( (size_t)( std::upper_bound( t_scan.begin(), t_scan.end(), t ) - t_scan.begin() ), t_scan.size() - 1 ) - 1;
+		const double sk = s_scan[k] + arc_length_simpson(trajectory, min_speed, t_scan[k], t);
+
+		if( i < num_stations ) {
+			err = std::max( err, std::fabs(sk - sj) / length );
+		} else if( std::fabs(sk - sj) < ds ) {
+			interp_err = std::max( interp_err, std::fabs(sk - sj) );
+		} else {
+			return HUGE_VAL;
+		}
+	}
+
+	//Derivatives of the same interpolation, relative to the average slope
+	const double dtds_avg = ( knots[trajectory.get_num_segments()] - knots[0] ) / length;
+	const double h = arc_length_step*ds;
+	for(size_t i = 0; i < u.size(); i++) {
+		const double x = u[i]*( num_stations - 1 );
+		if( ( x - std::floor(x) < 2.0*arc_length_step ) || ( std::ceil(x) - x < 2.0*arc_length_step ) )
+			continue;
+
+		double dtds[3];
+		double d2tds2[3];
+		for(size_t k = 0; k < 3; k++)
+			table.lookup( x*ds + ( (double)k - 1.0 )*h, dtds[k], d2tds2[k] );
+
+		err = std::max( err, std::fabs( ( table.lookup(x*ds + h) - table.lookup(x*ds - h) ) / (2.0*h) - dtds[1] ) / dtds_avg );
+		err = std::max( err, std::fabs( ( dtds[2] - dtds[0] ) / (2.0*h) - d2tds2[1] ) * ds / dtds_avg );
+	}
+
+	//Never goes back in time
+	const size_t num_checks = ( num_stations - 1 )*arc_length_checks;
+	double t_prev = table.lookup(0.0);
+	for(size_t j = 1; j <= num_checks; j++) {
+		const double t = table.lookup( length*j / num_checks );
+		if( !( t >= t_prev ) )
+			return HUGE_VAL;
+
+		t_prev = t;
+	}
+
+	//Holds at the ends
+	const double t0 = knots[0];
+	const double t1 = knots[trajectory.get_num_segments()];
+	const double t_nan = table.lookup( std::numeric_limits<double>::quiet_NaN() );
+	if( !( ( t_nan >= t0 ) && ( t_nan <= t1 ) ) ||
+		( table.lookup(-1.0) != t0 ) ||
+		( table.lookup( -std::numeric_limits<double>::infinity() ) != t0 ) ||
+		( table.lookup(length + 1.0) != t1 ) ||
+		( table.lookup( std::numeric_limits<double>::infinity() ) != t1 ) )
+		return HUGE_VAL;
+
+	return err;
+}
+
+static void BM_ArcLengthLookup( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_hover_four_axis(f, state.range(0));
+
+	ArcLengthTable table;
+	if( !table.build( f.trajectory, state.range(1) ? arc_length_min_speed_ratio : 0.0 ) ) {
+		state.SkipWithError("arc-length table failed to build");
+		return;
+	}
+
+	double interp_err = 0.0;
+	const double err = arc_length_error(f.trajectory, table, interp_err);
+	state.counters["interp_err"] = interp_err;
+
+	if( !check_error(state, err, 0, max_arc_length_error) )
+		return;
+
+	//Steps along the path at its average speed, as the manager does
+	const double ds = control_dt * table.get_length() / f.duration;
+	double s = 0.0;
+	double dtds;
+	double d2tds2;
+	for(auto _ : state) {
+		benchmark::DoNotOptimize( table.lookup(s, dtds, d2tds2) );
+
+		s += ds;
+		if( s > table.get_length() )
+			s = 0.0;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_ArcLengthLookup)->ArgNames({"vias", "floor"})->RangeMultiplier(8)->Ranges({{8, 1 << 12}, {0, 1}});
+
+//=======================
+// Closest point
+//=======================
+
+// Closest point queries from points scattered around the path (e.g. the
+// vehicle position during path following). The result is checked against
+// a dense scan of every segment, which can only overestimate the distance,
+// so any error means the tree missed the closest segment or minimum.
+static const size_t closest_point_checks = 16;
+static const size_t closest_point_scan = 64;	//Scan samples per segment
+
+static std::vector<double> make_query_points( four_axis_fixture_t& f, const size_t n ) {
+	const std::vector<double> s = make_samples(4*n);
+	std::vector<double> x(3*n);
+
+	for(size_t i = 0; i < n; i++) {
+		const packed_quintic_point_t p = f.trajectory.lookup( s[4*i]*f.duration );
+		for(size_t c = 0; c < 3; c++)
+			x[3*i + c] = p.q[c] + 2.0*s[4*i + c + 1] - 1.0;
+	}
+
+	return x;
+}
+
+static void BM_ClosestPoint( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	ClosestPointTree tree;
+	tree.build(f.trajectory);
+
+	const std::vector<double> x = make_query_points(f, num_samples);
+
+	double err = 0.0;
+	for(size_t i = 0; i < closest_point_checks; i++) {
+		const size_t n = closest_point_scan*f.trajectory.get_num_segments();
+
+		double d2 = std::numeric_limits<double>::infinity();
+		for(size_t k = 0; k <= n; k++) {
+			const packed_quintic_point_t p = f.trajectory.lookup( k*f.duration / n );
+
+			double d2k = 0.0;
+			for(size_t c = 0; c < 3; c++)
+				d2k += (p.q[c] - x[3*i + c])*(p.q[c] - x[3*i + c]);
+
+			d2 = std::min(d2, d2k);
+		}
+
+		closest_point_t r;
+		tree.query(&x[3*i], r);
+		err = std::max( err, r.distance - std::sqrt(d2) );
+	}
+
+	if( !check_error(state, err) )
+		return;
+
+	size_t i = 0;
+	for(auto _ : state) {
+		closest_point_t r;
+		tree.query(&x[3*i], r);
+		benchmark::DoNotOptimize(r);
+
+		i = (i + 1) % num_samples;
+	}
+
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK(BM_ClosestPoint)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 14);
+
+static void BM_ClosestPointBuild( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	ClosestPointTree tree(state.range(0));
+
+	for(auto _ : state) {
+		tree.build(f.trajectory);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_ClosestPointBuild)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 14);
+
+//=======================
+// Geofence
+//=======================
+
+// Checking a goal against an arena that only just holds it, diagonal
+// half spaces, and keep-out boxes against each face of the arena, so that
+// every segment must be checked and many get past the broad phase. The
+// path is inside every constraint, which the check must confirm.
+static const double geofence_margin = 0.01;
+
+static void BM_Geofence( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	geofence_t g;
+	g.has_arena = true;
+	g.arena = segment_bounds(f.trajectory, 0);
+	for(size_t i = 1; i < f.trajectory.get_num_segments(); i++) {
+		const aabb_t b = segment_bounds(f.trajectory, i);
+		for(size_t c = 0; c < 3; c++) {
+			g.arena.lo[c] = std::min(g.arena.lo[c], b.lo[c]);
+			g.arena.hi[c] = std::max(g.arena.hi[c], b.hi[c]);
+		}
+	}
+
+	for(size_t c = 0; c < 3; c++) {
+		g.arena.lo[c] -= geofence_margin;
+		g.arena.hi[c] += geofence_margin;
+	}
+
+	//Half spaces through opposite corners of the arena, facing out
+	for(size_t i = 0; i < 2; i++) {
+		const double* corner = ( i == 0 ) ? g.arena.hi : g.arena.lo;
+		const double sign = ( i == 0 ) ? 1.0 : -1.0;
+
+		half_space_t h = {{sign*1.0/std::sqrt(3.0), sign*1.0/std::sqrt(3.0), sign*1.0/std::sqrt(3.0)}, 0.0};
+		for(size_t c = 0; c < 3; c++)
+			h.offset += h.normal[c]*corner[c];
+
+		g.half_spaces.push_back(h);
+	}
+
+	//Keep-out boxes just outside each face of the arena
+	for(size_t c = 0; c < 3; c++) {
+		for(size_t i = 0; i < 2; i++) {
+			aabb_t box = g.arena;
+			if( i == 0 ) {
+				box.hi[c] = box.lo[c];
+				box.lo[c] -= 1.0;
+			} else {
+				box.lo[c] = box.hi[c];
+				box.hi[c] += 1.0;
+			}
+
+			g.keep_out.push_back(box);
+		}
+	}
+
+	const geofence_result_t r = trajectory_geofence_check(f.trajectory, g);
+	if( !check_error(state, ( r.violation == GEOFENCE_CLEAR ) ? 0.0 : 1.0) )
+		return;
+
+	for(auto _ : state)
+		benchmark::DoNotOptimize( trajectory_geofence_check(f.trajectory, g) );
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_Geofence)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 14);
+
+//=======================
+// Adaptive sampling
+//=======================
+
+// Sampling a goal for visualisation. The path is checked densely against
+// the polyline between the samples either side of each time, and must stay
+// within the tolerance. The number of samples (against one per segment for
+// the knots alone) is reported as the "samples" counter.
+static const sampling_tolerance_t sampling_tolerance = {0.01, 0.1, 0.0};
+static const size_t sampling_checks = 16;	//Checks per segment
+
+static void BM_AdaptiveSample( benchmark::State& state ) {
+	four_axis_fixture_t f;
+	make_four_axis(f, state.range(0));
+
+	std::vector<double> times;
+	std::vector<packed_quintic_point_t> points;
+	adaptive_sample(f.trajectory, sampling_tolerance, times, points);
+
+	double err = 0.0;
+	const size_t n = sampling_checks*f.trajectory.get_num_segments();
+	size_t k = 0;
+	for(size_t i = 0; i <= n; i++) {
+		const double t = i*f.duration / n;
+		while( ( k + 2 < times.size() ) && ( times[k + 1] < t ) )
+			k++;
+
+		//Distance from the line between the samples either side
+		const packed_quintic_point_t p = f.trajectory.lookup(t);
+		double ab[3];
+		double ax[3];
+		double ab2 = 0.0;
+		double abx = 0.0;
+		for(size_t c = 0; c < 3; c++) {
+			ab[c] = points[k + 1].q[c] - points[k].q[c];
+			ax[c] = p.q[c] - points[k].q[c];
+			ab2 += ab[c]*ab[c];
+			abx += ab[c]*ax[c];
+		}
+
+		const double s = ( ab2 > 0.0 ) ? std::min( std::max( abx / ab2, 0.0 ), 1.0 ) : 0.0;
+		double d2 = 0.0;
+		for(size_t c = 0; c < 3; c++)
+			d2 += (ax[c] - s*ab[c])*(ax[c] - s*ab[c]);
+
+		err = std::max( err, std::sqrt(d2) - sampling_tolerance.tolerance );
+	}
+
+	state.counters["samples"] = times.size();
+	if( !check_error(state, std::max(err, 0.0)) )
+		return;
+
+	for(auto _ : state) {
+		adaptive_sample(f.trajectory, sampling_tolerance, times, points);
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed( state.iterations()*f.trajectory.get_num_segments() );
+}
+BENCHMARK(BM_AdaptiveSample)->ArgName("vias")->RangeMultiplier(8)->Range(8, 1 << 14);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,103 @@
+#ifndef CONTRAIL_BENCHMARKS_REFERENCE_QUINTIC_SPLINE_H
+#define CONTRAIL_BENCHMARKS_REFERENCE_QUINTIC_SPLINE_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+
+#include <eigen3/Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace contrail_benchmarks {
+
+// Straightforward (slow) reference implementations, used to check the
+// accuracy of the optimised library code in the benchmarks
+//
+// These deliberately share nothing with the library: the segment
+// coefficients come from a general 6x6 solve of the boundary conditions,
+// and polynomials are evaluated term-by-term with pow().
+
+//Solves the quintic on 0 <= u <= 1 matching the given end conditions
+inline contrail_spline_lib::quintic_spline_coeffs_t reference_solver( const double q0,
+																	  const double qd0,
+																	  const double qdd0,
+																	  const double qf,
+																	  const double qdf,
+																	  const double qddf ) {
+	Eigen::Matrix<double, 6, 6> A = Eigen::Matrix<double, 6, 6>::Zero();
+	Eigen::Matrix<double, 6, 1> b;
+	b << q0, qd0, qdd0, qf, qdf, qddf;
+
+	for(int k = 0; k < 6; k++) {
+		//Position, velocity and acceleration rows at u = 0 and u = 1
+		for(int e = 0; e < 2; e++) {
+			const double u = e;
+			A(3*e, k) = std::pow(u, k);
+			A(3*e + 1, k) = ( k >= 1 ) ? k*std::pow(u, k - 1) : 0.0;
+			A(3*e + 2, k) = ( k >= 2 ) ? k*(k - 1)*std::pow(u, k - 2) : 0.0;
+		}
+	}
+
+	const Eigen::Matrix<double, 6, 1> a = A.fullPivLu().solve(b);
+
+	contrail_spline_lib::quintic_spline_coeffs_t c;
+	c.a1 = a(0);
+	c.a2 = a(1);
+	c.a3 = a(2);
+	c.a4 = a(3);
+	c.a5 = a(4);
+	c.a6 = a(5);
+
+	return c;
+}
+
+inline contrail_spline_lib::quintic_spline_point_t reference_lookup( const double u,
+																	 const contrail_spline_lib::quintic_spline_coeffs_t& c ) {
+	const double a[6] = {c.a1, c.a2, c.a3, c.a4, c.a5, c.a6};
+
+	contrail_spline_lib::quintic_spline_point_t p = {0.0, 0.0, 0.0};
+	for(int k = 0; k < 6; k++) {
+		p.q += a[k]*std::pow(u, k);
+		if( k >= 1 )
+			p.qd += k*a[k]*std::pow(u, k - 1);
+		if( k >= 2 )
+			p.qdd += k*(k - 1)*a[k]*std::pow(u, k - 2);
+	}
+
+	return p;
+}
+
+//Looks up a spline through vias (with derivatives given per unit of the knot time)
+//The segment is solved from scratch for every lookup
+inline contrail_spline_lib::quintic_spline_point_t reference_spline_lookup( const double t,
+																			const std::vector<double>& knots,
+																			const double* q,
+																			const double* qd,
+																			const double* qdd ) {
+	const double t_c = std::min( std::max(t, knots.front()), knots.back() );
+
+	const size_t i = std::upper_bound( knots.begin() + 1, knots.end() - 1, t_c ) - ( knots.begin() + 1 );
+
+	const double h = knots[i + 1] - knots[i];
+	const contrail_spline_lib::quintic_spline_coeffs_t c =
+		reference_solver( q[i], qd[i]*h, qdd[i]*h*h, q[i + 1], qd[i + 1]*h, qdd[i + 1]*h*h );
+
+	contrail_spline_lib::quintic_spline_point_t p = reference_lookup( (t_c - knots[i]) / h, c );
+	p.qd /= h;
+	p.qdd /= h*h;
+
+	return p;
+}
+
+//Error of a point relative to a reference, scaled by the size of each term
+inline double reference_error( const contrail_spline_lib::quintic_spline_point_t& p,
+							   const contrail_spline_lib::quintic_spline_point_t& r ) {
+	return std::max( std::fabs(p.q - r.q) / ( 1.0 + std::fabs(r.q) ),
+		   std::max( std::fabs(p.qd - r.qd) / ( 1.0 + std::fabs(r.qd) ),
+					 std::fabs(p.qdd - r.qdd) / ( 1.0 + std::fabs(r.qdd) ) ) );
+}
+
+}
+
+#endif
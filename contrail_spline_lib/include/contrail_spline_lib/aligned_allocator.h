@@ -0,0 +1,55 @@
+#ifndef CONTRAIL_SPLINE_LIB_ALIGNED_ALLOCATOR_H
+#define CONTRAIL_SPLINE_LIB_ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace contrail_spline_lib {
+
+// Minimal allocator to give std::vector storage with a fixed alignment
+// (operator new is not required to honour over-aligned types before C++17)
+template<typename T, std::size_t Alignment>
+class aligned_allocator {
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef T& reference;
+		typedef const T& const_reference;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		template<typename U>
+		struct rebind {
+			typedef aligned_allocator<U, Alignment> other;
+		};
+
+		aligned_allocator( void ) {}
+
+		template<typename U>
+		aligned_allocator( const aligned_allocator<U, Alignment>& ) {}
+
+		T* allocate( const std::size_t n ) {
+			void* p = NULL;
+
+			if( (n > 0) && posix_memalign(&p, Alignment, n*sizeof(T)) )
+				throw std::bad_alloc();
+
+			return static_cast<T*>(p);
+		}
+
+		void deallocate( T* p, const std::size_t ) {
+			free(p);
+		}
+
+		template<typename U>
+		bool operator==( const aligned_allocator<U, Alignment>& ) const { return true; }
+
+		template<typename U>
+		bool operator!=( const aligned_allocator<U, Alignment>& ) const { return false; }
+};
+
+}
+
+#endif
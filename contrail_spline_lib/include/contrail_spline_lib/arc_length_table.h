@@ -0,0 +1,91 @@
+#ifndef CONTRAIL_SPLINE_LIB_ARC_LENGTH_TABLE_H
+#define CONTRAIL_SPLINE_LIB_ARC_LENGTH_TABLE_H
+
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <vector>
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Arc-length reparameterisation of the path (x, y, z) of a PackedQuinticTrajectory
+//
+// The length along each segment is integrated with Gauss-Legendre
+// quadrature, then inverted onto a table of trajectory times at evenly
+// spaced distances along the path. All of the root finding happens in
+// build(), so a lookup of the time at a given distance is a direct index
+// into the table and a single cubic Hermite interpolation.
+//
+// The Hermite slopes (dt/ds = 1/speed) are limited so the interpolated
+// time is monotonic in distance, including where the path stops.
+//
+// Where the path stops (hover vias, cusps), a constant rate along the
+// distance needs the trajectory time to pass without bound. The distance
+// can instead be measured with a floor on the speed, added in quadrature
+// (sqrt(|v|^2 + v_min^2)), so the time passes at a bounded (and smooth)
+// rate, and the path slows down through the stop.
+//
+// The table must be rebuilt whenever the trajectory is re-packed.
+class ArcLengthTable {
+	private:
+		std::vector<double> _t;		//Trajectory time at each station
+		std::vector<double> _dtds;	//Slope (dt/ds) at each station
+
+		std::vector<double> _fwd_s;	//Distance at evenly spaced times in each segment, only used while building
+
+		double _length;
+		double _min_speed;	//Speed added in quadrature (m/s)
+		double _ds;		//Distance between stations
+		double _inv_ds;
+
+		size_t _resolution;	//Stations per segment
+		size_t _capacity;	//Maximum number of segments (0 to grow as needed)
+
+		bool _is_valid;
+
+		//Rate of the distance along segment "seg" (duration h) at normalised time u
+		template<typename Scalar>
+		double _segment_rate( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u ) const;
+		//Length along segment "seg" between normalised times u0 and u1
+		template<typename Scalar>
+		double _segment_length( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u0, const double u1 ) const;
+		//Normalised time in [u0, u1] where the length from u0 reaches ds
+		template<typename Scalar>
+		double _segment_invert( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u0, const double u1, const double ds ) const;
+		//Integrates the length of every step of the forward table, returning the total
+		template<typename Scalar>
+		double _integrate( const BasicPackedQuinticTrajectory<Scalar>& trajectory );
+
+	public:
+		ArcLengthTable( void );
+		//Fixed-capacity mode, all storage is allocated up front and build()
+		//will fail rather than allocate for more than "capacity" segments
+		explicit ArcLengthTable( const size_t capacity, const size_t resolution = 16 );
+		~ArcLengthTable( void );
+
+		//Builds the table for a (packed) trajectory of either precision
+		//Fails if the trajectory is invalid, or the path has no length
+		//The speed floor (see above) is min_speed_ratio times the average
+		//speed along the path (0 for the plain arc length)
+		template<typename Scalar>
+		bool build( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const double min_speed_ratio = 0.0 );
+
+		//Returns the trajectory time (seconds) at which the path has covered
+		//a distance "s" (clamped to the length of the path)
+		double lookup( const double s ) const;
+		//As above, with the derivatives of the time with respect to the
+		//distance, taken from the same interpolation (zero outside the path)
+		double lookup( const double s, double& dtds, double& d2tds2 ) const;
+
+		//Length of the path (including the speed floor)
+		inline double get_length( void ) const { return _length; };
+		//Speed floor (m/s, 0 if none)
+		inline double get_min_speed( void ) const { return _min_speed; };
+		inline size_t get_resolution( void ) const { return _resolution; };
+		inline size_t get_num_stations( void ) const { return _t.size(); };
+		inline bool is_valid( void ) const { return _is_valid; };
+};
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef CONTRAIL_SPLINE_LIB_CLOSEST_POINT_TREE_H
+#define CONTRAIL_SPLINE_LIB_CLOSEST_POINT_TREE_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace contrail_spline_lib {
+
+// Closest point queries on the path (x, y, z) of a PackedQuinticTrajectory
+//
+// Each segment is bounded by an axis-aligned box, found exactly from the
+// turning points of each axis (see polynomial_range()), and the boxes
+// are arranged in a binary tree over consecutive runs of segments. A query
+// descends the tree nearest box first, and skips any box that is further
+// away than the best point found so far, so only the few segments near
+// the query point are searched.
+//
+// Within a segment, the squared distance is sampled at evenly spaced
+// times, and each local minimum of the samples is refined with a
+// (bracketed) Newton iteration on d(|p(u) - x|^2)/du = 0.
+//
+// The coefficients are copied in double precision (with any rebasing
+// applied), so the tree does not refer to the trajectory after build().
+// The tree must be rebuilt whenever the trajectory is re-packed.
+class ClosestPointTree {
+	private:
+		//Path of a segment, in absolute positions and normalised time
+		typedef struct {
+			double a[6][3];
+		} segment_path_t;
+
+		//Bounds of the segments [first, last), with the children (if any)
+		//at index + 1 and at "right"
+		typedef struct {
+			double lo[3];
+			double hi[3];
+			uint32_t first;
+			uint32_t last;
+			uint32_t right;
+		} node_t;
+
+		std::vector<segment_path_t> _paths;
+		std::vector<double> _knots;
+		std::vector<node_t> _nodes;
+
+		size_t _capacity;	//Maximum number of segments (0 to grow as needed)
+
+		bool _is_valid;
+
+		//Builds the node for segments [first, last) and its children,
+		//returning its index
+		uint32_t _build_node( const uint32_t first, const uint32_t last );
+		//Closest point of segment "seg" to x over [u0, u1], updating the
+		//result if it is closer than the current best (d2_best)
+		void _search_segment( const size_t seg, const double* x, const double u0, const double u1,
+							  double& d2_best, closest_point_t& result ) const;
+
+	public:
+		ClosestPointTree( void );
+		//Fixed-capacity mode, all storage is allocated up front and build()
+		//will fail rather than allocate for more than "capacity" segments
+		explicit ClosestPointTree( const size_t capacity );
+		~ClosestPointTree( void );
+
+		//Builds the tree for a (packed) trajectory of either precision
+		template<typename Scalar>
+		bool build( const BasicPackedQuinticTrajectory<Scalar>& trajectory );
+
+		//Finds the closest point on the path to x (3 values)
+		bool query( const double* x, closest_point_t& result ) const;
+		//As above, only considering the part of the path between the
+		//trajectory times t0 and t1 (seconds), e.g. to follow progress along
+		//a path that crosses itself
+		bool query( const double* x, const double t0, const double t1, closest_point_t& result ) const;
+
+		inline size_t get_num_segments( void ) const { return _paths.size(); };
+		inline bool is_valid( void ) const { return _is_valid; };
+};
+
+}
+
+#endif
@@ -3,48 +3,225 @@
 
 #include <contrail_spline_lib/common_spline_types.h>
 
-#include <eigen3/Eigen/Dense>
+#include <array>
+#include <cstddef>
+#include <assert.h>
+
+#if __cplusplus < 201402L
+#error "common_spline_solver.h requires C++14 (e.g. add_compile_options(-std=c++14))"
+#endif
 
 namespace contrail_spline_lib {
 
+// Generic, header-only solver for time-normalised splines
+//
+// A segment with N constraints at each end (value and N-1 derivatives) is
+// solved as a 2N-dimensional linear system. As time is normalised (t0=0;
+// tf=1), the system is constant for each order, so the inverse is built
+// at compile time and a segment is solved with a single matrix product.
+//
+// The templates take N (the constraints at each end), e.g.:
+//		normalised_spline_t<dim_sys_nonic/2> spline;
+//		normalised_spline_solver(spline);
+//
+// The systems are built with loops in constexpr functions, so (unlike the
+// rest of the library, which is C++11) this header requires C++14. Every
+// order is checked by BM_CommonSplineSolver, which is built as C++14.
+
 const unsigned int dim_sys_cubic = 4;
 const unsigned int dim_sys_quintic = 6;
 const unsigned int dim_sys_septic = 8;
 const unsigned int dim_sys_nonic = 10;
 
+typedef normalised_spline_t<dim_sys_cubic/2> normalised_cubic_spline_t;	//Continuous velocity
+typedef normalised_spline_t<dim_sys_quintic/2> normalised_quintic_spline_t;	//Continuous acceleration
+typedef normalised_spline_t<dim_sys_septic/2> normalised_septic_spline_t;	//Continuous jerk
+typedef normalised_spline_t<dim_sys_nonic/2> normalised_nonic_spline_t;		//Continuous snap
+
+constexpr double _spline_abs( const double x ) {
+	return (x < 0.0) ? -x : x;
+}
+
+// Generates a linear system of a set dimension for the use in solving for
+// a spline in the case that the spline is time-normalised.
+//	Outputs:
+//		M: The generated time-normalised linear system, with the N rows for
+//		   t0 followed by the N rows for tf, and the columns in ascending
+//		   order of powers
 template<std::size_t N>
-std::array<double,N> polyder(const std::array<double,N>& c);
+constexpr spline_matrix_t<2*N> spline_solver_gen_tnorm_ls( void ) {
+	spline_matrix_t<2*N> M = {};
+
+	// Go through each level of derivatives
+	for(std::size_t j = 0; j < N; j++) {
+		// Go through the powers that survive the derivation
+		for(std::size_t i = j; i < 2*N; i++) {
+			double coeff = 1.0;
+			for(std::size_t k = 0; k < j; k++)
+				coeff *= (double)(i - k);
+
+			// t0 section (0^0 = 1, otherwise 0)
+			M.m[j][i] = (i == j) ? coeff : 0.0;
+			// tf section (1^n = 1)
+			M.m[N+j][i] = coeff;
+		}
+	}
+
+	return M;
+}
 
+// Inverts the time-normalised linear system (Gauss-Jordan elimination with
+// partial pivoting), intended to be evaluated at compile time
 template<std::size_t N>
-constexpr Eigen::Matrix<double,2*N,2*N> spline_solver_gen_tnorm_ls();
+constexpr spline_matrix_t<2*N> normalised_spline_solver_gen_inv_sys( void ) {
+	spline_matrix_t<2*N> A = spline_solver_gen_tnorm_ls<N>();
+	spline_matrix_t<2*N> Ai = {};
 
+	for(std::size_t i = 0; i < 2*N; i++)
+		Ai.m[i][i] = 1.0;
+
+	for(std::size_t c = 0; c < 2*N; c++) {
+		std::size_t p = c;
+		for(std::size_t r = c + 1; r < 2*N; r++) {
+			if( _spline_abs(A.m[r][c]) > _spline_abs(A.m[p][c]) )
+				p = r;
+		}
+
+		for(std::size_t k = 0; k < 2*N; k++) {
+			const double ta = A.m[c][k];
+			A.m[c][k] = A.m[p][k];
+			A.m[p][k] = ta;
+
+			const double ti = Ai.m[c][k];
+			Ai.m[c][k] = Ai.m[p][k];
+			Ai.m[p][k] = ti;
+		}
+
+		const double pivot = A.m[c][c];
+		for(std::size_t k = 0; k < 2*N; k++) {
+			A.m[c][k] /= pivot;
+			Ai.m[c][k] /= pivot;
+		}
+
+		for(std::size_t r = 0; r < 2*N; r++) {
+			if(r != c) {
+				const double f = A.m[r][c];
+				for(std::size_t k = 0; k < 2*N; k++) {
+					A.m[r][k] -= f*A.m[c][k];
+					Ai.m[r][k] -= f*Ai.m[c][k];
+				}
+			}
+		}
+	}
+
+	return Ai;
+}
+
+//Compile-time constant inverse system for each order
 template<std::size_t N>
-constexpr Eigen::Matrix<double,2*N,2*N> normalised_spline_solver_gen_inv_sys();
+struct normalised_spline_inv_sys {
+	static constexpr spline_matrix_t<2*N> value = normalised_spline_solver_gen_inv_sys<N>();
+};
 
 template<std::size_t N>
-void normalised_spline_solver(normalised_spline_t<N>& spline);
+constexpr spline_matrix_t<2*N> normalised_spline_inv_sys<N>::value;
 
+//Returns the a vector representing the derivative of a polynomial
+//c holds n coefficients in descending order of powers, and the result
+//holds n-1 coefficients (remaining entries are zeroed)
+template<std::size_t L>
+inline std::array<double,L> polyder( const std::array<double,L>& c, const std::size_t n ) {
+	std::array<double,L> dc;
+	dc.fill(0.0);
+
+	for(std::size_t i = 0; (i + 1) < n; i++)
+		dc[i] = (n - 1 - i)*c[i];
+
+	return dc;
+}
+
+//Solves the coefficients of every segment in a spline
+//The start/end vias and the duration of each segment must be set
 template<std::size_t N>
-spline_via_t<N> normalised_spline_lookup(const polynomial_segment_t<N>& seg, const double ndt);
+inline void normalised_spline_solver( normalised_spline_t<N>& spline ) {
+	const spline_matrix_t<2*N>& Mi = normalised_spline_inv_sys<N>::value;
+
+	for(auto& seg : spline) {
+		//b=[q0; qd0*dt; qdd0*(dt^2); ...; qf; qdf*dt; qddf*(dt^2); ...];
+		double b[2*N];
+		double nsdt = 1.0;
+		for(std::size_t i = 0; i < N; i++) {
+			b[i] = seg.start[i]*nsdt;
+			b[N+i] = seg.end[i]*nsdt;
+			nsdt *= seg.duration;
+		}
+
+		//a = inv(M)*b;
+		//Reverse allocate as we want to get the coefficients in decending order of powers
+		seg.coeffs[0].fill(0.0);
+		for(std::size_t r = 0; r < 2*N; r++) {
+			double a = 0.0;
+			for(std::size_t k = 0; k < 2*N; k++)
+				a += Mi.m[r][k]*b[k];
+
+			seg.coeffs[0][2*N-1-r] = a;
+		}
+
+		//...and coefficient derivatives
+		for(std::size_t i = 1; i < N; i++)
+			seg.coeffs[i] = polyder(seg.coeffs[i-1], 2*N-i+1);
+	}
+}
 
-/*
-const
+//Horner evaluation, unrolled at compile time for K coefficients
+template<std::size_t K>
+struct _spline_horner {
+	static inline double eval( const double* c, const double u, const double r ) {
+		return _spline_horner<K-1>::eval(c + 1, u, r*u + c[0]);
+	}
+};
 
-class CommonSplineSolver {
-	public:
-		quintic_spline_coeffs_t solver( const double q0,
-										const double qd0,
-										const double qdd0,
-										const double qf,
-										const double qdf,
-										const double qddf );
+template<>
+struct _spline_horner<0> {
+	static inline double eval( const double*, const double, const double r ) {
+		return r;
+	}
+};
 
-		Eigen::VectorXd linear_derivative_est( const Eigen::VectorXd& vias,
-											   const double dt );
+//Evaluates each derivative level I (2N-I coefficients), and denormalises
+//it by duration^I
+template<std::size_t N, std::size_t I>
+struct _spline_lookup_level {
+	static inline void eval( const polynomial_coeffs_t<N>& c,
+							 const double u,
+							 const double inv_dt,
+							 const double scale,
+							 spline_via_t<N>& q ) {
+		q[I] = _spline_horner<2*N-I>::eval(c[I].data(), u, 0.0) * scale;
+		_spline_lookup_level<N, I+1>::eval(c, u, inv_dt, scale*inv_dt, q);
+	}
+};
 
-		quintic_spline_point_t lookup(const double u, const quintic_spline_coeffs_t& c);
+template<std::size_t N>
+struct _spline_lookup_level<N, N> {
+	static inline void eval( const polynomial_coeffs_t<N>&,
+							 const double,
+							 const double,
+							 const double,
+							 spline_via_t<N>& ) {
+	}
 };
-*/
+
+//Returns the denormalised via values
+template<std::size_t N>
+inline spline_via_t<N> normalised_spline_lookup( const polynomial_segment_t<N>& seg, const double ndt ) {
+	assert((ndt >= 0.0) && (ndt <= 1.0));
+
+	spline_via_t<N> q;
+	_spline_lookup_level<N, 0>::eval(seg.coeffs, ndt, 1.0 / seg.duration, 1.0, q);
+
+	return q;
+}
 
 }
 
@@ -3,15 +3,30 @@
 
 #include <vector>
 #include <array>
+#include <cstddef>
 
 namespace contrail_spline_lib {
 
+// N is the number of constraints at each end of a segment
+// (e.g. N=3 for position, velocity and acceleration), which
+// gives a polynomial of order 2N-1 (see dim_sys_*)
+
+//Value and the first N-1 derivatives at a via
 template <std::size_t N>
 using spline_via_t = std::array<double,N>;
 
+//Polynomial coefficients for the value (row 0) and each derivative (row i),
+//in descending order of powers. Row i holds 2N-i coefficients, and the
+//remaining entries are left as zero
 template <std::size_t N>
-using polynomial_coeffs_t = std::array<std::vector<double>,N>;
+using polynomial_coeffs_t = std::array<std::array<double,2*N>,N>;
 
+//Square matrix used for the time-normalised linear systems
+//(a plain array so it can be built and inverted at compile time)
+template <std::size_t D>
+struct spline_matrix_t {
+	double m[D][D];
+};
 
 template<std::size_t N>
 struct polynomial_segment_t {
@@ -20,7 +35,7 @@ struct polynomial_segment_t {
 	polynomial_coeffs_t<N> coeffs;
 	double duration;
 
-	const size_t order = 2*N-1;
+	static constexpr std::size_t order = 2*N-1;
 };
 
 template<std::size_t N>
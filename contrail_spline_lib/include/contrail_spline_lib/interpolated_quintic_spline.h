@@ -7,34 +7,89 @@
 #include <eigen3/Eigen/Dense>
 
 #include <vector>
+#include <cstddef>
 
 namespace contrail_spline_lib {
 
+// Quintic spline interpolated through a list of vias
+//
+// The spline is looked up with normalised time (0 <= u <= 1), and the
+// derivatives (both lookups and the dvias/ddvias) are with respect to u.
+// By default the vias are spread evenly over u, otherwise each via may
+// be given its own knot time.
+//
+// If a capacity is given at construction, all storage is allocated up
+// front and interpolate() will never allocate (it fails if given more
+// vias than the capacity). Otherwise the storage grows as needed, and is
+// reused between calls.
+//
+// The spline ends at rest, unless the derivatives at the first via are set
+// (see set_start_derivatives()), e.g. to carry on from the current state of
+// another spline without a jump in velocity or acceleration.
 class InterpolatedQuinticSpline {
 	private:
-		std::vector<quintic_spline_coeffs_t> _subsplines;
+		multi_segment_quintic_spline_t _spline;
 
-		Eigen::VectorXd _vias;
-		Eigen::VectorXd _dvias;
-		Eigen::VectorXd _ddvias;
+		std::vector<double> _vias;
+		std::vector<double> _dvias;
+		std::vector<double> _ddvias;
+		std::vector<double> _work;	//Scratch space for the min-jerk solver
 
 		QuinticSplineSolver _solver;
+		interpolation_mode_t _mode;
+		double _start_dvia;
+		double _start_ddvia;
 
+		size_t _capacity;
+		bool _is_uniform;
 		bool _is_valid;
 
+		void _locate( const double u, size_t& seg, double& u_seg, double& inv_h ) const;
+		void _lookup_lanes( const double* u, const size_t n, quintic_spline_point_t* out ) const;
+
 	public:
 		InterpolatedQuinticSpline( void );
+		//Fixed-capacity mode, holding at most "capacity" vias
+		explicit InterpolatedQuinticSpline( const size_t capacity );
 		~InterpolatedQuinticSpline( void );
 
+		//Interpolates with the vias spread evenly over the spline
 		bool interpolate( const Eigen::VectorXd& vias );
+		//Interpolates with each via reached at the matching knot time
+		//The knots must be strictly increasing, and are normalised onto 0 <= u <= 1
+		bool interpolate( const Eigen::VectorXd& vias, const Eigen::VectorXd& knots );
+		//As above, from raw arrays of num_vias values (knots may be NULL for even spacing)
+		bool interpolate( const double* vias, const size_t num_vias, const double* knots = NULL );
+
+		Eigen::Map<const Eigen::VectorXd> get_vias( void ) const;
+		Eigen::Map<const Eigen::VectorXd> get_dvias( void ) const;
+		Eigen::Map<const Eigen::VectorXd> get_ddvias( void ) const;
+		const std::vector<double>& get_knots( void ) const;
+
+		//Sets how the via derivatives are found (used by the next interpolate())
+		inline void set_mode( const interpolation_mode_t mode ) { _mode = mode; };
+		inline interpolation_mode_t get_mode( void ) const { return _mode; };
+		//Sets the derivatives at the first via, with respect to u like
+		//get_dvias() (used by the next interpolate(), zero by default)
+		inline void set_start_derivatives( const double dvia, const double ddvia ) { _start_dvia = dvia; _start_ddvia = ddvia; };
+
+		inline size_t get_num_vias( void ) const { return _vias.size(); };
+		inline size_t get_capacity( void ) const { return _capacity; };
 
-		const Eigen::VectorXd& get_vias( void );
-		const Eigen::VectorXd& get_dvias( void );
-		const Eigen::VectorXd& get_ddvias( void );
+		//Lookups don't modify the spline, so may be made from any number of
+		//threads at once (as long as it isn't re-interpolated meanwhile)
+		//u is clamped to [0, 1], and NaN is looked up at 0
+		quintic_spline_point_t lookup( double u ) const;
 
-		quintic_spline_point_t lookup( double u );
+		//Batched lookups, results are identical to calling lookup() for each u
+		//(NaN included, whichever SIMD width the library is built with)
+		//lookup_batch:	evaluates the "n" points in "u" into "out"
+		//lookup_uniform: evaluates "n" points on the grid u0 + i*du into "out"
+		void lookup_batch( const double* u, const size_t n, quintic_spline_point_t* out ) const;
+		void lookup_uniform( const double u0, const double du, const size_t n, quintic_spline_point_t* out ) const;
 
-		const inline bool is_valid( void ) { return _is_valid; };
+		inline bool is_valid( void ) const { return _is_valid; };
+		inline bool is_uniform( void ) const { return _is_uniform; };
 };
 
 }
@@ -0,0 +1,55 @@
+#ifndef CONTRAIL_SPLINE_LIB_PACKED_QUINTIC_CURSOR_H
+#define CONTRAIL_SPLINE_LIB_PACKED_QUINTIC_CURSOR_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Stateful lookup for a PackedQuinticTrajectory that is queried with
+// (mostly) increasing times, such as in a control loop
+//
+// The cursor remembers the current segment, and steps forward to the next
+// one as time passes, so monotonic lookups take amortised O(1) time and
+// never search the knots. Stepping backwards falls back to a full search.
+//
+// The coefficients of the current segment are cached with the segment
+// duration folded in (in powers of the seconds since the segment start),
+// so a lookup is a single polynomial pass with no denormalisation.
+//
+// The cursor must be reset whenever the trajectory is re-packed.
+template<typename Scalar>
+class BasicPackedQuinticCursor {
+	private:
+		const BasicPackedQuinticTrajectory<Scalar>* _trajectory;
+
+		size_t _seg;
+		double _t0;	//Start time of the current segment
+		double _t1;	//End time of the current segment
+
+		basic_packed_quintic_segment_t<Scalar> _coeffs;	//Denormalised coefficients of the current segment
+		double _origin[packed_channels];	//Position the coefficients are relative to (zero if not rebased)
+
+		void _load( const size_t seg );
+
+	public:
+		BasicPackedQuinticCursor( void );
+		~BasicPackedQuinticCursor( void );
+
+		//Attaches the cursor to a (packed) trajectory, starting at the first segment
+		void reset( const BasicPackedQuinticTrajectory<Scalar>& trajectory );
+
+		packed_quintic_point_t lookup( const double t );
+
+		inline size_t get_segment( void ) const { return _seg; };
+		inline bool is_valid( void ) const { return ( _trajectory != NULL ) && _trajectory->is_valid(); };
+};
+
+typedef BasicPackedQuinticCursor<double> PackedQuinticCursor;
+typedef BasicPackedQuinticCursor<float> PackedQuinticCursorF;
+
+}
+
+#endif
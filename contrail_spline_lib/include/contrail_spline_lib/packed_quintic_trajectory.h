@@ -0,0 +1,175 @@
+#ifndef CONTRAIL_SPLINE_LIB_PACKED_QUINTIC_TRAJECTORY_H
+#define CONTRAIL_SPLINE_LIB_PACKED_QUINTIC_TRAJECTORY_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/quintic_spline_solver.h>
+#include <contrail_spline_lib/interpolated_quintic_spline.h>
+#include <contrail_spline_lib/aligned_allocator.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <stdint.h>
+
+namespace contrail_spline_lib {
+
+// A 4-channel (x, y, z, yaw) trajectory sharing a single set of knots
+//
+// The coefficients for all channels of a segment are stored together
+// (see packed_quintic_segment_t), so a lookup costs a single segment
+// search and a single polynomial pass for all channels.
+//
+// Unlike InterpolatedQuinticSpline, the trajectory is indexed by time in
+// seconds (0 <= t <= duration), and all derivatives are returned in
+// per-second units. Uniform knots are located directly, otherwise the
+// segment is found with a binary search of the knot times.
+//
+// A packed trajectory can be saved to a binary trajectory file (see
+// trajectory_file.h), and loaded again by mapping the file into memory.
+// A loaded trajectory is evaluated directly from the mapped pages, so
+// nothing is solved or copied, and only the pages that are looked up
+// are ever read in.
+//
+// The coefficients are stored (and evaluated) as "Scalar", either double
+// (PackedQuinticTrajectory) or float (PackedQuinticTrajectoryF). The
+// splines are always solved in double precision, and the knot times and
+// lookup results are always double. A float segment is half the size, so
+// twice as many fit in the same memory bandwidth, and all 4 channels are
+// evaluated in one 128-bit vector. Positions are accurate to about 1e-7 of
+// their distance from the origin (e.g. ~0.1mm at 1km), and derivatives to
+// about 1e-5 (relative), see BM_FourAxisPackedF32 for the accuracy check.
+//
+// With rebasing enabled (see set_rebasing()), the position at the start of
+// each segment is held separately in double precision, and the stored
+// coefficients are relative to it. The position error then only scales
+// with the movement within each segment, regardless of the offset.
+template<typename Scalar>
+class BasicPackedQuinticTrajectory {
+	public:
+		typedef basic_packed_quintic_segment_t<Scalar> segment_t;
+
+	private:
+		std::vector<segment_t, aligned_allocator<segment_t, 64> > _segments;
+
+		std::vector<double> _knots;	//Knot times (seconds), including the end of the last segment
+		std::vector<double> _origins;	//Position at the start of each segment (rebasing only)
+
+		//Active storage, either the vectors above or a mapped trajectory file
+		const segment_t* _segment_data;
+		const double* _knot_data;
+		const double* _origin_data;	//NULL if not rebased
+		size_t _num_segments;
+
+		std::shared_ptr<const void> _map;	//Mapped trajectory file (shared by assign(), empty if not mapped)
+		size_t _map_size;
+
+		double _duration;
+		double _inv_seg_duration;	//Only used for uniform knots
+
+		size_t _capacity;	//Maximum number of segments (0 to grow as needed)
+
+		QuinticSplineSolver _solver;
+
+		bool _rebase;	//Used by the next pack()
+		bool _is_uniform;
+		bool _is_valid;
+
+		void _unmap( void );
+		//Evaluates n samples (t + j*dt) that all lie within segment seg by forward differencing
+		void _lookup_run( const size_t seg, const double t, const double dt, const size_t n, packed_quintic_point_t* out ) const;
+		//Rounds a solved segment into channel c of the packed storage
+		void _store( const size_t seg, const size_t c, const quintic_spline_coeffs_t& a );
+
+		static inline bool _single_precision( void ) { return sizeof(Scalar) == sizeof(float); };
+		//Rounds a file offset up to the next 64-byte boundary
+		static inline uint64_t _align_offset( const uint64_t offset ) { return (offset + 63) & ~(uint64_t)63; };
+		//Checks count items of size bytes at offset lie within the mapped file, without overflowing
+		inline bool _fits_in_map( const uint64_t offset, const uint64_t count, const uint64_t size ) const {
+			return ( offset <= _map_size ) && ( count <= ( _map_size - offset ) / size );
+		};
+
+		//The storage pointers refer to this object, so it can't be copied
+		BasicPackedQuinticTrajectory( const BasicPackedQuinticTrajectory& ) = delete;
+		BasicPackedQuinticTrajectory& operator=( const BasicPackedQuinticTrajectory& ) = delete;
+
+	public:
+		BasicPackedQuinticTrajectory( void );
+		//Fixed-capacity mode, all storage is allocated up front and pack()
+		//will fail rather than allocate for more than "capacity" segments
+		explicit BasicPackedQuinticTrajectory( const size_t capacity );
+		~BasicPackedQuinticTrajectory( void );
+
+		//Sets whether the coefficients are stored relative to the start of
+		//each segment (used by the next pack())
+		inline void set_rebasing( const bool rebase ) { _rebase = rebase; };
+
+		//Packs 4 interpolated splines to be flown over "duration" seconds
+		//The knots are those of every spline together, so a spline with
+		//fewer knots has its segments split (not refitted) at the knots of
+		//the others, and every channel still follows its own spline exactly
+		bool pack( const InterpolatedQuinticSpline& x,
+				   const InterpolatedQuinticSpline& y,
+				   const InterpolatedQuinticSpline& z,
+				   const InterpolatedQuinticSpline& yaw,
+				   const double duration );
+
+		//Copies another trajectory into this one's storage, e.g. to hand it
+		//to another thread that can't share the original. A mapped trajectory
+		//is not copied (or read in), its mapping is shared instead, as it is
+		//read-only and only released once no trajectory still uses it
+		bool assign( const BasicPackedQuinticTrajectory& other );
+
+		//Joins segments [first, last) of "head" onto the start of the whole of
+		//"tail", with the knots shifted so that the result starts at 0. The
+		//segments are copied as they are (nothing is solved), so the result
+		//matches head exactly up to the join. Both must be valid, and either
+		//both or neither rebased, and neither may be this trajectory
+		bool splice( const BasicPackedQuinticTrajectory& head, const size_t first, const size_t last,
+					 const BasicPackedQuinticTrajectory& tail );
+		//As above, but joining the tail on at time t of the head, with the
+		//segment containing t cut short there (a quintic restricted to part
+		//of its segment is still a quintic, so it is only rescaled)
+		bool splice_at( const BasicPackedQuinticTrajectory& head, const size_t first, const double t,
+						const BasicPackedQuinticTrajectory& tail );
+
+		//Writes the trajectory to a binary trajectory file. An existing file is
+		//replaced whole (renamed over), so trajectories already mapped from it
+		//keep reading the old one
+		bool save( const std::string& filename ) const;
+		//Maps a binary trajectory file (read-only) in place of the packed
+		//trajectory. The mapping is released by the next pack(), assign(), splice() or load()
+		//(of this and of every trajectory it has been assigned to)
+		bool load( const std::string& filename );
+
+		//Returns the index of the segment containing t
+		size_t locate( const double t ) const;
+
+		packed_quintic_point_t lookup( const double t ) const;
+		//Evaluates "n" points on the grid t0 + i*dt into "out", for dense
+		//resampling at a fixed rate. Within each segment the points are
+		//stepped by forward differencing (a few additions per point),
+		//starting again from the polynomial every 256 points and at each
+		//knot, so rounding errors can't build up. The results match lookup()
+		//to within rounding (of the double evaluation for float segments)
+		void lookup_uniform( const double t0, const double dt, const size_t n, packed_quintic_point_t* out ) const;
+
+		inline double get_duration( void ) const { return _duration; };
+		inline size_t get_num_segments( void ) const { return _num_segments; };
+		//Knot times (get_num_segments() + 1 values)
+		inline const double* get_knots( void ) const { return _knot_data; };
+		//Coefficients of segment i (the a[0] row is relative to get_origin(i) if rebased)
+		inline const segment_t& get_segment( const size_t i ) const { return _segment_data[i]; };
+		//Position that segment i is relative to (packed_channels values), or NULL if not rebased
+		inline const double* get_origin( const size_t i ) const { return ( _origin_data != NULL ) ? &_origin_data[i*packed_channels] : NULL; };
+		inline bool is_rebased( void ) const { return _origin_data != NULL; };
+		inline bool is_mapped( void ) const { return _map.get() != NULL; };
+		inline bool is_valid( void ) const { return _is_valid; };
+};
+
+typedef BasicPackedQuinticTrajectory<double> PackedQuinticTrajectory;
+typedef BasicPackedQuinticTrajectory<float> PackedQuinticTrajectoryF;
+
+}
+
+#endif
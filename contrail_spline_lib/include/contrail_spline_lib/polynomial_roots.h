@@ -0,0 +1,58 @@
+#ifndef CONTRAIL_SPLINE_LIB_POLYNOMIAL_ROOTS_H
+#define CONTRAIL_SPLINE_LIB_POLYNOMIAL_ROOTS_H
+
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Real root isolation for low-order polynomials over an interval
+//
+// The roots of the derivative split the interval into pieces where the
+// polynomial is monotonic, so each piece holds at most one root, which is
+// then found with a bracketed Newton iteration. The derivative roots are
+// found the same way (recursively), down to a linear polynomial.
+//
+// Coefficients are in ascending order of powers (c[0] + c[1]*u + ...),
+// the same as the quintic_spline_coeffs_t layout.
+
+const size_t polynomial_roots_max_degree = 8;
+
+//Evaluates a polynomial of the given degree at u (Horner form)
+inline double polynomial_eval( const double* c, const size_t degree, const double u ) {
+	double p = c[degree];
+	for(size_t i = degree; i > 0; i--)
+		p = p*u + c[i-1];
+
+	return p;
+}
+
+//Finds the real roots of c in [lo, hi], returned in ascending order
+//roots must have space for "degree" values (degree <= polynomial_roots_max_degree)
+//Returns the number of roots found
+size_t polynomial_roots( const double* c,
+						 const size_t degree,
+						 const double lo,
+						 const double hi,
+						 double* roots );
+
+//Finds the turning points of c in (lo, hi), i.e. the roots of its derivative
+//extrema must have space for "degree - 1" values
+//Returns the number of turning points found
+size_t polynomial_extrema( const double* c,
+						   const size_t degree,
+						   const double lo,
+						   const double hi,
+						   double* extrema );
+
+//Finds the range of c over [lo, hi] (exactly, from its values at each end
+//and at its turning points)
+void polynomial_range( const double* c,
+					   const size_t degree,
+					   const double lo,
+					   const double hi,
+					   double& min,
+					   double& max );
+
+}
+
+#endif
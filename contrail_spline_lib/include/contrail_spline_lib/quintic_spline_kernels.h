@@ -0,0 +1,423 @@
+#ifndef CONTRAIL_SPLINE_LIB_QUINTIC_SPLINE_KERNELS_H
+#define CONTRAIL_SPLINE_LIB_QUINTIC_SPLINE_KERNELS_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace contrail_spline_lib {
+
+// Solver and evaluation kernels for a normalised quintic polynomial segment
+//
+// All kernels evaluate the polynomial and its first two derivatives in
+// Horner form, with the derivative coefficients folded in:
+//		q   = ((((a6*u + a5)*u + a4)*u + a3)*u + a2)*u + a1
+//		qd  = (((5*a6*u + 4*a5)*u + 3*a4)*u + 2*a3)*u + a2
+//		qdd = ((20*a6*u + 12*a5)*u + 6*a4)*u + 2*a3
+//
+// The wide kernels evaluate one (possibly different) segment per lane, and
+// expect the coefficients to already be loaded lane-wise.
+//
+// The scalar kernels are templated on the scalar type (double or float).
+
+// Index of the segment (of num_seg evenly spaced ones) at x, the time in
+// segments from the start, once clamped to [0, num_seg]. The end is in the
+// last segment, and NaN (which passes through a clamp, and can't be cast
+// to an index) is in the first.
+inline size_t segment_index( const double x, const size_t num_seg ) {
+	return ( x > 0.0 ) ? (size_t)std::min( std::floor(x), (double)(num_seg - 1) ) : 0;
+}
+
+template<typename Scalar>
+inline basic_quintic_spline_point_t<Scalar> quintic_horner( const Scalar u, const basic_quintic_spline_coeffs_t<Scalar>& c ) {
+	basic_quintic_spline_point_t<Scalar> p;
+
+	p.q = ((((c.a6*u + c.a5)*u + c.a4)*u + c.a3)*u + c.a2)*u + c.a1;
+	p.qd = ((((Scalar)5*c.a6*u + (Scalar)4*c.a5)*u + (Scalar)3*c.a4)*u + (Scalar)2*c.a3)*u + c.a2;
+	p.qdd = (((Scalar)20*c.a6*u + (Scalar)12*c.a5)*u + (Scalar)6*c.a4)*u + (Scalar)2*c.a3;
+
+	return p;
+}
+
+// Closed-form solution for a normalised quintic segment (t0=0; tf=1)
+// with position, velocity and acceleration constraints at each end
+// (see QuinticSplineSolver::solver() for the derivation)
+template<typename Scalar>
+inline basic_quintic_spline_coeffs_t<Scalar> quintic_solve( const Scalar q0, const Scalar qd0, const Scalar qdd0,
+															const Scalar qf, const Scalar qdf, const Scalar qddf ) {
+	basic_quintic_spline_coeffs_t<Scalar> c;
+	const Scalar dq = qf - q0;
+
+	c.a1 = q0;
+	c.a2 = qd0;
+	c.a3 = (Scalar)0.5*qdd0;
+	c.a4 = (Scalar)10*dq - (Scalar)6*qd0 - (Scalar)4*qdf - (Scalar)1.5*qdd0 + (Scalar)0.5*qddf;
+	c.a5 = (Scalar)-15*dq + (Scalar)8*qd0 + (Scalar)7*qdf + (Scalar)1.5*qdd0 - qddf;
+	c.a6 = (Scalar)6*dq - (Scalar)3*qd0 - (Scalar)3*qdf - (Scalar)0.5*qdd0 + (Scalar)0.5*qddf;
+
+	return c;
+}
+
+#if defined(__AVX__)
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH 4
+
+inline __m256d _quintic_madd_x4( const __m256d a, const __m256d b, const __m256d c ) {
+#if defined(__FMA__)
+	return _mm256_fmadd_pd(a, b, c);
+#else
+	return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+
+inline void quintic_horner_x4( const __m256d u,
+							   const __m256d a1, const __m256d a2, const __m256d a3,
+							   const __m256d a4, const __m256d a5, const __m256d a6,
+							   __m256d& q, __m256d& qd, __m256d& qdd ) {
+	const __m256d a3_2 = _mm256_mul_pd(a3, _mm256_set1_pd(2.0));
+	const __m256d a4_3 = _mm256_mul_pd(a4, _mm256_set1_pd(3.0));
+	const __m256d a5_4 = _mm256_mul_pd(a5, _mm256_set1_pd(4.0));
+	const __m256d a6_5 = _mm256_mul_pd(a6, _mm256_set1_pd(5.0));
+
+	q = _quintic_madd_x4(a6, u, a5);
+	q = _quintic_madd_x4(q, u, a4);
+	q = _quintic_madd_x4(q, u, a3);
+	q = _quintic_madd_x4(q, u, a2);
+	q = _quintic_madd_x4(q, u, a1);
+
+	qd = _quintic_madd_x4(a6_5, u, a5_4);
+	qd = _quintic_madd_x4(qd, u, a4_3);
+	qd = _quintic_madd_x4(qd, u, a3_2);
+	qd = _quintic_madd_x4(qd, u, a2);
+
+	qdd = _quintic_madd_x4(_mm256_mul_pd(a6, _mm256_set1_pd(20.0)), u, _mm256_mul_pd(a5, _mm256_set1_pd(12.0)));
+	qdd = _quintic_madd_x4(qdd, u, _mm256_mul_pd(a4, _mm256_set1_pd(6.0)));
+	qdd = _quintic_madd_x4(qdd, u, a3_2);
+}
+
+inline __m256d _quintic_dot5_x4( const double k0, const __m256d x0, const double k1, const __m256d x1,
+								 const double k2, const __m256d x2, const double k3, const __m256d x3,
+								 const double k4, const __m256d x4 ) {
+	__m256d r = _mm256_mul_pd(_mm256_set1_pd(k0), x0);
+	r = _quintic_madd_x4(_mm256_set1_pd(k1), x1, r);
+	r = _quintic_madd_x4(_mm256_set1_pd(k2), x2, r);
+	r = _quintic_madd_x4(_mm256_set1_pd(k3), x3, r);
+	return _quintic_madd_x4(_mm256_set1_pd(k4), x4, r);
+}
+
+inline void quintic_solve_x4( const __m256d q0, const __m256d qd0, const __m256d qdd0,
+							  const __m256d qf, const __m256d qdf, const __m256d qddf,
+							  __m256d& a1, __m256d& a2, __m256d& a3,
+							  __m256d& a4, __m256d& a5, __m256d& a6 ) {
+	const __m256d dq = _mm256_sub_pd(qf, q0);
+
+	a1 = q0;
+	a2 = qd0;
+	a3 = _mm256_mul_pd(_mm256_set1_pd(0.5), qdd0);
+	a4 = _quintic_dot5_x4(10.0, dq, -6.0, qd0, -4.0, qdf, -1.5, qdd0, 0.5, qddf);
+	a5 = _quintic_dot5_x4(-15.0, dq, 8.0, qd0, 7.0, qdf, 1.5, qdd0, -1.0, qddf);
+	a6 = _quintic_dot5_x4(6.0, dq, -3.0, qd0, -3.0, qdf, -0.5, qdd0, 0.5, qddf);
+}
+#elif defined(__SSE2__)
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH 2
+
+inline __m128d _quintic_madd_x2( const __m128d a, const __m128d b, const __m128d c ) {
+	return _mm_add_pd(_mm_mul_pd(a, b), c);
+}
+
+inline void quintic_horner_x2( const __m128d u,
+							   const __m128d a1, const __m128d a2, const __m128d a3,
+							   const __m128d a4, const __m128d a5, const __m128d a6,
+							   __m128d& q, __m128d& qd, __m128d& qdd ) {
+	const __m128d a3_2 = _mm_mul_pd(a3, _mm_set1_pd(2.0));
+	const __m128d a4_3 = _mm_mul_pd(a4, _mm_set1_pd(3.0));
+	const __m128d a5_4 = _mm_mul_pd(a5, _mm_set1_pd(4.0));
+	const __m128d a6_5 = _mm_mul_pd(a6, _mm_set1_pd(5.0));
+
+	q = _quintic_madd_x2(a6, u, a5);
+	q = _quintic_madd_x2(q, u, a4);
+	q = _quintic_madd_x2(q, u, a3);
+	q = _quintic_madd_x2(q, u, a2);
+	q = _quintic_madd_x2(q, u, a1);
+
+	qd = _quintic_madd_x2(a6_5, u, a5_4);
+	qd = _quintic_madd_x2(qd, u, a4_3);
+	qd = _quintic_madd_x2(qd, u, a3_2);
+	qd = _quintic_madd_x2(qd, u, a2);
+
+	qdd = _quintic_madd_x2(_mm_mul_pd(a6, _mm_set1_pd(20.0)), u, _mm_mul_pd(a5, _mm_set1_pd(12.0)));
+	qdd = _quintic_madd_x2(qdd, u, _mm_mul_pd(a4, _mm_set1_pd(6.0)));
+	qdd = _quintic_madd_x2(qdd, u, a3_2);
+}
+
+inline __m128d _quintic_dot5_x2( const double k0, const __m128d x0, const double k1, const __m128d x1,
+								 const double k2, const __m128d x2, const double k3, const __m128d x3,
+								 const double k4, const __m128d x4 ) {
+	__m128d r = _mm_mul_pd(_mm_set1_pd(k0), x0);
+	r = _quintic_madd_x2(_mm_set1_pd(k1), x1, r);
+	r = _quintic_madd_x2(_mm_set1_pd(k2), x2, r);
+	r = _quintic_madd_x2(_mm_set1_pd(k3), x3, r);
+	return _quintic_madd_x2(_mm_set1_pd(k4), x4, r);
+}
+
+inline void quintic_solve_x2( const __m128d q0, const __m128d qd0, const __m128d qdd0,
+							  const __m128d qf, const __m128d qdf, const __m128d qddf,
+							  __m128d& a1, __m128d& a2, __m128d& a3,
+							  __m128d& a4, __m128d& a5, __m128d& a6 ) {
+	const __m128d dq = _mm_sub_pd(qf, q0);
+
+	a1 = q0;
+	a2 = qd0;
+	a3 = _mm_mul_pd(_mm_set1_pd(0.5), qdd0);
+	a4 = _quintic_dot5_x2(10.0, dq, -6.0, qd0, -4.0, qdf, -1.5, qdd0, 0.5, qddf);
+	a5 = _quintic_dot5_x2(-15.0, dq, 8.0, qd0, 7.0, qdf, 1.5, qdd0, -1.0, qddf);
+	a6 = _quintic_dot5_x2(6.0, dq, -3.0, qd0, -3.0, qdf, -0.5, qdd0, 0.5, qddf);
+}
+#else
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH 1
+#endif
+
+// Single precision kernels, with all 4 packed channels in one 128-bit
+// vector (twice the lanes of the double precision kernels on SSE2 and NEON)
+#if defined(__SSE2__)
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH_F32 4
+
+typedef __m128 quintic_f4_t;
+
+inline quintic_f4_t _quintic_set1_f4( const float x ) { return _mm_set1_ps(x); }
+inline quintic_f4_t _quintic_load_f4( const float* x ) { return _mm_loadu_ps(x); }
+inline void _quintic_store_f4( float* x, const quintic_f4_t v ) { _mm_storeu_ps(x, v); }
+inline quintic_f4_t _quintic_mul_f4( const quintic_f4_t a, const float k ) { return _mm_mul_ps(a, _mm_set1_ps(k)); }
+
+inline quintic_f4_t _quintic_madd_f4( const quintic_f4_t a, const quintic_f4_t b, const quintic_f4_t c ) {
+#if defined(__FMA__)
+	return _mm_fmadd_ps(a, b, c);
+#else
+	return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+#elif defined(__ARM_NEON)
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH_F32 4
+
+typedef float32x4_t quintic_f4_t;
+
+inline quintic_f4_t _quintic_set1_f4( const float x ) { return vdupq_n_f32(x); }
+inline quintic_f4_t _quintic_load_f4( const float* x ) { return vld1q_f32(x); }
+inline void _quintic_store_f4( float* x, const quintic_f4_t v ) { vst1q_f32(x, v); }
+inline quintic_f4_t _quintic_mul_f4( const quintic_f4_t a, const float k ) { return vmulq_n_f32(a, k); }
+
+inline quintic_f4_t _quintic_madd_f4( const quintic_f4_t a, const quintic_f4_t b, const quintic_f4_t c ) {
+#if defined(__aarch64__)
+	return vfmaq_f32(c, a, b);
+#else
+	return vmlaq_f32(c, a, b);
+#endif
+}
+#else
+#define CONTRAIL_SPLINE_LIB_SIMD_WIDTH_F32 1
+#endif
+
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH_F32 == 4
+inline void quintic_horner_f4( const quintic_f4_t u,
+							   const quintic_f4_t a1, const quintic_f4_t a2, const quintic_f4_t a3,
+							   const quintic_f4_t a4, const quintic_f4_t a5, const quintic_f4_t a6,
+							   quintic_f4_t& q, quintic_f4_t& qd, quintic_f4_t& qdd ) {
+	const quintic_f4_t a3_2 = _quintic_mul_f4(a3, 2.0f);
+
+	q = _quintic_madd_f4(a6, u, a5);
+	q = _quintic_madd_f4(q, u, a4);
+	q = _quintic_madd_f4(q, u, a3);
+	q = _quintic_madd_f4(q, u, a2);
+	q = _quintic_madd_f4(q, u, a1);
+
+	qd = _quintic_madd_f4(_quintic_mul_f4(a6, 5.0f), u, _quintic_mul_f4(a5, 4.0f));
+	qd = _quintic_madd_f4(qd, u, _quintic_mul_f4(a4, 3.0f));
+	qd = _quintic_madd_f4(qd, u, a3_2);
+	qd = _quintic_madd_f4(qd, u, a2);
+
+	qdd = _quintic_madd_f4(_quintic_mul_f4(a6, 20.0f), u, _quintic_mul_f4(a5, 12.0f));
+	qdd = _quintic_madd_f4(qdd, u, _quintic_mul_f4(a4, 6.0f));
+	qdd = _quintic_madd_f4(qdd, u, a3_2);
+}
+#endif
+
+// Evaluates all channels of a packed segment, scaling the derivatives by
+// sd and sdd (e.g. to denormalise them)
+// Unaligned loads are used, as copies of a segment (e.g. on the heap) are
+// not guaranteed to keep their alignment before C++17
+inline void packed_quintic_horner( const double u, const packed_quintic_segment_t& c,
+								   const double sd, const double sdd,
+								   packed_quintic_point_t& p ) {
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 4
+	__m256d q, qd, qdd;
+	quintic_horner_x4( _mm256_set1_pd(u),
+					   _mm256_loadu_pd(c.a[0]), _mm256_loadu_pd(c.a[1]), _mm256_loadu_pd(c.a[2]),
+					   _mm256_loadu_pd(c.a[3]), _mm256_loadu_pd(c.a[4]), _mm256_loadu_pd(c.a[5]),
+					   q, qd, qdd );
+
+	_mm256_storeu_pd(p.q, q);
+	_mm256_storeu_pd(p.qd, _mm256_mul_pd(qd, _mm256_set1_pd(sd)));
+	_mm256_storeu_pd(p.qdd, _mm256_mul_pd(qdd, _mm256_set1_pd(sdd)));
+#elif CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 2
+	const __m128d uv = _mm_set1_pd(u);
+	for(unsigned int i = 0; i < packed_channels; i += 2) {
+		__m128d q, qd, qdd;
+		quintic_horner_x2( uv,
+						   _mm_loadu_pd(&c.a[0][i]), _mm_loadu_pd(&c.a[1][i]), _mm_loadu_pd(&c.a[2][i]),
+						   _mm_loadu_pd(&c.a[3][i]), _mm_loadu_pd(&c.a[4][i]), _mm_loadu_pd(&c.a[5][i]),
+						   q, qd, qdd );
+
+		_mm_storeu_pd(&p.q[i], q);
+		_mm_storeu_pd(&p.qd[i], _mm_mul_pd(qd, _mm_set1_pd(sd)));
+		_mm_storeu_pd(&p.qdd[i], _mm_mul_pd(qdd, _mm_set1_pd(sdd)));
+	}
+#else
+	for(unsigned int i = 0; i < packed_channels; i++) {
+		quintic_spline_coeffs_t a;
+		a.a1 = c.a[0][i];
+		a.a2 = c.a[1][i];
+		a.a3 = c.a[2][i];
+		a.a4 = c.a[3][i];
+		a.a5 = c.a[4][i];
+		a.a6 = c.a[5][i];
+
+		quintic_spline_point_t pc = quintic_horner(u, a);
+		p.q[i] = pc.q;
+		p.qd[i] = pc.qd*sd;
+		p.qdd[i] = pc.qdd*sdd;
+	}
+#endif
+}
+
+// As above, for a single precision segment
+// The polynomial is evaluated in single precision, and the results are
+// widened to double before the derivatives are scaled
+inline void packed_quintic_horner( const float u, const packed_quintic_segment_f_t& c,
+								   const double sd, const double sdd,
+								   packed_quintic_point_t& p ) {
+	float q[packed_channels];
+	float qd[packed_channels];
+	float qdd[packed_channels];
+
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH_F32 == 4
+	quintic_f4_t vq, vqd, vqdd;
+	quintic_horner_f4( _quintic_set1_f4(u),
+					   _quintic_load_f4(c.a[0]), _quintic_load_f4(c.a[1]), _quintic_load_f4(c.a[2]),
+					   _quintic_load_f4(c.a[3]), _quintic_load_f4(c.a[4]), _quintic_load_f4(c.a[5]),
+					   vq, vqd, vqdd );
+
+	_quintic_store_f4(q, vq);
+	_quintic_store_f4(qd, vqd);
+	_quintic_store_f4(qdd, vqdd);
+#else
+	for(unsigned int i = 0; i < packed_channels; i++) {
+		quintic_spline_coeffs_f_t a;
+		a.a1 = c.a[0][i];
+		a.a2 = c.a[1][i];
+		a.a3 = c.a[2][i];
+		a.a4 = c.a[3][i];
+		a.a5 = c.a[4][i];
+		a.a6 = c.a[5][i];
+
+		quintic_spline_point_f_t pc = quintic_horner(u, a);
+		q[i] = pc.q;
+		qd[i] = pc.qd;
+		qdd[i] = pc.qdd;
+	}
+#endif
+
+	for(unsigned int i = 0; i < packed_channels; i++) {
+		p.q[i] = q[i];
+		p.qd[i] = qd[i]*sd;
+		p.qdd[i] = qdd[i]*sdd;
+	}
+}
+
+// Steps the forward differences of q (dq, 5th order), qd (dqd, 4th order)
+// and qdd (dqdd, 3rd order) for all packed channels, writing the current
+// point to out[j] before each step. Every difference is advanced by the
+// previous value of the one above it, so each step is only additions, and
+// the differences are kept in registers for the whole run
+inline void packed_quintic_forward_diff( const double dq[6][packed_channels],
+										 const double dqd[5][packed_channels],
+										 const double dqdd[4][packed_channels],
+										 const size_t n, packed_quintic_point_t* out ) {
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 4
+	__m256d q0 = _mm256_loadu_pd(dq[0]), q1 = _mm256_loadu_pd(dq[1]), q2 = _mm256_loadu_pd(dq[2]),
+			q3 = _mm256_loadu_pd(dq[3]), q4 = _mm256_loadu_pd(dq[4]);
+	const __m256d q5 = _mm256_loadu_pd(dq[5]);
+	__m256d qd0 = _mm256_loadu_pd(dqd[0]), qd1 = _mm256_loadu_pd(dqd[1]), qd2 = _mm256_loadu_pd(dqd[2]),
+			qd3 = _mm256_loadu_pd(dqd[3]);
+	const __m256d qd4 = _mm256_loadu_pd(dqd[4]);
+	__m256d qdd0 = _mm256_loadu_pd(dqdd[0]), qdd1 = _mm256_loadu_pd(dqdd[1]), qdd2 = _mm256_loadu_pd(dqdd[2]);
+	const __m256d qdd3 = _mm256_loadu_pd(dqdd[3]);
+
+	for(size_t j = 0; j < n; j++) {
+		_mm256_storeu_pd(out[j].q, q0);
+		_mm256_storeu_pd(out[j].qd, qd0);
+		_mm256_storeu_pd(out[j].qdd, qdd0);
+
+		q0 = _mm256_add_pd(q0, q1); q1 = _mm256_add_pd(q1, q2); q2 = _mm256_add_pd(q2, q3);
+		q3 = _mm256_add_pd(q3, q4); q4 = _mm256_add_pd(q4, q5);
+		qd0 = _mm256_add_pd(qd0, qd1); qd1 = _mm256_add_pd(qd1, qd2); qd2 = _mm256_add_pd(qd2, qd3);
+		qd3 = _mm256_add_pd(qd3, qd4);
+		qdd0 = _mm256_add_pd(qdd0, qdd1); qdd1 = _mm256_add_pd(qdd1, qdd2); qdd2 = _mm256_add_pd(qdd2, qdd3);
+	}
+#elif CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 2
+	//One pass per pair of channels, so the differences fit in registers
+	for(unsigned int i = 0; i < packed_channels; i += 2) {
+		__m128d q0 = _mm_loadu_pd(&dq[0][i]), q1 = _mm_loadu_pd(&dq[1][i]), q2 = _mm_loadu_pd(&dq[2][i]),
+				q3 = _mm_loadu_pd(&dq[3][i]), q4 = _mm_loadu_pd(&dq[4][i]);
+		const __m128d q5 = _mm_loadu_pd(&dq[5][i]);
+		__m128d qd0 = _mm_loadu_pd(&dqd[0][i]), qd1 = _mm_loadu_pd(&dqd[1][i]), qd2 = _mm_loadu_pd(&dqd[2][i]),
+				qd3 = _mm_loadu_pd(&dqd[3][i]);
+		const __m128d qd4 = _mm_loadu_pd(&dqd[4][i]);
+		__m128d qdd0 = _mm_loadu_pd(&dqdd[0][i]), qdd1 = _mm_loadu_pd(&dqdd[1][i]), qdd2 = _mm_loadu_pd(&dqdd[2][i]);
+		const __m128d qdd3 = _mm_loadu_pd(&dqdd[3][i]);
+
+		for(size_t j = 0; j < n; j++) {
+			_mm_storeu_pd(&out[j].q[i], q0);
+			_mm_storeu_pd(&out[j].qd[i], qd0);
+			_mm_storeu_pd(&out[j].qdd[i], qdd0);
+
+			q0 = _mm_add_pd(q0, q1); q1 = _mm_add_pd(q1, q2); q2 = _mm_add_pd(q2, q3);
+			q3 = _mm_add_pd(q3, q4); q4 = _mm_add_pd(q4, q5);
+			qd0 = _mm_add_pd(qd0, qd1); qd1 = _mm_add_pd(qd1, qd2); qd2 = _mm_add_pd(qd2, qd3);
+			qd3 = _mm_add_pd(qd3, qd4);
+			qdd0 = _mm_add_pd(qdd0, qdd1); qdd1 = _mm_add_pd(qdd1, qdd2); qdd2 = _mm_add_pd(qdd2, qdd3);
+		}
+	}
+#else
+	for(unsigned int i = 0; i < packed_channels; i++) {
+		double q0 = dq[0][i], q1 = dq[1][i], q2 = dq[2][i], q3 = dq[3][i], q4 = dq[4][i];
+		const double q5 = dq[5][i];
+		double qd0 = dqd[0][i], qd1 = dqd[1][i], qd2 = dqd[2][i], qd3 = dqd[3][i];
+		const double qd4 = dqd[4][i];
+		double qdd0 = dqdd[0][i], qdd1 = dqdd[1][i], qdd2 = dqdd[2][i];
+		const double qdd3 = dqdd[3][i];
+
+		for(size_t j = 0; j < n; j++) {
+			out[j].q[i] = q0;
+			out[j].qd[i] = qd0;
+			out[j].qdd[i] = qdd0;
+
+			q0 += q1; q1 += q2; q2 += q3; q3 += q4; q4 += q5;
+			qd0 += qd1; qd1 += qd2; qd2 += qd3; qd3 += qd4;
+			qdd0 += qdd1; qdd1 += qdd2; qdd2 += qdd3;
+		}
+	}
+#endif
+}
+
+}
+
+#endif
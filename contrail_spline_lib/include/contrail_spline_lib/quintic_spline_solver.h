@@ -5,6 +5,8 @@
 
 #include <eigen3/Eigen/Dense>
 
+#include <cstddef>
+
 namespace contrail_spline_lib {
 
 class QuinticSplineSolver {
@@ -16,10 +18,57 @@ class QuinticSplineSolver {
 										const double qdf,
 										const double qddf );
 
+		//Solves the (num_vias - 1) segments joining each pair of vias
+		//q, qd, and qdd must each hold num_vias values, and coeffs must
+		//have space for (num_vias - 1) segments
+		void solver_batch( const double* q,
+						   const double* qd,
+						   const double* qdd,
+						   const size_t num_vias,
+						   quintic_spline_coeffs_t* coeffs );
+
+		//As above, but with the knot time of each via (t, num_vias values)
+		//The derivatives are given per unit of t, and t may be NULL for unit spacing
+		void solver_batch( const double* q,
+						   const double* qd,
+						   const double* qdd,
+						   const double* t,
+						   const size_t num_vias,
+						   quintic_spline_coeffs_t* coeffs );
+
+		//Estimates the derivative at qc from its neighbours (qp at tp; qn at tn)
+		double linear_derivative_est( const double qp,
+									  const double qc,
+									  const double qn,
+									  const double tp,
+									  const double tn );
+
+		//Estimates the derivative at every via (zero at each end) into dvias
+		//vias, t, and dvias must each hold num_vias values
+		void linear_derivative_est( const double* vias,
+									const double* t,
+									const size_t num_vias,
+									double* dvias );
+
 		Eigen::VectorXd linear_derivative_est( const Eigen::VectorXd& vias,
 											   const double dt );
 
-		quintic_spline_point_t lookup(const double u, const quintic_spline_coeffs_t& c);
+		//As above, but with the knot time of each via
+		Eigen::VectorXd linear_derivative_est( const Eigen::VectorXd& vias,
+											   const Eigen::VectorXd& t );
+
+		//Solves the derivatives at the interior vias that give a minimum-jerk
+		//spline (continuous jerk and snap), with the knot time of each via in t
+		//The end derivatives (qd/qdd at 0 and num_vias-1) must be set by the
+		//caller, and work must have space for 6*num_vias values
+		void min_jerk_derivatives( const double* q,
+								   const double* t,
+								   const size_t num_vias,
+								   double* qd,
+								   double* qdd,
+								   double* work );
+
+		quintic_spline_point_t lookup(const double u, const quintic_spline_coeffs_t& c) const;
 };
 
 }
@@ -2,26 +2,103 @@
 #define CONTRAIL_SPLINE_LIB_QUINTIC_SPLINE_TYPES_H
 
 #include <vector>
+#include <cstddef>
 
 namespace contrail_spline_lib {
 
+// The spline types are templated on the scalar type, which is double
+// unless noted otherwise (the _f_t aliases hold float32 values, which
+// halves the memory traffic of storing and evaluating the coefficients)
+template<typename Scalar>
+struct basic_quintic_spline_coeffs_t {
+	Scalar a1;
+	Scalar a2;
+	Scalar a3;
+	Scalar a4;
+	Scalar a5;
+	Scalar a6;
+};
+
+template<typename Scalar>
+struct basic_quintic_spline_point_t {
+	Scalar q;
+	Scalar qd;
+	Scalar qdd;
+};
+
+typedef basic_quintic_spline_coeffs_t<double> quintic_spline_coeffs_t;
+typedef basic_quintic_spline_coeffs_t<float> quintic_spline_coeffs_f_t;
+typedef basic_quintic_spline_point_t<double> quintic_spline_point_t;
+typedef basic_quintic_spline_point_t<float> quintic_spline_point_f_t;
+
+// Method used to find the derivatives at each via when interpolating
+//	LINEAR_EST: local estimate from the neighbouring vias, stopping at
+//				turning points (see linear_derivative_est())
+//	MIN_JERK: minimum-jerk spline with continuous jerk and snap, solved
+//			  over all vias (see min_jerk_derivatives())
+typedef enum {
+	INTERPOLATION_LINEAR_EST = 0,
+	INTERPOLATION_MIN_JERK
+} interpolation_mode_t;
+
+// Packed multi-channel trajectory types
+//
+// Channels are packed in the order x, y, z, yaw, so that one 4-wide vector
+// holds the same coefficient (or output) for every channel. A segment is
+// stored coefficient-major (a[k][channel]), giving one row per coefficient
+// (32 bytes for double, 16 bytes for float), and exactly 3 cache lines
+// per double segment (96 bytes for a float segment).
+const unsigned int packed_channels = 4;
+
+typedef enum {
+	CHANNEL_X = 0,
+	CHANNEL_Y,
+	CHANNEL_Z,
+	CHANNEL_YAW
+} packed_channel_t;
+
+template<typename Scalar>
+struct alignas(8*sizeof(Scalar)) basic_packed_quintic_segment_t {
+	Scalar a[6][packed_channels];
+};
+
+template<typename Scalar>
+struct basic_packed_quintic_point_t {
+	Scalar q[packed_channels];
+	Scalar qd[packed_channels];
+	Scalar qdd[packed_channels];
+};
+
+typedef basic_packed_quintic_segment_t<double> packed_quintic_segment_t;
+typedef basic_packed_quintic_segment_t<float> packed_quintic_segment_f_t;
+typedef basic_packed_quintic_point_t<double> packed_quintic_point_t;
+
+static_assert( sizeof(packed_quintic_segment_t) == 192, "packed_quintic_segment_t must be 3 cache lines" );
+static_assert( sizeof(packed_quintic_segment_f_t) == 96, "packed_quintic_segment_f_t must be 96 bytes" );
+
+// Peak kinematic values of a trajectory (per second units)
+//	velocity, acceleration: peak magnitude of the (x, y, z) vector
+//	yaw_rate: peak magnitude of the yaw rate
 typedef struct {
-	double a1;
-	double a2;
-	double a3;
-	double a4;
-	double a5;
-	double a6;
-} quintic_spline_coeffs_t;
+	double velocity;
+	double acceleration;
+	double yaw_rate;
+} kinematic_peaks_t;
 
+// Closest point on a trajectory path (see ClosestPointTree)
 typedef struct {
-	double q;
-	double qd;
-	double qdd;
-} quintic_spline_point_t;
+	size_t segment;
+	double u;			//Normalised time within the segment
+	double t;			//Trajectory time (seconds)
+	double distance;
+} closest_point_t;
 
+// A spline made of multiple segments, each with its own duration
+// knots holds the start time of each segment, followed by the end time
+// of the last segment (seg_coeffs.size() + 1 values, strictly increasing)
 typedef struct {
 	std::vector<quintic_spline_coeffs_t> seg_coeffs;
+	std::vector<double> knots;
 	double duration;
 } multi_segment_quintic_spline_t;
 
@@ -0,0 +1,78 @@
+#ifndef CONTRAIL_SPLINE_LIB_STREAMING_QUINTIC_SPLINE_H
+#define CONTRAIL_SPLINE_LIB_STREAMING_QUINTIC_SPLINE_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/quintic_spline_solver.h>
+
+#include <vector>
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Quintic spline over a sliding window of vias (receding horizon)
+//
+// The vias are held in a fixed-capacity ring buffer, and are appended at
+// the tail and retired from the head as they are passed. The derivative
+// estimates only depend on the neighbouring vias, so appending a via only
+// re-solves the last 3 segments, and retiring a via does not change the
+// rest of the spline (the new head keeps its derivatives).
+//
+// The spline is indexed with the (absolute) knot times given to append(),
+// and the derivatives are returned per unit of that time. The tail via
+// always has zero derivatives, so the spline comes to rest at the end of
+// the window until another via is appended.
+class StreamingQuinticSpline {
+	private:
+		std::vector<double> _q;
+		std::vector<double> _qd;
+		std::vector<double> _qdd;
+		std::vector<double> _t;
+		std::vector<quintic_spline_coeffs_t> _coeffs;	//Segment starting at the via in the same slot
+
+		size_t _capacity;
+		size_t _head;
+		size_t _size;
+
+		QuinticSplineSolver _solver;
+
+		inline size_t _slot( const size_t i ) const { return (_head + i) % _capacity; };
+
+		void _estimate_qd( const size_t i );
+		void _estimate_qdd( const size_t i );
+		void _solve( const size_t i );
+
+		size_t _locate( const double t ) const;
+
+	public:
+		//capacity is the maximum number of vias held at once (at least 2)
+		StreamingQuinticSpline( const size_t capacity );
+		~StreamingQuinticSpline( void );
+
+		//Appends a via at the tail, reached at time "t"
+		//Returns false if the window is full, or t is not after the tail
+		bool append( const double q, const double t );
+
+		//Retires the via at the head (along with its segment)
+		//Returns false if there is no segment left to retire
+		bool retire( void );
+		//Retires every segment that has finished before time "t"
+		//Returns the number of vias that were retired
+		size_t retire_before( const double t );
+
+		void clear( void );
+
+		quintic_spline_point_t lookup( const double t ) const;
+
+		inline size_t get_capacity( void ) const { return _capacity; };
+		inline size_t get_num_vias( void ) const { return _size; };
+		inline size_t get_num_segments( void ) const { return (_size > 0) ? _size - 1 : 0; };
+		inline double get_start_time( void ) const { return (_size > 0) ? _t[_slot(0)] : 0.0; };
+		inline double get_end_time( void ) const { return (_size > 0) ? _t[_slot(_size - 1)] : 0.0; };
+
+		inline bool is_full( void ) const { return _size == _capacity; };
+		inline bool is_valid( void ) const { return _size >= 2; };
+};
+
+}
+
+#endif
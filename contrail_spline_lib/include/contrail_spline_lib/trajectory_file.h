@@ -0,0 +1,61 @@
+#ifndef CONTRAIL_SPLINE_LIB_TRAJECTORY_FILE_H
+#define CONTRAIL_SPLINE_LIB_TRAJECTORY_FILE_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+
+#include <stdint.h>
+
+namespace contrail_spline_lib {
+
+// Binary trajectory file format
+//
+// A file holds a solved PackedQuinticTrajectory, laid out so that it can
+// be memory-mapped and evaluated in place (see PackedQuinticTrajectory::load()):
+//	header:		trajectory_file_header_t (64 bytes, at offset 0)
+//	knots:		num_segments + 1 doubles (seconds), at knots_offset
+//	segments:	num_segments packed segments, at segments_offset
+//				(64-byte aligned, same layout as in memory, either
+//				packed_quintic_segment_t or packed_quintic_segment_f_t)
+//	origins:	(rebased only) num_segments*packed_channels doubles, at the
+//				next 64-byte boundary after the segments
+//
+// All values are in the byte order of the host that wrote the file, which
+// is checked with byte_order_mark when loading. Readers must reject files
+// with an unknown magic, version or flags, or a mismatched channel count,
+// precision or segment size.
+//
+// Version history:
+//	1: double precision segments only
+//	2: added single precision and rebased segments (see flags)
+const char trajectory_file_magic[8] = {'C', 'T', 'R', 'L', 'T', 'R', 'A', 'J'};
+const uint32_t trajectory_file_version = 2;
+const uint32_t trajectory_file_min_version = 1;	//Oldest version that can still be read
+const uint32_t trajectory_file_byte_order_mark = 0x01020304;
+
+//Flags
+const uint32_t TRAJECTORY_FILE_UNIFORM_KNOTS = 0x01;
+const uint32_t TRAJECTORY_FILE_SINGLE_PRECISION = 0x02;	//Segments are packed_quintic_segment_f_t
+const uint32_t TRAJECTORY_FILE_REBASED = 0x04;			//Segments are relative to the origins
+const uint32_t TRAJECTORY_FILE_KNOWN_FLAGS = TRAJECTORY_FILE_UNIFORM_KNOTS |
+											 TRAJECTORY_FILE_SINGLE_PRECISION |
+											 TRAJECTORY_FILE_REBASED;
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t channels;			//packed_channels
+	uint32_t segment_size;		//sizeof(packed_quintic_segment_t) or sizeof(packed_quintic_segment_f_t)
+	uint64_t num_segments;
+	uint64_t knots_offset;
+	uint64_t segments_offset;
+	double duration;
+	uint32_t flags;
+	uint32_t byte_order_mark;
+} trajectory_file_header_t;
+
+static_assert( sizeof(trajectory_file_header_t) == 64, "trajectory_file_header_t must be 64 bytes" );
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef CONTRAIL_SPLINE_LIB_TRAJECTORY_GEOFENCE_H
+#define CONTRAIL_SPLINE_LIB_TRAJECTORY_GEOFENCE_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <vector>
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Analytic geofence checks for the path (x, y, z) of a packed trajectory
+//
+// Each segment is checked in three stages, each only for the constraints
+// the previous stage couldn't clear:
+//	1. Broad phase: a box around the Bernstein control points of the
+//	   segment (which hold the whole segment, and cost no root finding)
+//	2. The exact bounding box of the segment (see segment_bounds())
+//	3. Exact crossing times, from the roots of the segment polynomials
+//	   against each boundary (see polynomial_roots())
+// so nothing is sampled, and a violation is never missed between samples.
+//
+// The boundaries themselves are allowed, so a path may touch the edge of
+// the arena, or the face of a keep-out box, without a violation.
+
+typedef struct {
+	double lo[3];
+	double hi[3];
+} aabb_t;
+
+typedef struct {
+	double normal[3];
+	double offset;		//Inside where normal.x <= offset
+} half_space_t;
+
+typedef struct {
+	bool has_arena;
+	aabb_t arena;						//The path must stay inside (if has_arena)
+	std::vector<half_space_t> half_spaces;	//The path must stay inside all of these
+	std::vector<aabb_t> keep_out;		//The path must stay out of all of these
+} geofence_t;
+
+typedef enum {
+	GEOFENCE_CLEAR = 0,
+	GEOFENCE_ARENA,
+	GEOFENCE_HALF_SPACE,
+	GEOFENCE_KEEP_OUT
+} geofence_violation_t;
+
+typedef struct {
+	geofence_violation_t violation;
+	size_t constraint;	//Index of the half space or keep-out box that was violated
+	size_t segment;
+	double t;			//Trajectory time (seconds) of the violation
+} geofence_result_t;
+
+//Exact bounding box of the path of segment i (see polynomial_range())
+template<typename Scalar>
+aabb_t segment_bounds( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const size_t i );
+
+//Returns the earliest violation of the geofence along the trajectory
+//(GEOFENCE_CLEAR if the trajectory is invalid, or stays within it)
+//(instantiated for both PackedQuinticTrajectory and PackedQuinticTrajectoryF)
+template<typename Scalar>
+geofence_result_t trajectory_geofence_check( const BasicPackedQuinticTrajectory<Scalar>& trajectory,
+											 const geofence_t& geofence );
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef CONTRAIL_SPLINE_LIB_TRAJECTORY_LIMITS_H
+#define CONTRAIL_SPLINE_LIB_TRAJECTORY_LIMITS_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+namespace contrail_spline_lib {
+
+// Analytic kinematic limit checks for a packed trajectory
+//
+// The peaks of each segment are found exactly, by checking the segment
+// ends and every turning point inside it:
+//	|v|^2 = v.v turns where v.a = 0 (degree 7)
+//	|a|^2 = a.a turns where a.j = 0 (degree 5)
+//	|yaw_rate| turns where the yaw acceleration = 0 (degree 3)
+// The turning points are found with polynomial_roots().
+//
+// Finding the roots is most of the cost, so the whole trajectory is first
+// bounded cheaply: the values at the knots are exact lower bounds, and the
+// Bernstein coefficients of each segment's derivatives give upper bounds.
+// The roots are then only found for the few segments whose upper bound is
+// over the peak found so far, which can't change the result.
+
+//Returns the peak values over every segment of the trajectory
+//(instantiated for both PackedQuinticTrajectory and PackedQuinticTrajectoryF)
+template<typename Scalar>
+kinematic_peaks_t trajectory_peaks( const BasicPackedQuinticTrajectory<Scalar>& trajectory );
+
+//Returns the peak values of segment i alone (the turning points are
+//always found, so this is the exact check trajectory_peaks() refines with)
+template<typename Scalar>
+kinematic_peaks_t trajectory_segment_peaks( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const size_t i );
+
+//Returns the factor that the trajectory duration must be stretched by to
+//bring the peaks within the limits (1.0 if already within the limits)
+//Stretching by k divides the velocity and yaw rate by k, and the
+//acceleration by k^2. Limits that are not positive are ignored.
+double trajectory_limit_scale( const kinematic_peaks_t& peaks,
+							   const kinematic_peaks_t& limits );
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef CONTRAIL_SPLINE_LIB_TRAJECTORY_SAMPLING_H
+#define CONTRAIL_SPLINE_LIB_TRAJECTORY_SAMPLING_H
+
+#include <contrail_spline_lib/quintic_spline_types.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <vector>
+#include <cstddef>
+
+namespace contrail_spline_lib {
+
+// Adaptive sampling of a packed trajectory, for drawing it as a polyline
+//
+// Samples are placed where they are needed, rather than at a fixed rate:
+//	1. Each segment is halved until the path stays close to the straight
+//	   line between its samples (checked at the quarter points), and the
+//	   heading and yaw turn by no more than the allowed angle
+//	2. Runs of samples that all lie close to a single straight line (e.g.
+//	   along a straight stretch spanning many segments) are merged
+// Each stage is allowed half the tolerance, so the polyline stays within
+// the tolerance of the path at every sample checked. Straight stretches
+// need only a few samples, while tight turns get as many as they need.
+
+typedef struct {
+	double tolerance;	//Furthest the path may stray from the polyline
+	double max_angle;	//Largest turn of the heading (or yaw) between samples (radians)
+	double min_dt;		//Shortest time between samples (seconds, 0 for no limit)
+} sampling_tolerance_t;
+
+//Fills "times" and "points" with the samples (always including both ends)
+//The storage is reused between calls, so it only grows as needed
+template<typename Scalar>
+void adaptive_sample( const BasicPackedQuinticTrajectory<Scalar>& trajectory,
+					  const sampling_tolerance_t& tolerance,
+					  std::vector<double>& times,
+					  std::vector<packed_quintic_point_t>& points );
+
+}
+
+#endif
@@ -1,2 +1,3 @@
 from contrail_spline_lib._quintic_spline_wrapper_py import QuinticSplineSolver
 from contrail_spline_lib._quintic_spline_wrapper_py import InterpolatedQuinticSpline
+from contrail_spline_lib._quintic_spline_wrapper_py import PackedQuinticTrajectory
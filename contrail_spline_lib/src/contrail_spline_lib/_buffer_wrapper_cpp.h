@@ -0,0 +1,78 @@
+#ifndef CONTRAIL_SPLINE_LIB_BUFFER_WRAPPER_CPP_H
+#define CONTRAIL_SPLINE_LIB_BUFFER_WRAPPER_CPP_H
+
+#include <boost/python.hpp>
+
+#include <cstddef>
+
+// Zero-copy access to float64 data in Python objects that support the
+// buffer protocol (such as numpy arrays)
+//
+// The buffer is held until this object goes out of scope, so the data
+// pointer must not be kept beyond that. Objects that are not float64
+// buffers raise a TypeError, and strided (non C-contiguous) buffers raise
+// a ValueError (numpy.ascontiguousarray() with dtype=numpy.float64 will
+// convert without copying when possible).
+class PythonDoubleBuffer {
+	private:
+		Py_buffer _view;
+
+		//Not copyable (the buffer is released on destruction)
+		PythonDoubleBuffer( const PythonDoubleBuffer& );
+		PythonDoubleBuffer& operator=( const PythonDoubleBuffer& );
+
+	public:
+		PythonDoubleBuffer( const boost::python::object& obj, const bool writable = false ) {
+			//Strided buffers are accepted here, so they can be told apart below
+			const int flags = PyBUF_STRIDES | PyBUF_FORMAT | ( writable ? PyBUF_WRITABLE : 0 );
+
+			if( PyObject_GetBuffer(obj.ptr(), &_view, flags) != 0 )
+				boost::python::throw_error_already_set();
+
+			//Native-endian doubles only ("d", "=d", "<d" or "@d" on little-endian hosts)
+			const char* f = _view.format;
+			const bool native = ( f != NULL ) && ( ( f[0] == 'd' ) ||
+								( ( ( f[0] == '=' ) || ( f[0] == '@' ) || ( f[0] == '<' ) ) && ( f[1] == 'd' ) ) );
+
+			if( !native || ( _view.itemsize != sizeof(double) ) ) {
+				PyBuffer_Release(&_view);
+				PyErr_SetString(PyExc_TypeError, "expected a contiguous float64 array");
+				boost::python::throw_error_already_set();
+			}
+
+			if( !PyBuffer_IsContiguous(&_view, 'C') ) {
+				PyBuffer_Release(&_view);
+				PyErr_SetString(PyExc_ValueError, "expected a contiguous float64 array");
+				boost::python::throw_error_already_set();
+			}
+		}
+
+		~PythonDoubleBuffer( void ) {
+			PyBuffer_Release(&_view);
+		}
+
+		inline double* data( void ) const { return static_cast<double*>(_view.buf); };
+		inline size_t size( void ) const { return _view.len / sizeof(double); };
+		inline int ndim( void ) const { return _view.ndim; };
+		inline size_t shape( const int i ) const { return ( i < _view.ndim ) ? _view.shape[i] : 1; };
+};
+
+//Raises a Python ValueError if the condition is not met
+inline void python_value_check( const bool condition, const char* msg ) {
+	if( !condition ) {
+		PyErr_SetString(PyExc_ValueError, msg);
+		boost::python::throw_error_already_set();
+	}
+}
+
+//Creates an uninitialised numpy float64 array of shape (rows, cols), or (rows,) if cols is 0
+inline boost::python::object make_numpy_array( const size_t rows, const size_t cols = 0 ) {
+	boost::python::object numpy = boost::python::import("numpy");
+
+	if( cols == 0 )
+		return numpy.attr("empty")( rows, "float64" );
+
+	return numpy.attr("empty")( boost::python::make_tuple(rows, cols), "float64" );
+}
+
+#endif
@@ -3,8 +3,12 @@
 #include <contrail_spline_lib/interpolated_quintic_spline.h>
 #include <contrail_spline_lib/quintic_spline_types.h>
 
+#include "_buffer_wrapper_cpp.h"
+
 #include <eigen3/Eigen/Dense>
 
+#include <vector>
+
 class InterpolatedQuinticSplineWrapper : public contrail_spline_lib::InterpolatedQuinticSpline {
 	public:
 		InterpolatedQuinticSplineWrapper() : InterpolatedQuinticSpline() {}
@@ -18,6 +22,20 @@ class InterpolatedQuinticSplineWrapper : public contrail_spline_lib::Interpolate
 			return interpolate(vias);
 		}
 
+		//Interpolates directly from a float64 array (and optional knots), without copying
+		bool _interpolate_array( const boost::python::object& vias, const boost::python::object& knots ) {
+			PythonDoubleBuffer v(vias);
+			python_value_check( v.ndim() == 1, "vias must be a 1D array" );
+
+			if( knots.is_none() )
+				return interpolate( v.data(), v.size() );
+
+			PythonDoubleBuffer k(knots);
+			python_value_check( ( k.ndim() == 1 ) && ( k.size() == v.size() ), "knots must be a 1D array the same length as vias" );
+
+			return interpolate( v.data(), v.size(), k.data() );
+		}
+
 		boost::python::list _get_vias( void ) {
 			return _get_list_from_vec( get_vias() );
 		}
@@ -41,8 +59,43 @@ class InterpolatedQuinticSplineWrapper : public contrail_spline_lib::Interpolate
 			return list;
 		}
 
+		boost::python::list _lookup_uniform( double u0, double du, size_t n ) {
+			boost::python::list list;
+
+			std::vector<contrail_spline_lib::quintic_spline_point_t> points(n);
+			lookup_uniform(u0, du, n, points.data());
+
+			for (size_t i = 0; i < n; ++i) {
+				boost::python::list p;
+				p.append<double>( points[i].q );
+				p.append<double>( points[i].qd );
+				p.append<double>( points[i].qdd );
+				list.append(p);
+			}
+
+			return list;
+		}
+
+		//Looks up every u in a float64 array, returning an (N,3) array of [q, qd, qdd]
+		//The points are written straight into the returned array's storage
+		boost::python::object _lookup_many( const boost::python::object& u ) {
+			static_assert( sizeof(contrail_spline_lib::quintic_spline_point_t) == 3*sizeof(double),
+						   "quintic_spline_point_t must match a row of an (N,3) float64 array" );
+
+			PythonDoubleBuffer ub(u);
+			python_value_check( ub.ndim() == 1, "u must be a 1D array" );
+			const size_t n = ub.size();
+
+			boost::python::object out = make_numpy_array(n, 3);
+			PythonDoubleBuffer ob(out, true);
+
+			lookup_batch( ub.data(), n, reinterpret_cast<contrail_spline_lib::quintic_spline_point_t*>( ob.data() ) );
+
+			return out;
+		}
+
 	private:
-		boost::python::list _get_list_from_vec(const Eigen::VectorXd& vec) {
+		boost::python::list _get_list_from_vec(const Eigen::Ref<const Eigen::VectorXd>& vec) {
 			boost::python::list list;
 
 			for (size_t i = 0; i < vec.size(); ++i)
@@ -57,9 +110,14 @@ BOOST_PYTHON_MODULE(_interpolated_quintic_spline_wrapper_cpp) {
 	boost::python::class_<InterpolatedQuinticSplineWrapper>
 		( "InterpolatedQuinticSplineWrapper", boost::python::init<>() )
 		.def("interpolate", &InterpolatedQuinticSplineWrapper::_interpolate)
+		.def("interpolate_array", &InterpolatedQuinticSplineWrapper::_interpolate_array,
+			 ( boost::python::arg("vias"), boost::python::arg("knots") = boost::python::object() ) )
+		.def("set_start_derivatives", &InterpolatedQuinticSplineWrapper::set_start_derivatives)
 		.def("get_vias", &InterpolatedQuinticSplineWrapper::_get_vias)
 		.def("get_dvias", &InterpolatedQuinticSplineWrapper::_get_dvias)
 		.def("get_ddvias", &InterpolatedQuinticSplineWrapper::_get_ddvias)
 		.def("lookup", &InterpolatedQuinticSplineWrapper::_lookup)
+		.def("lookup_uniform", &InterpolatedQuinticSplineWrapper::_lookup_uniform)
+		.def("lookup_many", &InterpolatedQuinticSplineWrapper::_lookup_many)
 		;
 }
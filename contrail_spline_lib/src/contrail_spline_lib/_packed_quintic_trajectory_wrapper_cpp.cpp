@@ -0,0 +1,142 @@
+#include <boost/python.hpp>
+
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/interpolated_quintic_spline.h>
+#include <contrail_spline_lib/quintic_spline_types.h>
+
+#include "_buffer_wrapper_cpp.h"
+
+#include <string>
+
+template<typename Scalar>
+class BasicPackedQuinticTrajectoryWrapper : public contrail_spline_lib::BasicPackedQuinticTrajectory<Scalar> {
+	private:
+		typedef contrail_spline_lib::BasicPackedQuinticTrajectory<Scalar> Base;
+
+		//Per-axis splines, only used to build the packed trajectory
+		contrail_spline_lib::InterpolatedQuinticSpline _x;
+		contrail_spline_lib::InterpolatedQuinticSpline _y;
+		contrail_spline_lib::InterpolatedQuinticSpline _z;
+		contrail_spline_lib::InterpolatedQuinticSpline _yaw;
+
+	public:
+		BasicPackedQuinticTrajectoryWrapper() : Base() {}
+
+		//Interpolates and packs the 4 channels from float64 arrays (and optional
+		//knots, shared by every channel with a matching number of vias)
+		bool _pack( const boost::python::object& x,
+					const boost::python::object& y,
+					const boost::python::object& z,
+					const boost::python::object& yaw,
+					const double duration,
+					const boost::python::object& knots,
+					const int mode ) {
+			const boost::python::object* vias[contrail_spline_lib::packed_channels] = {&x, &y, &z, &yaw};
+			contrail_spline_lib::InterpolatedQuinticSpline* splines[contrail_spline_lib::packed_channels] = {&_x, &_y, &_z, &_yaw};
+
+			python_value_check( ( mode == contrail_spline_lib::INTERPOLATION_LINEAR_EST ) ||
+								( mode == contrail_spline_lib::INTERPOLATION_MIN_JERK ), "unknown interpolation mode" );
+
+			for(unsigned int c = 0; c < contrail_spline_lib::packed_channels; c++) {
+				PythonDoubleBuffer v(*vias[c]);
+				python_value_check( v.ndim() == 1, "vias must be 1D arrays" );
+
+				splines[c]->set_mode( (contrail_spline_lib::interpolation_mode_t)mode );
+
+				bool success = false;
+				if( knots.is_none() ) {
+					success = splines[c]->interpolate( v.data(), v.size() );
+				} else {
+					PythonDoubleBuffer k(knots);
+					python_value_check( k.ndim() == 1, "knots must be a 1D array" );
+
+					success = splines[c]->interpolate( v.data(), v.size(), ( k.size() == v.size() ) ? k.data() : NULL );
+				}
+
+				if( !success )
+					return false;
+			}
+
+			return Base::pack(_x, _y, _z, _yaw, duration);
+		}
+
+		boost::python::list _lookup( const double t ) {
+			boost::python::list q;
+			boost::python::list qd;
+			boost::python::list qdd;
+
+			contrail_spline_lib::packed_quintic_point_t p = Base::lookup(t);
+			for(unsigned int c = 0; c < contrail_spline_lib::packed_channels; c++) {
+				q.append<double>( p.q[c] );
+				qd.append<double>( p.qd[c] );
+				qdd.append<double>( p.qdd[c] );
+			}
+
+			boost::python::list list;
+			list.append(q);
+			list.append(qd);
+			list.append(qdd);
+
+			return list;
+		}
+
+		//Looks up every t in a float64 array, returning an (N,12) array
+		//of [x, y, z, yaw] for each of q, qd and qdd
+		boost::python::object _lookup_many( const boost::python::object& t ) {
+			static_assert( sizeof(contrail_spline_lib::packed_quintic_point_t) == 3*contrail_spline_lib::packed_channels*sizeof(double),
+						   "packed_quintic_point_t must match a row of an (N,12) float64 array" );
+
+			PythonDoubleBuffer tb(t);
+			python_value_check( tb.ndim() == 1, "t must be a 1D array" );
+			const size_t n = tb.size();
+
+			boost::python::object out = make_numpy_array(n, 3*contrail_spline_lib::packed_channels);
+			PythonDoubleBuffer ob(out, true);
+
+			contrail_spline_lib::packed_quintic_point_t* points = reinterpret_cast<contrail_spline_lib::packed_quintic_point_t*>( ob.data() );
+			for(size_t i = 0; i < n; i++)
+				points[i] = Base::lookup( tb.data()[i] );
+
+			return out;
+		}
+
+		boost::python::list _get_knots( void ) {
+			boost::python::list list;
+
+			if( Base::is_valid() ) {
+				for (size_t i = 0; i <= Base::get_num_segments(); ++i)
+					list.append<double>( Base::get_knots()[i] );
+			}
+
+			return list;
+		}
+};
+
+//Both precisions share the same Python interface
+template<typename Scalar>
+static void export_trajectory_wrapper( const char* name ) {
+	typedef BasicPackedQuinticTrajectoryWrapper<Scalar> W;
+
+	boost::python::class_<W, boost::noncopyable>
+		( name, boost::python::init<>() )
+		.def("pack", &W::_pack,
+			 ( boost::python::arg("x"), boost::python::arg("y"), boost::python::arg("z"), boost::python::arg("yaw"),
+			   boost::python::arg("duration"), boost::python::arg("knots") = boost::python::object(), boost::python::arg("mode") = 0 ) )
+		.def("set_rebasing", &W::set_rebasing)
+		.def("save", &W::save)
+		.def("load", &W::load)
+		.def("lookup", &W::_lookup)
+		.def("lookup_many", &W::_lookup_many)
+		.def("get_knots", &W::_get_knots)
+		.def("get_duration", &W::get_duration)
+		.def("get_num_segments", &W::get_num_segments)
+		.def("is_rebased", &W::is_rebased)
+		.def("is_mapped", &W::is_mapped)
+		.def("is_valid", &W::is_valid)
+		;
+}
+
+BOOST_PYTHON_MODULE(_packed_quintic_trajectory_wrapper_cpp) {
+	export_trajectory_wrapper<double>("PackedQuinticTrajectoryWrapper");
+	export_trajectory_wrapper<float>("PackedQuinticTrajectoryFWrapper");
+}
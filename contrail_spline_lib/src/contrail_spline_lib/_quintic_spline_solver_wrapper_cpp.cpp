@@ -3,6 +3,8 @@
 #include <contrail_spline_lib/quintic_spline_types.h>
 #include <contrail_spline_lib/quintic_spline_solver.h>
 
+#include "_buffer_wrapper_cpp.h"
+
 #include <vector>
 
 class QuinticSplineSolverWrapper : public contrail_spline_lib::QuinticSplineSolver {
@@ -45,6 +47,27 @@ class QuinticSplineSolverWrapper : public contrail_spline_lib::QuinticSplineSolv
 			return list;
 		}
 
+		//As above, but from a float64 array (without copying), returning an array
+		boost::python::object _linear_derivative_est_array( const boost::python::object& vias_array,
+															const double dt ) {
+			PythonDoubleBuffer vb(vias_array);
+			python_value_check( vb.ndim() == 1, "vias must be a 1D array" );
+
+			const size_t n = vb.size();
+			const double* vias = vb.data();
+
+			boost::python::object out = make_numpy_array(n);
+			PythonDoubleBuffer ob(out, true);
+			double* dvias = ob.data();
+
+			for(size_t i = 0; i < n; i++) {
+				dvias[i] = ( (i > 0) && ( (i + 1) < n ) ) ?
+						   linear_derivative_est( vias[i-1], vias[i], vias[i+1], 0.0, 2*dt ) : 0.0;
+			}
+
+			return out;
+		}
+
 		boost::python::list _lookup(const double u, const boost::python::list& coeffs) {
 			boost::python::list list;
 
@@ -72,6 +95,7 @@ BOOST_PYTHON_MODULE(_quintic_spline_solver_wrapper_cpp) {
 		( "QuinticSplineSolverWrapper", boost::python::init<>() )
 		.def("solver", &QuinticSplineSolverWrapper::_solver)
 		.def("linear_derivative_est", &QuinticSplineSolverWrapper::_linear_derivative_est)
+		.def("linear_derivative_est_array", &QuinticSplineSolverWrapper::_linear_derivative_est_array)
 		.def("lookup", &QuinticSplineSolverWrapper::_lookup)
 		;
 }
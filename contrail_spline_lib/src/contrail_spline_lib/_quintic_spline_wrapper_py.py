@@ -1,7 +1,11 @@
 #!/usr/bin/env python2
 
+import numpy
+
 from contrail_spline_lib._quintic_spline_solver_wrapper_cpp import QuinticSplineSolverWrapper
 from contrail_spline_lib._interpolated_quintic_spline_wrapper_cpp import InterpolatedQuinticSplineWrapper
+from contrail_spline_lib._packed_quintic_trajectory_wrapper_cpp import PackedQuinticTrajectoryWrapper
+from contrail_spline_lib._packed_quintic_trajectory_wrapper_cpp import PackedQuinticTrajectoryFWrapper
 
 
 class QuinticSplineSolver(object):
@@ -11,8 +15,13 @@ class QuinticSplineSolver(object):
 	def solver(self, q0, qd0, qdd0, qf, qdf, qddf):
 		return self._qss.solver(q0, qd0, qdd0, qf, qdf, qddf)
 
+	# Lists are returned as lists, anything else (e.g. numpy arrays) is
+	# returned as a numpy array, without copying if already float64
 	def linear_derivative_est(self, vias, dt):
-		return self._qss.linear_derivative_est(vias,dt)
+		if isinstance(vias, list):
+			return self._qss.linear_derivative_est(vias,dt)
+
+		return self._qss.linear_derivative_est_array(numpy.ascontiguousarray(vias, dtype=numpy.float64), dt)
 
 	def lookup(self, u, c):
 		point = []
@@ -26,8 +35,20 @@ class InterpolatedQuinticSpline(object):
 	def __init__(self):
 		self._iqs = InterpolatedQuinticSplineWrapper()
 
-	def interpolate(self, vias):
-		return self._iqs.interpolate(vias)
+	# Vias (and knots) may be lists or numpy arrays, float64 arrays are used without copying
+	def interpolate(self, vias, knots=None):
+		if isinstance(vias, list) and (knots is None):
+			return self._iqs.interpolate(vias)
+
+		vias = numpy.ascontiguousarray(vias, dtype=numpy.float64)
+		if knots is not None:
+			knots = numpy.ascontiguousarray(knots, dtype=numpy.float64)
+
+		return self._iqs.interpolate_array(vias, knots)
+
+	# Derivatives at the first via (with respect to u), used by the next interpolate()
+	def set_start_derivatives(self, dvia, ddvia):
+		self._iqs.set_start_derivatives(dvia, ddvia)
 
 	def get_vias(self):
 		return self._iqs.get_vias()
@@ -40,3 +61,69 @@ class InterpolatedQuinticSpline(object):
 
 	def lookup(self, u):
 		return self._iqs.lookup(u)
+
+	def lookup_uniform(self, u0, du, n):
+		return self._iqs.lookup_uniform(u0, du, n)
+
+	# Looks up an array of u values, returning an (N,3) numpy array of [q, qd, qdd]
+	def lookup_many(self, u):
+		return self._iqs.lookup_many(numpy.ascontiguousarray(u, dtype=numpy.float64))
+
+class PackedQuinticTrajectory(object):
+	INTERPOLATION_LINEAR = 0
+	INTERPOLATION_MIN_JERK = 1
+
+	# Coefficients are stored as float if single_precision is set, and
+	# relative to the start of each segment if rebase is set (this is
+	# used by the next pack(), see packed_quintic_trajectory.h)
+	def __init__(self, single_precision=False, rebase=False):
+		if single_precision:
+			self._pqt = PackedQuinticTrajectoryFWrapper()
+		else:
+			self._pqt = PackedQuinticTrajectoryWrapper()
+
+		self._pqt.set_rebasing(rebase)
+
+	# Interpolates the x, y, z and yaw vias (lists or numpy arrays) to be
+	# flown over "duration" seconds, optionally at the given relative knots
+	def pack(self, x, y, z, yaw, duration, knots=None, mode=INTERPOLATION_LINEAR):
+		x, y, z, yaw = [numpy.ascontiguousarray(v, dtype=numpy.float64) for v in (x, y, z, yaw)]
+		if knots is not None:
+			knots = numpy.ascontiguousarray(knots, dtype=numpy.float64)
+
+		return self._pqt.pack(x, y, z, yaw, duration, knots, mode)
+
+	# Writes the trajectory to a binary trajectory file
+	def save(self, filename):
+		return self._pqt.save(filename)
+
+	# Maps a binary trajectory file in place of the packed trajectory
+	def load(self, filename):
+		return self._pqt.load(filename)
+
+	# Returns [q, qd, qdd], each as [x, y, z, yaw]
+	def lookup(self, t):
+		return self._pqt.lookup(t)
+
+	# Looks up an array of times, returning an (N,3,4) numpy array of
+	# [q, qd, qdd], each as [x, y, z, yaw]
+	def lookup_many(self, t):
+		return self._pqt.lookup_many(numpy.ascontiguousarray(t, dtype=numpy.float64)).reshape(-1, 3, 4)
+
+	def get_knots(self):
+		return self._pqt.get_knots()
+
+	def get_duration(self):
+		return self._pqt.get_duration()
+
+	def get_num_segments(self):
+		return self._pqt.get_num_segments()
+
+	def is_rebased(self):
+		return self._pqt.is_rebased()
+
+	def is_mapped(self):
+		return self._pqt.is_mapped()
+
+	def is_valid(self):
+		return self._pqt.is_valid()
@@ -0,0 +1,262 @@
+#include <contrail_spline_lib/arc_length_table.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace contrail_spline_lib;
+
+template<class T>
+constexpr static const T& clamp(const T& i, const T& min, const T& max) {
+	return (i < min) ? min : ( (i > max) ? max : i );
+}
+
+//5-point Gauss-Legendre rule over [-1, 1]
+static const size_t gauss_legendre_points = 5;
+static const double gauss_legendre_x[gauss_legendre_points] = { -0.9061798459386640, -0.5384693101056831, 0.0,
+																  0.5384693101056831, 0.9061798459386640 };
+static const double gauss_legendre_w[gauss_legendre_points] = { 0.2369268850561891, 0.4786286704993665, 0.5688888888888889,
+																  0.4786286704993665, 0.2369268850561891 };
+
+//Squared speed along the path (x, y, z) of a segment at normalised time u
+template<typename Scalar>
+static double _segment_speed2( const basic_packed_quintic_segment_t<Scalar>& seg, const double u ) {
+	double n = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		const double v = seg.a[1][c] + u*( 2.0*seg.a[2][c] + u*( 3.0*seg.a[3][c] + u*( 4.0*seg.a[4][c] + u*5.0*seg.a[5][c] ) ) );
+		n += v*v;
+	}
+
+	return n;
+}
+
+ArcLengthTable::ArcLengthTable( void ) :
+	_length(0.0),
+	_min_speed(0.0),
+	_ds(0.0),
+	_inv_ds(0.0),
+	_resolution(16),
+	_capacity(0),
+	_is_valid(false) {
+}
+
+ArcLengthTable::ArcLengthTable( const size_t capacity, const size_t resolution ) :
+	_length(0.0),
+	_min_speed(0.0),
+	_ds(0.0),
+	_inv_ds(0.0),
+	_resolution( std::max(resolution, (size_t)1) ),
+	_capacity(capacity),
+	_is_valid(false) {
+
+	const size_t n = _capacity*_resolution + 1;
+	_t.reserve(n);
+	_dtds.reserve(n);
+	_fwd_s.reserve(n);
+}
+
+ArcLengthTable::~ArcLengthTable( void ) {
+}
+
+template<typename Scalar>
+bool ArcLengthTable::build( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const double min_speed_ratio ) {
+	_is_valid = false;
+	_min_speed = 0.0;
+
+	if( !trajectory.is_valid() )
+		return is_valid();
+
+	const size_t num_seg = trajectory.get_num_segments();
+	if( ( _capacity > 0 ) && ( num_seg > _capacity ) )
+		return is_valid();
+
+	const double* knots = trajectory.get_knots();
+	const size_t n = num_seg*_resolution + 1;
+	const double du = 1.0 / _resolution;
+
+	_fwd_s.resize(n);
+	_t.resize(n);
+	_dtds.resize(n);
+
+	double s = _integrate(trajectory);
+
+	if( !( s > 0.0 ) )
+		return is_valid();
+
+	//Measured again with the floor, which depends on the plain length
+	if( min_speed_ratio > 0.0 ) {
+		_min_speed = min_speed_ratio * s / trajectory.get_duration();
+		s = _integrate(trajectory);
+	}
+
+	_length = s;
+	_ds = _length / (n - 1);
+	_inv_ds = 1.0 / _ds;
+
+	//Invert onto evenly spaced stations, stepping through the forward table
+	size_t f = 0;
+	for(size_t j = 0; j < n; j++) {
+		const double sj = std::min(j*_ds, _length);
+
+		while( ( (f + 2) < n ) && ( _fwd_s[f + 1] < sj ) )
+			f++;
+
+		const size_t i = std::min(f / _resolution, num_seg - 1);
+		const basic_packed_quintic_segment_t<Scalar>& seg = trajectory.get_segment(i);
+		const double h = knots[i+1] - knots[i];
+
+		const double u0 = (f - i*_resolution)*du;
+		const double u = _segment_invert( seg, h, u0, u0 + du, sj - _fwd_s[f] );
+		const double rate = _segment_rate(seg, h, u);
+
+		_t[j] = knots[i] + u*h;
+		//Exact slope (unbounded where the path stops without a floor, see the limits below)
+		_dtds[j] = ( rate > 0.0 ) ? h / rate : HUGE_VAL;
+	}
+
+	_t[0] = knots[0];
+	_t[n - 1] = knots[num_seg];
+
+	//Limit the slopes to 3x the neighbouring secants, which keeps each
+	//Hermite piece monotonic (Fritsch-Carlson)
+	double d_prev = HUGE_VAL;
+	for(size_t j = 0; j < n; j++) {
+		const double d_next = ( (j + 1) < n ) ? ( _t[j + 1] - _t[j] ) * _inv_ds : HUGE_VAL;
+		_dtds[j] = std::min( _dtds[j], 3.0*std::min(d_prev, d_next) );
+		d_prev = d_next;
+	}
+
+	_is_valid = true;
+
+	return is_valid();
+}
+
+double ArcLengthTable::lookup( const double s ) const {
+	double dtds;
+	double d2tds2;
+
+	return lookup(s, dtds, d2tds2);
+}
+
+double ArcLengthTable::lookup( const double s, double& dtds, double& d2tds2 ) const {
+	dtds = 0.0;
+	d2tds2 = 0.0;
+
+	if( !_is_valid )
+		return 0.0;
+
+	//Station and position between stations, clamped in stations so the end
+	//is exact (NaN is held at the start)
+	const double n = (double)(_t.size() - 1);
+	const double x = ( s > 0.0 ) ? std::min( s * _inv_ds, n ) : 0.0;
+	const size_t j = segment_index(x, _t.size() - 1);
+	const double w = x - j;
+
+	//Cubic Hermite basis
+	const double w2 = w*w;
+	const double w3 = w2*w;
+	const double h00 = 2.0*w3 - 3.0*w2 + 1.0;
+	const double h10 = w3 - 2.0*w2 + w;
+	const double h01 = -2.0*w3 + 3.0*w2;
+	const double h11 = w3 - w2;
+
+	const double m0 = _ds*_dtds[j];
+	const double m1 = _ds*_dtds[j+1];
+
+	//The time is held outside the path
+	if( ( s > 0.0 ) && ( s < _length ) ) {
+		dtds = ( (6.0*w2 - 6.0*w)*(_t[j] - _t[j+1]) + (3.0*w2 - 4.0*w + 1.0)*m0 + (3.0*w2 - 2.0*w)*m1 ) * _inv_ds;
+		d2tds2 = ( (12.0*w - 6.0)*(_t[j] - _t[j+1]) + (6.0*w - 4.0)*m0 + (6.0*w - 2.0)*m1 ) * _inv_ds*_inv_ds;
+	}
+
+	//The pieces are monotonic, so this only guards against rounding
+	const double t = h00*_t[j] + h10*m0 + h01*_t[j+1] + h11*m1;
+	return clamp( t, _t[j], _t[j+1] );
+}
+
+//=======================
+// Private
+//=======================
+
+//The floor is in m/s, so it is scaled to the normalised time of the
+//segment (without it, the segment duration cancels out of the length)
+template<typename Scalar>
+double ArcLengthTable::_segment_rate( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u ) const {
+	const double m = _min_speed*h;
+	return std::sqrt( _segment_speed2(seg, u) + m*m );
+}
+
+template<typename Scalar>
+double ArcLengthTable::_segment_length( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u0, const double u1 ) const {
+	const double m = 0.5*(u1 + u0);
+	const double r = 0.5*(u1 - u0);
+
+	double l = 0.0;
+	for(size_t k = 0; k < gauss_legendre_points; k++)
+		l += gauss_legendre_w[k] * _segment_rate(seg, h, m + r*gauss_legendre_x[k]);
+
+	return l*r;
+}
+
+template<typename Scalar>
+double ArcLengthTable::_integrate( const BasicPackedQuinticTrajectory<Scalar>& trajectory ) {
+	const double* knots = trajectory.get_knots();
+	const double du = 1.0 / _resolution;
+
+	double s = 0.0;
+	_fwd_s[0] = 0.0;
+
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		const basic_packed_quintic_segment_t<Scalar>& seg = trajectory.get_segment(i);
+		const double h = knots[i+1] - knots[i];
+
+		for(size_t k = 0; k < _resolution; k++) {
+			s += _segment_length(seg, h, k*du, (k + 1)*du);
+			_fwd_s[i*_resolution + k + 1] = s;
+		}
+	}
+
+	return s;
+}
+
+template<typename Scalar>
+double ArcLengthTable::_segment_invert( const basic_packed_quintic_segment_t<Scalar>& seg, const double h, const double u0, const double u1, const double ds ) const {
+	if( !( ds > 0.0 ) )
+		return u0;
+
+	double lo = u0;
+	double hi = u1;
+	double u = 0.5*(lo + hi);
+
+	for(size_t i = 0; i < 64; i++) {
+		const double e = _segment_length(seg, h, u0, u) - ds;
+
+		//Keep the solution bracketed
+		if( e > 0.0 ) {
+			hi = u;
+		} else {
+			lo = u;
+		}
+
+		//Newton step (the derivative of the length is the speed),
+		//falling back to bisection if it leaves the bracket
+		const double v = _segment_rate(seg, h, u);
+		double un = ( v > 0.0 ) ? u - e / v : lo - 1.0;
+
+		if( !( (un > lo) && (un < hi) ) )
+			un = 0.5*(lo + hi);
+
+		const bool done = ( std::fabs(un - u) <= 1e-14 ) || ( (hi - lo) <= 1e-14 );
+		u = un;
+
+		if(done)
+			break;
+	}
+
+	return clamp(u, u0, u1);
+}
+
+template bool ArcLengthTable::build( const BasicPackedQuinticTrajectory<double>& trajectory, const double min_speed_ratio );
+template bool ArcLengthTable::build( const BasicPackedQuinticTrajectory<float>& trajectory, const double min_speed_ratio );
@@ -0,0 +1,285 @@
+#include <contrail_spline_lib/closest_point_tree.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/polynomial_roots.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace contrail_spline_lib;
+
+template<class T>
+constexpr static const T& clamp(const T& i, const T& min, const T& max) {
+	return (i < min) ? min : ( (i > max) ? max : i );
+}
+
+//Samples of the distance per segment, used to find its local minima
+static const size_t closest_point_samples = 8;
+
+//Squared distance from x to the path of a segment at u
+static double _path_dist2( const double (&a)[6][3], const double* x, const double u ) {
+	double d2 = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		const double d = ((((a[5][c]*u + a[4][c])*u + a[3][c])*u + a[2][c])*u + a[1][c])*u + a[0][c] - x[c];
+		d2 += d*d;
+	}
+
+	return d2;
+}
+
+//Half the derivative of the squared distance from x at u, f = (p - x).p',
+//and its derivative, df = p'.p' + (p - x).p''
+static void _path_dist2_slope( const double (&a)[6][3], const double* x, const double u, double& f, double& df ) {
+	f = 0.0;
+	df = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		const double d = ((((a[5][c]*u + a[4][c])*u + a[3][c])*u + a[2][c])*u + a[1][c])*u + a[0][c] - x[c];
+		const double v = (((5.0*a[5][c]*u + 4.0*a[4][c])*u + 3.0*a[3][c])*u + 2.0*a[2][c])*u + a[1][c];
+		const double w = ((20.0*a[5][c]*u + 12.0*a[4][c])*u + 6.0*a[3][c])*u + 2.0*a[2][c];
+
+		f += d*v;
+		df += v*v + d*w;
+	}
+}
+
+//Squared distance from x to a box (zero if inside)
+static double _box_dist2( const double* lo, const double* hi, const double* x ) {
+	double d2 = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		const double d = std::max( std::max(lo[c] - x[c], x[c] - hi[c]), 0.0 );
+		d2 += d*d;
+	}
+
+	return d2;
+}
+
+ClosestPointTree::ClosestPointTree( void ) :
+	_capacity(0),
+	_is_valid(false) {
+}
+
+ClosestPointTree::ClosestPointTree( const size_t capacity ) :
+	_capacity(capacity),
+	_is_valid(false) {
+
+	_paths.reserve(_capacity);
+	_knots.reserve(_capacity + 1);
+	_nodes.reserve( std::max( 2*_capacity, (size_t)1 ) - 1 );
+}
+
+ClosestPointTree::~ClosestPointTree( void ) {
+}
+
+template<typename Scalar>
+bool ClosestPointTree::build( const BasicPackedQuinticTrajectory<Scalar>& trajectory ) {
+	_is_valid = false;
+
+	if( !trajectory.is_valid() )
+		return is_valid();
+
+	const size_t num_seg = trajectory.get_num_segments();
+	if( ( ( _capacity > 0 ) && ( num_seg > _capacity ) ) ||
+		( num_seg >= std::numeric_limits<uint32_t>::max() ) )
+		return is_valid();
+
+	const double* knots = trajectory.get_knots();
+	_knots.assign(knots, knots + num_seg + 1);
+	_paths.resize(num_seg);
+
+	for(size_t i = 0; i < num_seg; i++) {
+		const basic_packed_quintic_segment_t<Scalar>& seg = trajectory.get_segment(i);
+		const double* origin = trajectory.get_origin(i);
+
+		for(size_t k = 0; k < 6; k++) {
+			for(size_t c = 0; c < 3; c++)
+				_paths[i].a[k][c] = seg.a[k][c];
+		}
+
+		if( origin != NULL ) {
+			for(size_t c = 0; c < 3; c++)
+				_paths[i].a[0][c] += origin[c];
+		}
+	}
+
+	_nodes.clear();
+	_build_node(0, num_seg);
+
+	_is_valid = true;
+
+	return is_valid();
+}
+
+bool ClosestPointTree::query( const double* x, closest_point_t& result ) const {
+	return is_valid() && query( x, _knots.front(), _knots.back(), result );
+}
+
+bool ClosestPointTree::query( const double* x, const double t0, const double t1, closest_point_t& result ) const {
+	if( !is_valid() )
+		return false;
+
+	//Segments (and normalised times) at each end of the window
+	const size_t num_seg = _paths.size();
+	const double tw0 = clamp(t0, _knots.front(), _knots.back());
+	const double tw1 = clamp(t1, tw0, _knots.back());
+	const size_t s0 = std::upper_bound( _knots.begin() + 1, _knots.begin() + num_seg, tw0 ) - ( _knots.begin() + 1 );
+	const size_t s1 = std::upper_bound( _knots.begin() + 1, _knots.begin() + num_seg, tw1 ) - ( _knots.begin() + 1 );
+
+	double d2_best = std::numeric_limits<double>::infinity();
+
+	//Depth-first, nearest box first (the tree is balanced, so the stack
+	//never holds more than 2 nodes per level)
+	uint32_t stack[2*sizeof(uint32_t)*8];
+	size_t depth = 0;
+	stack[depth++] = 0;
+
+	while( depth > 0 ) {
+		const uint32_t index = stack[--depth];
+		const node_t& node = _nodes[index];
+
+		if( ( node.last <= s0 ) || ( node.first > s1 ) ||
+			( _box_dist2(node.lo, node.hi, x) >= d2_best ) )
+			continue;
+
+		if( ( node.last - node.first ) == 1 ) {
+			const size_t seg = node.first;
+			const double inv_h = 1.0 / ( _knots[seg + 1] - _knots[seg] );
+			const double u0 = ( seg == s0 ) ? clamp( (tw0 - _knots[seg])*inv_h, 0.0, 1.0 ) : 0.0;
+			const double u1 = ( seg == s1 ) ? clamp( (tw1 - _knots[seg])*inv_h, u0, 1.0 ) : 1.0;
+
+			_search_segment(seg, x, u0, u1, d2_best, result);
+		} else {
+			const uint32_t left = index + 1;
+			const uint32_t right = node.right;
+			const bool left_first = _box_dist2(_nodes[left].lo, _nodes[left].hi, x) <= _box_dist2(_nodes[right].lo, _nodes[right].hi, x);
+
+			stack[depth++] = left_first ? right : left;
+			stack[depth++] = left_first ? left : right;
+		}
+	}
+
+	result.distance = std::sqrt(d2_best);
+
+	return true;
+}
+
+//=======================
+// Private
+//=======================
+
+uint32_t ClosestPointTree::_build_node( const uint32_t first, const uint32_t last ) {
+	const uint32_t index = _nodes.size();
+	_nodes.push_back(node_t());
+
+	uint32_t right = 0;
+	double lo[3];
+	double hi[3];
+
+	if( ( last - first ) == 1 ) {
+		//The bounds of each axis are at the ends, or at its turning points
+		const segment_path_t& path = _paths[first];
+
+		for(size_t c = 0; c < 3; c++) {
+			const double p[6] = {path.a[0][c], path.a[1][c], path.a[2][c], path.a[3][c], path.a[4][c], path.a[5][c]};
+			polynomial_range(p, 5, 0.0, 1.0, lo[c], hi[c]);
+		}
+	} else {
+		const uint32_t mid = first + (last - first)/2;
+		const uint32_t left = _build_node(first, mid);
+		right = _build_node(mid, last);
+
+		for(size_t c = 0; c < 3; c++) {
+			lo[c] = std::min(_nodes[left].lo[c], _nodes[right].lo[c]);
+			hi[c] = std::max(_nodes[left].hi[c], _nodes[right].hi[c]);
+		}
+	}
+
+	//The children may have moved the storage, so only index it now
+	node_t& node = _nodes[index];
+	for(size_t c = 0; c < 3; c++) {
+		node.lo[c] = lo[c];
+		node.hi[c] = hi[c];
+	}
+
+	node.first = first;
+	node.last = last;
+	node.right = right;
+
+	return index;
+}
+
+void ClosestPointTree::_search_segment( const size_t seg, const double* x, const double u0, const double u1,
+										double& d2_best, closest_point_t& result ) const {
+	const segment_path_t& path = _paths[seg];
+	const double du = (u1 - u0) / closest_point_samples;
+
+	double d2[closest_point_samples + 1];
+	for(size_t k = 0; k <= closest_point_samples; k++)
+		d2[k] = _path_dist2(path.a, x, u0 + k*du);
+
+	for(size_t k = 0; k <= closest_point_samples; k++) {
+		const bool local_min = ( ( k == 0 ) || ( d2[k] <= d2[k - 1] ) ) &&
+							   ( ( k == closest_point_samples ) || ( d2[k] <= d2[k + 1] ) );
+
+		if( !local_min )
+			continue;
+
+		double u = u0 + k*du;
+		double lo = std::max(u - du, u0);
+		double hi = std::min(u + du, u1);
+
+		//Refine if the minimum is bracketed between the neighbouring
+		//samples, otherwise it is at the end of the search interval
+		double f_lo, f_hi, df;
+		_path_dist2_slope(path.a, x, lo, f_lo, df);
+		_path_dist2_slope(path.a, x, hi, f_hi, df);
+
+		if( ( f_lo < 0.0 ) && ( f_hi > 0.0 ) ) {
+			for(size_t i = 0; i < 32; i++) {
+				double f;
+				_path_dist2_slope(path.a, x, u, f, df);
+
+				if( f == 0.0 )
+					break;
+
+				//Keep the minimum bracketed
+				if( f < 0.0 ) {
+					lo = u;
+				} else {
+					hi = u;
+				}
+
+				//Newton step, falling back to bisection if it leaves the bracket
+				double un = ( df > 0.0 ) ? u - f / df : lo - 1.0;
+
+				if( !( (un > lo) && (un < hi) ) )
+					un = 0.5*(lo + hi);
+
+				const bool done = ( std::fabs(un - u) <= 1e-14 ) || ( (hi - lo) <= 1e-14 );
+				u = un;
+
+				if(done)
+					break;
+			}
+		}
+
+		//Keep the sample if the refinement didn't improve on it
+		double d2_u = _path_dist2(path.a, x, u);
+		if( d2_u > d2[k] ) {
+			u = u0 + k*du;
+			d2_u = d2[k];
+		}
+
+		if( d2_u < d2_best ) {
+			d2_best = d2_u;
+			result.segment = seg;
+			result.u = u;
+			result.t = _knots[seg] + u*( _knots[seg + 1] - _knots[seg] );
+		}
+	}
+}
+
+template bool ClosestPointTree::build( const BasicPackedQuinticTrajectory<double>& trajectory );
+template bool ClosestPointTree::build( const BasicPackedQuinticTrajectory<float>& trajectory );
@@ -1,9 +1,13 @@
 #include <contrail_spline_lib/interpolated_quintic_spline.h>
 #include <contrail_spline_lib/quintic_spline_solver.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
 
 #include <eigen3/Eigen/Dense>
 
+#include <algorithm>
 #include <stdio.h>
+#include <cmath>
+#include <string.h>
 
 using namespace contrail_spline_lib;
 
@@ -13,59 +17,307 @@ constexpr static const T& clamp(const T& i, const T& min, const T& max) {
 }
 
 InterpolatedQuinticSpline::InterpolatedQuinticSpline( void ) :
+	_mode(INTERPOLATION_LINEAR_EST),
+	_start_dvia(0.0),
+	_start_ddvia(0.0),
+	_capacity(0),
+	_is_uniform(true),
 	_is_valid(false) {
+
+	_spline.duration = 1.0;
+}
+
+InterpolatedQuinticSpline::InterpolatedQuinticSpline( const size_t capacity ) :
+	_mode(INTERPOLATION_LINEAR_EST),
+	_start_dvia(0.0),
+	_start_ddvia(0.0),
+	_capacity(capacity),
+	_is_uniform(true),
+	_is_valid(false) {
+
+	_spline.duration = 1.0;
+
+	_vias.reserve(_capacity);
+	_dvias.reserve(_capacity);
+	_ddvias.reserve(_capacity);
+	_work.reserve(6*_capacity);
+	_spline.knots.reserve(_capacity);
+	_spline.seg_coeffs.reserve(_capacity);
 }
 
 InterpolatedQuinticSpline::~InterpolatedQuinticSpline( void ) {
 }
 
 bool InterpolatedQuinticSpline::interpolate( const Eigen::VectorXd& vias ) {
-	if( vias.size() >= 2 ) {
-		_subsplines.clear();
+	return interpolate( vias.data(), vias.size() );
+}
 
-		_vias = vias;
-		_dvias = _solver.linear_derivative_est(_vias, 1.0);
+bool InterpolatedQuinticSpline::interpolate( const Eigen::VectorXd& vias, const Eigen::VectorXd& knots ) {
+	if( knots.size() != vias.size() )
+		return is_valid();
 
-		_ddvias = _solver.linear_derivative_est(_dvias, 1.0);
+	return interpolate( vias.data(), vias.size(), knots.data() );
+}
 
-		for(size_t i=0; i < (_vias.size() - 1); i++) {
-			_subsplines.push_back( _solver.solver( _vias(i),
-												   _dvias(i),
-												   _ddvias(i),
-												   _vias(i+1),
-												   _dvias(i+1),
-												   _ddvias(i+1) ) );
+bool InterpolatedQuinticSpline::interpolate( const double* vias, const size_t num_vias, const double* knots ) {
+	if( ( num_vias < 2 ) || ( ( _capacity > 0 ) && ( num_vias > _capacity ) ) )
+		return is_valid();
+
+	if( knots ) {
+		for(size_t i = 1; i < num_vias; i++) {
+			if( !( knots[i] > knots[i-1] ) )
+				return is_valid();
 		}
+	}
+
+	//None of these allocate unless growing past the reserved capacity
+	const size_t num_seg = num_vias - 1;
+	_vias.resize(num_vias);
+	_dvias.resize(num_vias);
+	_ddvias.resize(num_vias);
+	_spline.knots.resize(num_vias);
+	_spline.seg_coeffs.resize(num_seg);
+
+	std::copy(vias, vias + num_vias, _vias.begin());
+
+	//Normalise the knots onto 0 <= u <= 1
+	if( knots ) {
+		const double k0 = knots[0];
+		const double kr = knots[num_seg] - k0;
+
+		for(size_t i = 0; i < num_seg; i++)
+			_spline.knots[i] = (knots[i] - k0) / kr;
+	} else {
+		for(size_t i = 0; i < num_seg; i++)
+			_spline.knots[i] = (double)i / num_seg;
+	}
+	_spline.knots[num_seg] = 1.0;
 
-		_is_valid = true;
+	if( _mode == INTERPOLATION_MIN_JERK ) {
+		//Start from the given derivatives, and end at rest
+		_work.resize(6*num_vias);
+		_dvias.front() = _start_dvia;
+		_dvias.back() = 0.0;
+		_ddvias.front() = _start_ddvia;
+		_ddvias.back() = 0.0;
+
+		_solver.min_jerk_derivatives( _vias.data(), _spline.knots.data(), num_vias, _dvias.data(), _ddvias.data(), _work.data() );
+	} else {
+		//The start velocity is set before the accelerations are estimated
+		//from the velocities, so the second via sees it as well
+		_solver.linear_derivative_est( _vias.data(), _spline.knots.data(), num_vias, _dvias.data() );
+		_dvias.front() = _start_dvia;
+		_solver.linear_derivative_est( _dvias.data(), _spline.knots.data(), num_vias, _ddvias.data() );
+		_ddvias.front() = _start_ddvia;
 	}
 
+	_solver.solver_batch( _vias.data(),
+						  _dvias.data(),
+						  _ddvias.data(),
+						  _spline.knots.data(),
+						  num_vias,
+						  _spline.seg_coeffs.data() );
+
+	_is_uniform = ( knots == NULL );
+	_is_valid = true;
+
 	return is_valid();
 }
 
-const Eigen::VectorXd& InterpolatedQuinticSpline::get_vias( void ) {
-	return _vias;
+Eigen::Map<const Eigen::VectorXd> InterpolatedQuinticSpline::get_vias( void ) const {
+	return Eigen::Map<const Eigen::VectorXd>( _vias.data(), _vias.size() );
+}
+
+Eigen::Map<const Eigen::VectorXd> InterpolatedQuinticSpline::get_dvias( void ) const {
+	return Eigen::Map<const Eigen::VectorXd>( _dvias.data(), _dvias.size() );
 }
 
-const Eigen::VectorXd& InterpolatedQuinticSpline::get_dvias( void ) {
-	return _dvias;
+Eigen::Map<const Eigen::VectorXd> InterpolatedQuinticSpline::get_ddvias( void ) const {
+	return Eigen::Map<const Eigen::VectorXd>( _ddvias.data(), _ddvias.size() );
 }
 
-const Eigen::VectorXd& InterpolatedQuinticSpline::get_ddvias( void ) {
-	return _ddvias;
+const std::vector<double>& InterpolatedQuinticSpline::get_knots( void ) const {
+	return _spline.knots;
 }
 
-quintic_spline_point_t InterpolatedQuinticSpline::lookup( double u ) {
+//Finds the segment for a lookup, the normalised time within that segment,
+//and the inverse of the segment duration (to denormalise the derivatives)
+void InterpolatedQuinticSpline::_locate( const double u, size_t& seg, double& u_seg, double& inv_h ) const {
+	const size_t num_seg = _spline.seg_coeffs.size();
+	//NaN is looked up at the start, as the batched lookups do (max(NaN, 0) is 0)
+	const double u_c = ( u > 0.0 ) ? std::min(u, 1.0) : 0.0;
+
+	if( _is_uniform ) {
+		const double u_s = u_c * num_seg;
+
+		seg = segment_index(u_s, num_seg);
+		u_seg = clamp( u_s - seg, 0.0, 1.0 );
+		inv_h = num_seg;
+	} else {
+		//Binary search over the interior knots
+		const std::vector<double>& k = _spline.knots;
+		seg = std::upper_bound( k.begin() + 1, k.end() - 1, u_c ) - ( k.begin() + 1 );
+		inv_h = 1.0 / ( k[seg+1] - k[seg] );
+		u_seg = clamp( (u_c - k[seg]) * inv_h, 0.0, 1.0 );
+	}
+}
+
+quintic_spline_point_t InterpolatedQuinticSpline::lookup( double u ) const {
 	quintic_spline_point_t point;
 
 	if( _is_valid ) {
-		double u_c = clamp(u, 0.0, 1.0);
-		double s_step = 1.0 / _subsplines.size();
-		int seg = clamp( (int)std::floor(u_c / s_step), 0, (int)(_subsplines.size() - 1) );
-		double u_seg = clamp( (u_c - seg*s_step)/s_step, 0.0, 1.0 );
+		size_t seg;
+		double u_seg;
+		double inv_h;
+		_locate(u, seg, u_seg, inv_h);
 
-		point = _solver.lookup( u_seg, _subsplines[seg] );
+		point = _solver.lookup( u_seg, _spline.seg_coeffs[seg] );
+		point.qd *= inv_h;
+		point.qdd *= inv_h*inv_h;
 	}
 
 	return point;
 }
+
+void InterpolatedQuinticSpline::lookup_batch( const double* u, const size_t n, quintic_spline_point_t* out ) const {
+	if( _is_valid ) {
+		_lookup_lanes(u, n, out);
+	} else {
+		memset(out, 0, n*sizeof(quintic_spline_point_t));
+	}
+}
+
+void InterpolatedQuinticSpline::lookup_uniform( const double u0, const double du, const size_t n, quintic_spline_point_t* out ) const {
+	//Generate the grid in small blocks on the stack so we never allocate
+	const size_t block = 64;
+	double u[block];
+
+	for(size_t i = 0; i < n; i += block) {
+		const size_t m = std::min(block, n - i);
+
+		for(size_t j = 0; j < m; j++)
+			u[j] = u0 + (i + j)*du;
+
+		lookup_batch(u, m, &out[i]);
+	}
+}
+
+void InterpolatedQuinticSpline::_lookup_lanes( const double* u, const size_t n, quintic_spline_point_t* out ) const {
+	static_assert( sizeof(quintic_spline_coeffs_t) == 6*sizeof(double), "quintic_spline_coeffs_t must be tightly packed" );
+
+	const std::vector<quintic_spline_coeffs_t>& coeffs = _spline.seg_coeffs;
+	size_t i = 0;
+
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 4
+	const size_t num_seg = coeffs.size();
+	const double* c = reinterpret_cast<const double*>( coeffs.data() );
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d nseg = _mm256_set1_pd( (double)num_seg );
+	const __m256d seg_max = _mm256_set1_pd( (double)(num_seg - 1) );
+
+	for(; (i + 4) <= n; i += 4) {
+		__m256d u_seg;
+		__m256d inv_h;
+		__m128i off;	//Offset of each lane's coefficients (seg*6)
+
+		if( _is_uniform ) {
+			const __m256d u_s = _mm256_mul_pd( _mm256_min_pd( _mm256_max_pd( _mm256_loadu_pd(&u[i]), zero ), one ), nseg );
+			const __m256d seg_d = _mm256_min_pd( _mm256_floor_pd(u_s), seg_max );
+			const __m128i seg_i = _mm256_cvttpd_epi32(seg_d);
+
+			u_seg = _mm256_min_pd( _mm256_max_pd( _mm256_sub_pd(u_s, seg_d), zero ), one );
+			inv_h = nseg;
+			off = _mm_add_epi32( _mm_slli_epi32(seg_i, 2), _mm_slli_epi32(seg_i, 1) );
+		} else {
+			int o[4];
+			double us[4];
+			double ih[4];
+			for(size_t j = 0; j < 4; j++) {
+				size_t seg;
+				_locate(u[i + j], seg, us[j], ih[j]);
+				o[j] = 6*seg;
+			}
+
+			u_seg = _mm256_loadu_pd(us);
+			inv_h = _mm256_loadu_pd(ih);
+			off = _mm_loadu_si128( reinterpret_cast<const __m128i*>(o) );
+		}
+
+#if defined(__AVX2__)
+		//Masked form of the gather avoids reading an undefined source register
+		const __m256d mask = _mm256_castsi256_pd( _mm256_set1_epi64x(-1) );
+		const __m256d a1 = _mm256_mask_i32gather_pd(zero, c + 0, off, mask, 8);
+		const __m256d a2 = _mm256_mask_i32gather_pd(zero, c + 1, off, mask, 8);
+		const __m256d a3 = _mm256_mask_i32gather_pd(zero, c + 2, off, mask, 8);
+		const __m256d a4 = _mm256_mask_i32gather_pd(zero, c + 3, off, mask, 8);
+		const __m256d a5 = _mm256_mask_i32gather_pd(zero, c + 4, off, mask, 8);
+		const __m256d a6 = _mm256_mask_i32gather_pd(zero, c + 5, off, mask, 8);
+#else
+		int o[4];
+		_mm_storeu_si128( reinterpret_cast<__m128i*>(o), off );
+		const __m256d a1 = _mm256_set_pd(c[o[3] + 0], c[o[2] + 0], c[o[1] + 0], c[o[0] + 0]);
+		const __m256d a2 = _mm256_set_pd(c[o[3] + 1], c[o[2] + 1], c[o[1] + 1], c[o[0] + 1]);
+		const __m256d a3 = _mm256_set_pd(c[o[3] + 2], c[o[2] + 2], c[o[1] + 2], c[o[0] + 2]);
+		const __m256d a4 = _mm256_set_pd(c[o[3] + 3], c[o[2] + 3], c[o[1] + 3], c[o[0] + 3]);
+		const __m256d a5 = _mm256_set_pd(c[o[3] + 4], c[o[2] + 4], c[o[1] + 4], c[o[0] + 4]);
+		const __m256d a6 = _mm256_set_pd(c[o[3] + 5], c[o[2] + 5], c[o[1] + 5], c[o[0] + 5]);
+#endif
+
+		__m256d q, qd, qdd;
+		quintic_horner_x4(u_seg, a1, a2, a3, a4, a5, a6, q, qd, qdd);
+
+		double rq[4], rqd[4], rqdd[4];
+		_mm256_storeu_pd(rq, q);
+		_mm256_storeu_pd(rqd, _mm256_mul_pd(qd, inv_h));
+		_mm256_storeu_pd(rqdd, _mm256_mul_pd(qdd, _mm256_mul_pd(inv_h, inv_h)));
+
+		for(size_t j = 0; j < 4; j++) {
+			out[i + j].q = rq[j];
+			out[i + j].qd = rqd[j];
+			out[i + j].qdd = rqdd[j];
+		}
+	}
+#elif CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 2
+	for(; (i + 2) <= n; i += 2) {
+		size_t s0, s1;
+		double u0, u1;
+		double h0, h1;
+		_locate(u[i], s0, u0, h0);
+		_locate(u[i + 1], s1, u1, h1);
+
+		const quintic_spline_coeffs_t& c0 = coeffs[s0];
+		const quintic_spline_coeffs_t& c1 = coeffs[s1];
+
+		__m128d q, qd, qdd;
+		quintic_horner_x2( _mm_set_pd(u1, u0),
+						   _mm_set_pd(c1.a1, c0.a1), _mm_set_pd(c1.a2, c0.a2), _mm_set_pd(c1.a3, c0.a3),
+						   _mm_set_pd(c1.a4, c0.a4), _mm_set_pd(c1.a5, c0.a5), _mm_set_pd(c1.a6, c0.a6),
+						   q, qd, qdd );
+
+		const __m128d inv_h = _mm_set_pd(h1, h0);
+		double rq[2], rqd[2], rqdd[2];
+		_mm_storeu_pd(rq, q);
+		_mm_storeu_pd(rqd, _mm_mul_pd(qd, inv_h));
+		_mm_storeu_pd(rqdd, _mm_mul_pd(qdd, _mm_mul_pd(inv_h, inv_h)));
+
+		for(size_t j = 0; j < 2; j++) {
+			out[i + j].q = rq[j];
+			out[i + j].qd = rqd[j];
+			out[i + j].qdd = rqdd[j];
+		}
+	}
+#endif
+
+	//Scalar fallback and remainder
+	for(; i < n; i++) {
+		size_t seg;
+		double u_seg;
+		double inv_h;
+		_locate(u[i], seg, u_seg, inv_h);
+
+		out[i] = quintic_horner( u_seg, coeffs[seg] );
+		out[i].qd *= inv_h;
+		out[i].qdd *= inv_h*inv_h;
+	}
+}
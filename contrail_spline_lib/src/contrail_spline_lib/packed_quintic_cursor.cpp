@@ -0,0 +1,107 @@
+#include <contrail_spline_lib/packed_quintic_cursor.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
+
+#include <string.h>
+
+using namespace contrail_spline_lib;
+
+template<class T>
+constexpr static const T& clamp(const T& i, const T& min, const T& max) {
+	return (i < min) ? min : ( (i > max) ? max : i );
+}
+
+template<typename Scalar>
+BasicPackedQuinticCursor<Scalar>::BasicPackedQuinticCursor( void ) :
+	_trajectory(NULL),
+	_seg(0),
+	_t0(0.0),
+	_t1(0.0) {
+
+	memset(&_coeffs, 0, sizeof(_coeffs));
+	memset(_origin, 0, sizeof(_origin));
+}
+
+template<typename Scalar>
+BasicPackedQuinticCursor<Scalar>::~BasicPackedQuinticCursor( void ) {
+}
+
+template<typename Scalar>
+void BasicPackedQuinticCursor<Scalar>::reset( const BasicPackedQuinticTrajectory<Scalar>& trajectory ) {
+	_trajectory = &trajectory;
+
+	if( is_valid() )
+		_load(0);
+}
+
+template<typename Scalar>
+packed_quintic_point_t BasicPackedQuinticCursor<Scalar>::lookup( const double t ) {
+	packed_quintic_point_t p;
+
+	if( !is_valid() ) {
+		memset(&p, 0, sizeof(p));
+		return p;
+	}
+
+	const size_t num_seg = _trajectory->get_num_segments();
+
+	if( t < _t0 ) {
+		//Went backwards, so search for the segment again
+		if( _seg > 0 )
+			_load( _trajectory->locate(t) );
+	} else if( ( t >= _t1 ) && ( (_seg + 1) < num_seg ) ) {
+		//Step forward to the segment containing t
+		size_t seg = _seg + 1;
+		const double* knots = _trajectory->get_knots();
+
+		while( ( (seg + 1) < num_seg ) && ( t >= knots[seg + 1] ) )
+			seg++;
+
+		_load(seg);
+	}
+
+	//Time since the start of the segment (the coefficients are already denormalised)
+	const double tau = clamp( t - _t0, 0.0, _t1 - _t0 );
+	packed_quintic_horner( (Scalar)tau, _coeffs, 1.0, 1.0, p );
+
+	for(size_t i = 0; i < packed_channels; i++)
+		p.q[i] += _origin[i];
+
+	return p;
+}
+
+//=======================
+// Private
+//=======================
+
+template<typename Scalar>
+void BasicPackedQuinticCursor<Scalar>::_load( const size_t seg ) {
+	const double* knots = _trajectory->get_knots();
+	const basic_packed_quintic_segment_t<Scalar>& c = _trajectory->get_segment(seg);
+	const double* origin = _trajectory->get_origin(seg);
+
+	_seg = seg;
+	_t0 = knots[seg];
+	_t1 = knots[seg + 1];
+
+	//a_k*u^k = (a_k/h^k)*tau^k, where u = tau/h
+	const double inv_h = 1.0 / (_t1 - _t0);
+	double s = 1.0;
+
+	for(size_t k = 0; k < 6; k++) {
+		for(size_t i = 0; i < packed_channels; i++)
+			_coeffs.a[k][i] = (Scalar)(c.a[k][i]*s);
+
+		s *= inv_h;
+	}
+
+	for(size_t i = 0; i < packed_channels; i++)
+		_origin[i] = ( origin != NULL ) ? origin[i] : 0.0;
+}
+
+namespace contrail_spline_lib {
+
+template class BasicPackedQuinticCursor<double>;
+template class BasicPackedQuinticCursor<float>;
+
+}
@@ -0,0 +1,727 @@
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
+#include <contrail_spline_lib/trajectory_file.h>
+
+#include <eigen3/Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace contrail_spline_lib;
+
+template<class T>
+constexpr static const T& clamp(const T& i, const T& min, const T& max) {
+	return (i < min) ? min : ( (i > max) ? max : i );
+}
+
+//Samples between resyncs of the forward differences (see lookup_uniform())
+static const size_t forward_diff_resync = 256;
+//Shorter runs are looked up directly, as setting up the differences
+//costs about as much as a few lookups
+static const size_t forward_diff_min_run = 8;
+
+//j!*S(k,j), where S(k,j) are the Stirling numbers of the second kind, is
+//the j-th forward difference of x^k at x = 0 for a unit step
+static const double forward_diff_weights[6][6] = { {1,  0,  0,   0,   0,   0},
+												   {0,  1,  0,   0,   0,   0},
+												   {0,  1,  2,   0,   0,   0},
+												   {0,  1,  6,   6,   0,   0},
+												   {0,  1, 14,  36,  24,   0},
+												   {0,  1, 30, 150, 240, 120} };
+
+//Converts the coefficients of a polynomial in the sample index (d, up to
+//x^order) into its forward differences at the first sample (diff[0..order])
+static void forward_diff_table( const double* d, const size_t order, double* diff ) {
+	for(size_t j = 0; j <= order; j++) {
+		diff[j] = 0.0;
+		for(size_t k = j; k <= order; k++)
+			diff[j] += d[k]*forward_diff_weights[k][j];
+	}
+}
+
+//Knots (normalised) of different splines closer than this are merged
+static const double knot_merge_tolerance = 1e-12;
+
+//Merges the (normalised) knots of each channel into one ascending list,
+//returning its length. Only counted if "merged" is NULL
+static size_t merge_knots( const InterpolatedQuinticSpline* const* channels, double* merged ) {
+	size_t next[packed_channels] = {0};
+	size_t num = 0;
+
+	while( true ) {
+		//Smallest knot not yet merged from any channel
+		double u = 2.0;
+		for(size_t c = 0; c < packed_channels; c++) {
+			const std::vector<double>& knots = channels[c]->get_knots();
+			if( next[c] < knots.size() )
+				u = std::min( u, knots[next[c]] );
+		}
+
+		if( u > 1.0 )
+			break;
+
+		if( merged != NULL )
+			merged[num] = u;
+		num++;
+
+		for(size_t c = 0; c < packed_channels; c++) {
+			const std::vector<double>& knots = channels[c]->get_knots();
+			while( ( next[c] < knots.size() ) && ( knots[next[c]] <= u + knot_merge_tolerance ) )
+				next[c]++;
+		}
+	}
+
+	//Every spline ends at exactly 1
+	if( merged != NULL )
+		merged[num - 1] = 1.0;
+
+	return num;
+}
+
+//Re-expresses a segment over part of itself, [u0, u0 + s], as p(u0 + s*v)
+//over 0 <= v <= 1 (the same quintic, so nothing is refitted)
+static quintic_spline_coeffs_t restrict_segment( const quintic_spline_coeffs_t& c, const double u0, const double s ) {
+	double a[6] = {c.a1, c.a2, c.a3, c.a4, c.a5, c.a6};
+
+	//Taylor shift to u0 (repeated synthetic division)
+	for(size_t j = 0; j < 5; j++) {
+		for(size_t k = 5; k > j; k--)
+			a[k - 1] += u0*a[k];
+	}
+
+	double sk = s;
+	for(size_t k = 1; k < 6; k++) {
+		a[k] *= sk;
+		sk *= s;
+	}
+
+	quintic_spline_coeffs_t r;
+	r.a1 = a[0];
+	r.a2 = a[1];
+	r.a3 = a[2];
+	r.a4 = a[3];
+	r.a5 = a[4];
+	r.a6 = a[5];
+
+	return r;
+}
+
+//Creates an empty, uniquely named file next to "filename" (with the
+//permissions of any new file), returning its name in "temp"
+static bool create_temp_file( const std::string& filename, std::string& temp ) {
+	static std::atomic<unsigned int> count(0);
+
+	for(size_t attempt = 0; attempt < 16; attempt++) {
+		char suffix[48];
+		snprintf( suffix, sizeof(suffix), ".tmp.%d.%u", (int)getpid(), count.fetch_add(1) );
+		temp = filename + suffix;
+
+		const int fd = open( temp.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666 );
+		if( fd >= 0 ) {
+			close(fd);
+			return true;
+		}
+
+		if( errno != EEXIST )
+			return false;
+	}
+
+	return false;
+}
+
+template<typename Scalar>
+BasicPackedQuinticTrajectory<Scalar>::BasicPackedQuinticTrajectory( void ) :
+	_segment_data(NULL),
+	_knot_data(NULL),
+	_origin_data(NULL),
+	_num_segments(0),
+	_map_size(0),
+	_duration(0.0),
+	_inv_seg_duration(0.0),
+	_capacity(0),
+	_rebase(false),
+	_is_uniform(true),
+	_is_valid(false) {
+}
+
+template<typename Scalar>
+BasicPackedQuinticTrajectory<Scalar>::BasicPackedQuinticTrajectory( const size_t capacity ) :
+	_segment_data(NULL),
+	_knot_data(NULL),
+	_origin_data(NULL),
+	_num_segments(0),
+	_map_size(0),
+	_duration(0.0),
+	_inv_seg_duration(0.0),
+	_capacity(capacity),
+	_rebase(false),
+	_is_uniform(true),
+	_is_valid(false) {
+
+	_segments.reserve(_capacity);
+	_knots.reserve(_capacity + 1);
+	_origins.reserve(_capacity*packed_channels);
+}
+
+template<typename Scalar>
+BasicPackedQuinticTrajectory<Scalar>::~BasicPackedQuinticTrajectory( void ) {
+	_unmap();
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::pack( const InterpolatedQuinticSpline& x,
+												 const InterpolatedQuinticSpline& y,
+												 const InterpolatedQuinticSpline& z,
+												 const InterpolatedQuinticSpline& yaw,
+												 const double duration ) {
+	const InterpolatedQuinticSpline* channels[packed_channels] = {&x, &y, &z, &yaw};
+
+	_is_valid = false;
+	_unmap();
+
+	if( !( duration > 0.0 ) )
+		return is_valid();
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		if( !channels[c]->is_valid() )
+			return is_valid();
+	}
+
+	//The segments are split at the knots of every spline, so counted first
+	const size_t num_seg = merge_knots(channels, NULL) - 1;
+
+	if( ( _capacity > 0 ) && ( num_seg > _capacity ) )
+		return is_valid();
+
+	_segments.resize(num_seg);
+	_origins.resize(_rebase ? num_seg*packed_channels : 0);
+
+	//Normalised until every channel is stored
+	_knots.resize(num_seg + 1);
+	merge_knots(channels, _knots.data());
+
+	bool is_uniform = false;
+	for(size_t c = 0; c < packed_channels; c++) {
+		const InterpolatedQuinticSpline& spline = *channels[c];
+		const std::vector<double>& knots = spline.get_knots();
+		const double* vias = spline.get_vias().data();
+		const double* dvias = spline.get_dvias().data();
+		const double* ddvias = spline.get_ddvias().data();
+
+		if( knots.size() == num_seg + 1 ) {
+			//Has every knot, so we can solve directly from the via data
+			is_uniform = is_uniform || spline.is_uniform();
+
+			//Solve in blocks, then transpose into the packed layout
+			const size_t block = 64;
+			quintic_spline_coeffs_t a[block];
+
+			for(size_t i = 0; i < num_seg; i += block) {
+				const size_t m = std::min(block, num_seg - i);
+				_solver.solver_batch( &vias[i], &dvias[i], &ddvias[i], &knots[i], m + 1, a );
+
+				for(size_t j = 0; j < m; j++)
+					_store( i + j, c, a[j] );
+			}
+		} else {
+			//Split each segment of the spline at the knots of the others
+			size_t j = 0;
+			double h = knots[1] - knots[0];
+			quintic_spline_coeffs_t a = _solver.solver( vias[0], dvias[0]*h, ddvias[0]*h*h,
+														vias[1], dvias[1]*h, ddvias[1]*h*h );
+
+			for(size_t i = 0; i < num_seg; i++) {
+				while( ( j + 2 < knots.size() ) && ( knots[j + 1] <= _knots[i] + knot_merge_tolerance ) ) {
+					j++;
+					h = knots[j + 1] - knots[j];
+					a = _solver.solver( vias[j], dvias[j]*h, ddvias[j]*h*h,
+										vias[j + 1], dvias[j + 1]*h, ddvias[j + 1]*h*h );
+				}
+
+				_store( i, c, restrict_segment( a, (_knots[i] - knots[j]) / h, (_knots[i + 1] - _knots[i]) / h ) );
+			}
+		}
+	}
+
+	for(size_t i = 0; i < num_seg; i++)
+		_knots[i] *= duration;
+	_knots[num_seg] = duration;
+
+	_segment_data = _segments.data();
+	_knot_data = _knots.data();
+	_origin_data = _rebase ? _origins.data() : NULL;
+	_num_segments = num_seg;
+
+	_duration = duration;
+	_inv_seg_duration = num_seg / duration;
+	_is_uniform = is_uniform;
+	_is_valid = true;
+
+	return is_valid();
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::assign( const BasicPackedQuinticTrajectory& other ) {
+	if( &other == this )
+		return is_valid();
+
+	_is_valid = false;
+	_unmap();
+
+	const size_t num_seg = other._num_segments;
+	if( !other.is_valid() )
+		return is_valid();
+
+	if( other.is_mapped() ) {
+		//Shared, so none of the file is read in here (and the capacity
+		//doesn't apply, as nothing is stored)
+		_map = other._map;
+		_map_size = other._map_size;
+
+		_segment_data = other._segment_data;
+		_knot_data = other._knot_data;
+		_origin_data = other._origin_data;
+	} else {
+		if( ( _capacity > 0 ) && ( num_seg > _capacity ) )
+			return is_valid();
+
+		const bool rebased = other.is_rebased();
+		_segments.assign( other._segment_data, other._segment_data + num_seg );
+		_knots.assign( other._knot_data, other._knot_data + num_seg + 1 );
+		if( rebased ) {
+			_origins.assign( other._origin_data, other._origin_data + num_seg*packed_channels );
+		} else {
+			_origins.clear();
+		}
+
+		_segment_data = _segments.data();
+		_knot_data = _knots.data();
+		_origin_data = rebased ? _origins.data() : NULL;
+	}
+
+	_num_segments = num_seg;
+
+	_duration = other._duration;
+	_inv_seg_duration = other._inv_seg_duration;
+	_is_uniform = other._is_uniform;
+	_is_valid = true;
+
+	return is_valid();
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::splice( const BasicPackedQuinticTrajectory& head, const size_t first, const size_t last,
+												   const BasicPackedQuinticTrajectory& tail ) {
+	_is_valid = false;
+	_unmap();
+
+	if( !head.is_valid() || !tail.is_valid() || ( &head == this ) || ( &tail == this ) ||
+		( first > last ) || ( last > head._num_segments ) || ( head.is_rebased() != tail.is_rebased() ) )
+		return is_valid();
+
+	const size_t num_head = last - first;
+	const size_t num_seg = num_head + tail._num_segments;
+
+	if( ( _capacity > 0 ) && ( num_seg > _capacity ) )
+		return is_valid();
+
+	const bool rebased = tail.is_rebased();
+	_segments.resize(num_seg);
+	_origins.resize(rebased ? num_seg*packed_channels : 0);
+	_knots.resize(num_seg + 1);
+
+	std::copy( head._segment_data + first, head._segment_data + last, _segments.begin() );
+	std::copy( tail._segment_data, tail._segment_data + tail._num_segments, _segments.begin() + num_head );
+
+	if( rebased ) {
+		std::copy( head._origin_data + first*packed_channels, head._origin_data + last*packed_channels, _origins.begin() );
+		std::copy( tail._origin_data, tail._origin_data + tail._num_segments*packed_channels, _origins.begin() + num_head*packed_channels );
+	}
+
+	//The tail starts where the head segments end
+	const double t0 = head._knot_data[first];
+	const double t_join = head._knot_data[last] - t0;
+
+	for(size_t i = 0; i < num_head; i++)
+		_knots[i] = head._knot_data[first + i] - t0;
+
+	for(size_t i = 0; i <= tail._num_segments; i++)
+		_knots[num_head + i] = t_join + tail._knot_data[i];
+
+	_segment_data = _segments.data();
+	_knot_data = _knots.data();
+	_origin_data = rebased ? _origins.data() : NULL;
+	_num_segments = num_seg;
+
+	_duration = _knots[num_seg];
+	_inv_seg_duration = num_seg / _duration;
+	_is_uniform = false;
+	_is_valid = true;
+
+	return is_valid();
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::splice_at( const BasicPackedQuinticTrajectory& head, const size_t first, const double t,
+													  const BasicPackedQuinticTrajectory& tail ) {
+	if( !head.is_valid() || ( first >= head._num_segments ) || !( t > head._knot_data[first] ) )
+		return splice( head, first, first, tail );
+
+	//Join at the knot if t lands on one, otherwise keep the segment it is in
+	const size_t seg = head.locate(t);
+	const bool cut = ( t < head._knot_data[seg + 1] ) && ( t > head._knot_data[seg] );
+	const size_t last = cut ? seg + 1 : ( ( t < head._knot_data[seg + 1] ) ? seg : seg + 1 );
+
+	if( !splice( head, first, last, tail ) || !cut )
+		return is_valid();
+
+	//p(s*u) over the shortened segment, so its start (and origin) is unchanged
+	const double t0 = head._knot_data[first];
+	const double h = head._knot_data[seg + 1] - head._knot_data[seg];
+	const double s = ( t - head._knot_data[seg] ) / h;
+	segment_t& cut_seg = _segments[seg - first];
+
+	double sk = s;
+	for(size_t k = 1; k < 6; k++) {
+		for(size_t c = 0; c < packed_channels; c++)
+			cut_seg.a[k][c] = (Scalar)( cut_seg.a[k][c]*sk );
+
+		sk *= s;
+	}
+
+	//Pull the tail back to the end of the shortened segment
+	const double dt = head._knot_data[seg + 1] - t;
+	for(size_t i = last - first; i <= _num_segments; i++)
+		_knots[i] -= dt;
+
+	_knots[last - first] = t - t0;
+	_duration = _knots[_num_segments];
+
+	return is_valid();
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::save( const std::string& filename ) const {
+	if( !_is_valid )
+		return false;
+
+	trajectory_file_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, trajectory_file_magic, sizeof(header.magic));
+	header.version = trajectory_file_version;
+	header.header_size = sizeof(trajectory_file_header_t);
+	header.channels = packed_channels;
+	header.segment_size = sizeof(segment_t);
+	header.num_segments = _num_segments;
+	header.knots_offset = sizeof(trajectory_file_header_t);
+	header.duration = _duration;
+	header.flags = ( _is_uniform ? TRAJECTORY_FILE_UNIFORM_KNOTS : 0 ) |
+				   ( _single_precision() ? TRAJECTORY_FILE_SINGLE_PRECISION : 0 ) |
+				   ( is_rebased() ? TRAJECTORY_FILE_REBASED : 0 );
+	header.byte_order_mark = trajectory_file_byte_order_mark;
+
+	//Segments start on the next 64-byte boundary after the knots
+	const uint64_t knots_end = header.knots_offset + (_num_segments + 1)*sizeof(double);
+	header.segments_offset = _align_offset(knots_end);
+
+	//Origins (if rebased) start on the next 64-byte boundary after the segments
+	const uint64_t segments_end = header.segments_offset + _num_segments*sizeof(segment_t);
+
+	//Written in full to a new file that then replaces the target, so any
+	//mapping of the old file (e.g. a trajectory being flown) keeps the old
+	//data, rather than reading a half-written or truncated file
+	std::string temp;
+	if( !create_temp_file(filename, temp) )
+		return false;
+
+	std::ofstream file( temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+	const char padding[64] = {0};
+
+	file.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+	file.write( reinterpret_cast<const char*>(_knot_data), (_num_segments + 1)*sizeof(double) );
+	file.write( padding, header.segments_offset - knots_end );
+	file.write( reinterpret_cast<const char*>(_segment_data), _num_segments*sizeof(segment_t) );
+
+	if( is_rebased() ) {
+		file.write( padding, _align_offset(segments_end) - segments_end );
+		file.write( reinterpret_cast<const char*>(_origin_data), _num_segments*packed_channels*sizeof(double) );
+	}
+
+	file.close();
+
+	if( file.fail() || ( rename( temp.c_str(), filename.c_str() ) != 0 ) ) {
+		remove( temp.c_str() );
+		return false;
+	}
+
+	return true;
+}
+
+template<typename Scalar>
+bool BasicPackedQuinticTrajectory<Scalar>::load( const std::string& filename ) {
+	_is_valid = false;
+	_unmap();
+
+	const int fd = open( filename.c_str(), O_RDONLY );
+	if( fd < 0 )
+		return is_valid();
+
+	struct stat st;
+	if( ( fstat(fd, &st) != 0 ) || ( (size_t)st.st_size < sizeof(trajectory_file_header_t) ) ) {
+		close(fd);
+		return is_valid();
+	}
+
+	//The mapping stays valid after the file is closed
+	void* addr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close(fd);
+
+	if( addr == MAP_FAILED )
+		return is_valid();
+
+	const size_t map_size = st.st_size;
+	_map = std::shared_ptr<const void>( addr, [map_size]( void* p ) { munmap(p, map_size); } );
+	_map_size = map_size;
+
+	//Check the header before trusting any offsets
+	const trajectory_file_header_t& header = *static_cast<const trajectory_file_header_t*>(addr);
+	const uint64_t n = header.num_segments;
+
+	const bool rebased = ( header.flags & TRAJECTORY_FILE_REBASED ) != 0;
+
+	//Each block is checked without adding up the (untrusted) offsets and
+	//sizes, which could overflow and wrap back into the mapping
+	bool valid_layout = ( n > 0 ) && ( n <= _map_size / sizeof(segment_t) ) &&
+						_fits_in_map( header.knots_offset, n + 1, sizeof(double) ) &&
+						_fits_in_map( header.segments_offset, n, sizeof(segment_t) );
+
+	//Safe to add up now the segments are known to be within the mapping
+	const uint64_t segments_end = valid_layout ? header.segments_offset + n*sizeof(segment_t) : 0;
+	const uint64_t origins_offset = _align_offset(segments_end);
+
+	valid_layout = valid_layout && ( !rebased || _fits_in_map( origins_offset, n*packed_channels, sizeof(double) ) );
+
+	const bool valid_header = ( memcmp(header.magic, trajectory_file_magic, sizeof(header.magic)) == 0 ) &&
+							  ( header.version >= trajectory_file_min_version ) &&
+							  ( header.version <= trajectory_file_version ) &&
+							  ( header.header_size == sizeof(trajectory_file_header_t) ) &&
+							  ( header.channels == packed_channels ) &&
+							  ( header.segment_size == sizeof(segment_t) ) &&
+							  ( ( header.flags & ~TRAJECTORY_FILE_KNOWN_FLAGS ) == 0 ) &&
+							  ( ( ( header.flags & TRAJECTORY_FILE_SINGLE_PRECISION ) != 0 ) == _single_precision() ) &&
+							  ( header.byte_order_mark == trajectory_file_byte_order_mark ) &&
+							  ( header.duration > 0.0 ) &&
+							  ( header.knots_offset >= sizeof(trajectory_file_header_t) ) &&
+							  ( header.knots_offset % sizeof(double) == 0 ) &&
+							  ( header.segments_offset % 64 == 0 ) &&
+							  valid_layout;
+
+	if( !valid_header ) {
+		_unmap();
+		return is_valid();
+	}
+
+	const char* base = static_cast<const char*>(addr);
+	_knot_data = reinterpret_cast<const double*>( base + header.knots_offset );
+	_segment_data = reinterpret_cast<const segment_t*>( base + header.segments_offset );
+	_origin_data = rebased ? reinterpret_cast<const double*>( base + origins_offset ) : NULL;
+	_num_segments = n;
+
+	//Only the ends are checked, so the rest of the file is not read in
+	if( !( ( _knot_data[0] == 0.0 ) && ( _knot_data[n] == header.duration ) ) ) {
+		_unmap();
+		return is_valid();
+	}
+
+	_duration = header.duration;
+	_inv_seg_duration = n / header.duration;
+	_is_uniform = ( header.flags & TRAJECTORY_FILE_UNIFORM_KNOTS ) != 0;
+	_is_valid = true;
+
+	return is_valid();
+}
+
+template<typename Scalar>
+size_t BasicPackedQuinticTrajectory<Scalar>::locate( const double t ) const {
+	if( _is_uniform )
+		return segment_index( clamp(t, 0.0, _duration) * _inv_seg_duration, _num_segments );
+
+	//Binary search over the interior knots
+	return std::upper_bound( _knot_data + 1, _knot_data + _num_segments, t ) - ( _knot_data + 1 );
+}
+
+template<typename Scalar>
+packed_quintic_point_t BasicPackedQuinticTrajectory<Scalar>::lookup( const double t ) const {
+	packed_quintic_point_t p;
+
+	if( !_is_valid ) {
+		memset(&p, 0, sizeof(p));
+		return p;
+	}
+
+	//Find the segment and the normalised time within it
+	const double t_c = clamp(t, 0.0, _duration);
+	const size_t seg = locate(t_c);
+	const double sd = _is_uniform ? _inv_seg_duration : 1.0 / ( _knot_data[seg+1] - _knot_data[seg] );
+	const double u = clamp( (t_c - _knot_data[seg]) * sd, 0.0, 1.0 );
+
+	//Denormalise the derivatives to per-second units
+	packed_quintic_horner( (Scalar)u, _segment_data[seg], sd, sd*sd, p );
+
+	if( _origin_data != NULL ) {
+		for(size_t c = 0; c < packed_channels; c++)
+			p.q[c] += _origin_data[seg*packed_channels + c];
+	}
+
+	return p;
+}
+
+template<typename Scalar>
+void BasicPackedQuinticTrajectory<Scalar>::lookup_uniform( const double t0, const double dt, const size_t n, packed_quintic_point_t* out ) const {
+	if( !_is_valid ) {
+		memset(out, 0, n*sizeof(packed_quintic_point_t));
+		return;
+	}
+
+	size_t i = 0;
+	while( i < n ) {
+		const double t = t0 + i*dt;
+		const size_t seg = locate( clamp(t, 0.0, _duration) );
+		const double t_end = ( (seg + 1) < _num_segments ) ? _knot_data[seg + 1] : _duration;
+
+		//Number of samples left in this segment (none if t is outside the
+		//trajectory, or if stepping backwards)
+		size_t m = 0;
+		if( ( dt > 0.0 ) && ( t >= _knot_data[seg] ) && ( t < t_end ) ) {
+			m = std::min( (double)std::min(n - i, forward_diff_resync), std::ceil( (t_end - t) / dt ) );
+
+			//Make sure the rounding agrees with the lookup() of each sample
+			while( ( m > 0 ) && ( ( t0 + (i + m - 1)*dt ) >= t_end ) )
+				m--;
+		}
+
+		if( m < forward_diff_min_run ) {
+			out[i] = lookup(t);
+			i++;
+		} else {
+			_lookup_run(seg, t, dt, m, &out[i]);
+			i += m;
+		}
+	}
+}
+
+//=======================
+// Private
+//=======================
+
+template<typename Scalar>
+void BasicPackedQuinticTrajectory<Scalar>::_unmap( void ) {
+	if( is_mapped() ) {
+		_map.reset();
+
+		_map_size = 0;
+		_segment_data = NULL;
+		_knot_data = NULL;
+		_origin_data = NULL;
+		_num_segments = 0;
+	}
+}
+
+template<typename Scalar>
+void BasicPackedQuinticTrajectory<Scalar>::_lookup_run( const size_t seg, const double t, const double dt, const size_t n, packed_quintic_point_t* out ) const {
+	const segment_t& c = _segment_data[seg];
+	const double* origin = get_origin(seg);
+
+	//Normalised start and step within the segment
+	const double sd = _is_uniform ? _inv_seg_duration : 1.0 / ( _knot_data[seg+1] - _knot_data[seg] );
+	const double u0 = (t - _knot_data[seg]) * sd;
+	const double du = dt * sd;
+
+	//Forward differences of q (degree 5), qd (4), and qdd (3) per channel
+	double dq[6][packed_channels];
+	double dqd[5][packed_channels];
+	double dqdd[4][packed_channels];
+
+	for(size_t i = 0; i < packed_channels; i++) {
+		//Shift the polynomial to start at u0 (a_k is then q^(k)(u0)/k!)
+		double a[6];
+		for(size_t k = 0; k < 6; k++)
+			a[k] = c.a[k][i];
+
+		for(size_t j = 0; j < 5; j++) {
+			for(size_t k = 5; k > j; k--)
+				a[k - 1] += u0*a[k];
+		}
+
+		//Rewrite q, qd, and qdd as polynomials in the sample index
+		double dq_x[6];
+		double dqd_x[5];
+		double dqdd_x[4];
+		double s = 1.0;
+		for(size_t k = 0; k < 6; k++) {
+			dq_x[k] = a[k]*s;
+
+			if( k < 5 )
+				dqd_x[k] = (k + 1)*a[k + 1]*s*sd;
+
+			if( k < 4 )
+				dqdd_x[k] = (k + 2)*(k + 1)*a[k + 2]*s*sd*sd;
+
+			s *= du;
+		}
+
+		if( origin != NULL )
+			dq_x[0] += origin[i];
+
+		double diff[6];
+		forward_diff_table(dq_x, 5, diff);
+		for(size_t k = 0; k < 6; k++)
+			dq[k][i] = diff[k];
+
+		forward_diff_table(dqd_x, 4, diff);
+		for(size_t k = 0; k < 5; k++)
+			dqd[k][i] = diff[k];
+
+		forward_diff_table(dqdd_x, 3, diff);
+		for(size_t k = 0; k < 4; k++)
+			dqdd[k][i] = diff[k];
+	}
+
+	packed_quintic_forward_diff(dq, dqd, dqdd, n, out);
+}
+
+template<typename Scalar>
+void BasicPackedQuinticTrajectory<Scalar>::_store( const size_t seg, const size_t c, const quintic_spline_coeffs_t& a ) {
+	segment_t& s = _segments[seg];
+
+	//The solution is in double precision, so rebase before rounding
+	if( _rebase ) {
+		_origins[seg*packed_channels + c] = a.a1;
+		s.a[0][c] = 0;
+	} else {
+		s.a[0][c] = (Scalar)a.a1;
+	}
+
+	s.a[1][c] = (Scalar)a.a2;
+	s.a[2][c] = (Scalar)a.a3;
+	s.a[3][c] = (Scalar)a.a4;
+	s.a[4][c] = (Scalar)a.a5;
+	s.a[5][c] = (Scalar)a.a6;
+}
+
+namespace contrail_spline_lib {
+
+template class BasicPackedQuinticTrajectory<double>;
+template class BasicPackedQuinticTrajectory<float>;
+
+}
@@ -0,0 +1,172 @@
+#include <contrail_spline_lib/polynomial_roots.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace contrail_spline_lib;
+
+//Evaluates c at u, rounding values that are within the rounding error of
+//the evaluation to exactly zero. A root that only touches zero (e.g. at a
+//turning point, or at the end of the interval) usually evaluates to a tiny
+//value of either sign, which would otherwise show no sign change
+static double _polynomial_eval_snapped( const double* c, const size_t degree, const double u ) {
+	const double p = polynomial_eval(c, degree, u);
+
+	double bound = std::fabs(c[degree]);
+	for(size_t i = degree; i > 0; i--)
+		bound = bound*std::fabs(u) + std::fabs(c[i-1]);
+
+	return ( std::fabs(p) <= 4.0*degree*std::numeric_limits<double>::epsilon()*bound ) ? 0.0 : p;
+}
+
+//Finds the single root of a polynomial that is monotonic over [lo, hi],
+//given the values at each end have opposite signs
+static double _polynomial_bracketed_root( const double* c,
+										  const double* dc,
+										  const size_t degree,
+										  double lo,
+										  double hi,
+										  const double p_lo,
+										  const double p_hi ) {
+	//Start from the secant (regula falsi) estimate
+	double u = lo - p_lo*(hi - lo)/(p_hi - p_lo);
+	if( !( (u > lo) && (u < hi) ) )
+		u = 0.5*(lo + hi);
+
+	for(size_t i = 0; i < 64; i++) {
+		const double p = polynomial_eval(c, degree, u);
+
+		if( p == 0.0 )
+			break;
+
+		//Keep the root bracketed
+		if( (p < 0.0) == (p_lo < 0.0) ) {
+			lo = u;
+		} else {
+			hi = u;
+		}
+
+		//Newton step, falling back to bisection if it leaves the bracket
+		const double dp = polynomial_eval(dc, degree - 1, u);
+		double un = (dp != 0.0) ? u - p / dp : lo - 1.0;
+
+		if( !( (un > lo) && (un < hi) ) )
+			un = 0.5*(lo + hi);
+
+		const bool done = ( std::fabs(un - u) <= 1e-13*(1.0 + std::fabs(u)) ) ||
+						  ( (hi - lo) <= 1e-13*(1.0 + std::fabs(u)) );
+		u = un;
+
+		if(done)
+			break;
+	}
+
+	return u;
+}
+
+size_t contrail_spline_lib::polynomial_extrema( const double* c,
+												const size_t degree,
+												const double lo,
+												const double hi,
+												double* extrema ) {
+	if( degree < 2 )
+		return 0;
+
+	double dc[polynomial_roots_max_degree];
+	for(size_t i = 1; i <= degree; i++)
+		dc[i-1] = i*c[i];
+
+	size_t num = polynomial_roots(dc, degree - 1, lo, hi, extrema);
+
+	//Only keep the turning points inside the interval
+	size_t n = 0;
+	for(size_t i = 0; i < num; i++) {
+		if( (extrema[i] > lo) && (extrema[i] < hi) )
+			extrema[n++] = extrema[i];
+	}
+
+	return n;
+}
+
+void contrail_spline_lib::polynomial_range( const double* c,
+											const size_t degree,
+											const double lo,
+											const double hi,
+											double& min,
+											double& max ) {
+	double extrema[polynomial_roots_max_degree];
+	const size_t num = polynomial_extrema(c, degree, lo, hi, extrema);
+
+	const double p_lo = polynomial_eval(c, degree, lo);
+	const double p_hi = polynomial_eval(c, degree, hi);
+	min = std::min(p_lo, p_hi);
+	max = std::max(p_lo, p_hi);
+
+	for(size_t i = 0; i < num; i++) {
+		const double p = polynomial_eval(c, degree, extrema[i]);
+		min = std::min(min, p);
+		max = std::max(max, p);
+	}
+}
+
+size_t contrail_spline_lib::polynomial_roots( const double* c,
+											  const size_t degree,
+											  const double lo,
+											  const double hi,
+											  double* roots ) {
+	//Drop any (exactly) zero leading coefficients
+	size_t d = ( degree > polynomial_roots_max_degree ) ? polynomial_roots_max_degree : degree;
+	while( (d > 0) && (c[d] == 0.0) )
+		d--;
+
+	if( d == 0 )
+		return 0;
+
+	if( d == 1 ) {
+		const double r = -c[0] / c[1];
+		if( (r >= lo) && (r <= hi) ) {
+			roots[0] = r;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	//Split the interval at the turning points, so that the polynomial is
+	//monotonic (and has at most one root) between each break point
+	double breaks[polynomial_roots_max_degree + 1];
+	breaks[0] = lo;
+	size_t num_breaks = 1 + polynomial_extrema(c, d, lo, hi, &breaks[1]);
+	breaks[num_breaks++] = hi;
+
+	double dc[polynomial_roots_max_degree];
+	for(size_t i = 1; i <= d; i++)
+		dc[i-1] = i*c[i];
+
+	size_t num = 0;
+	double p_lo = _polynomial_eval_snapped(c, d, lo);
+
+	if( p_lo == 0.0 )
+		roots[num++] = lo;
+
+	//Snapped values could (in a badly conditioned polynomial) find more
+	//roots than the degree allows, so stop at the space the caller has
+	for(size_t i = 1; ( i < num_breaks ) && ( num < d ); i++) {
+		const double a = breaks[i-1];
+		const double b = breaks[i];
+		const double p_hi = _polynomial_eval_snapped(c, d, b);
+
+		if( p_hi == 0.0 ) {
+			//Root on a break point (don't count it twice)
+			if( (num == 0) || (roots[num-1] != b) )
+				roots[num++] = b;
+		} else if( (p_lo != 0.0) && ( (p_lo < 0.0) != (p_hi < 0.0) ) ) {
+			roots[num++] = _polynomial_bracketed_root(c, dc, d, a, b, p_lo, p_hi);
+		}
+
+		p_lo = p_hi;
+	}
+
+	return num;
+}
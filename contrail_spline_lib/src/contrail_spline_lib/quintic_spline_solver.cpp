@@ -1,4 +1,5 @@
 #include <contrail_spline_lib/quintic_spline_solver.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
 
 #include <eigen3/Eigen/Dense>
 
@@ -6,30 +7,60 @@
 
 using namespace contrail_spline_lib;
 
+double QuinticSplineSolver::linear_derivative_est( const double qp,
+												   const double qc,
+												   const double qn,
+												   const double tp,
+												   const double tn ) {
+	//Hold the derivative at zero for flat sections and turning points,
+	//otherwise use the central difference
+	if( (qc == qp) ||
+		(qc == qn) ||
+		( (qc < qp) && (qc < qn) ) ||
+		( (qc > qp) && (qc > qn) ) ) {
+
+		return 0.0;
+	}
+
+	return (qn - qp)/(tn - tp);
+}
+
+void QuinticSplineSolver::linear_derivative_est( const double* vias,
+												 const double* t,
+												 const size_t num_vias,
+												 double* dvias ) {
+	if( num_vias < 1 )
+		return;
+
+	dvias[0] = 0.0;
+	dvias[num_vias-1] = 0.0;
+
+	for(size_t i=1; (i + 1) < num_vias; i++) {
+		dvias[i] = linear_derivative_est( vias[i-1], vias[i], vias[i+1], t[i-1], t[i+1] );
+	}
+}
+
 Eigen::VectorXd QuinticSplineSolver::linear_derivative_est( const Eigen::VectorXd& vias, const double dt ) {
 	Eigen::VectorXd dvias = Eigen::VectorXd::Zero(vias.size());
 
 	if( vias.size() > 2 ) {
 		for(int i=1; i < (vias.size()-1); i++) {
-			double qp = vias(i-1);
-            double qc = vias(i);
-            double qn = vias(i+1);
-
-            if( (qc == qp) ||
-				(qc == qn) ||
-				( (qc < qp) && (qc < qn) ) ||
-				( (qc > qp) && (qc > qn) ) ) {
-
-                dvias(i) = 0;
-            } else {
-                dvias(i) = (qn - qp)/(2*dt);
-            }
+			dvias(i) = linear_derivative_est( vias(i-1), vias(i), vias(i+1), 0.0, 2*dt );
 		}
 	}
 
 	return dvias;
 }
 
+Eigen::VectorXd QuinticSplineSolver::linear_derivative_est( const Eigen::VectorXd& vias, const Eigen::VectorXd& t ) {
+	Eigen::VectorXd dvias = Eigen::VectorXd::Zero(vias.size());
+
+	if( t.size() == vias.size() )
+		linear_derivative_est( vias.data(), t.data(), vias.size(), dvias.data() );
+
+	return dvias;
+}
+
 quintic_spline_coeffs_t QuinticSplineSolver::solver( const double q0,
 													 const double qd0,
 													 const double qdd0,
@@ -69,41 +100,268 @@ quintic_spline_coeffs_t QuinticSplineSolver::solver( const double q0,
 	//       0,  0,    2,   6*tf, 12*tf^2, 20*tf^3];
 
 
-	// Simultaneous Polynomial Equations
-	Eigen::Matrix<double,6,6> M;
-	M << 1, 0, 0, 0,  0,  0,
-		 0, 1, 0, 0,  0,  0,
-		 0, 0, 2, 0,  0,  0,
-		 1, 1, 1, 1,  1,  1,
-		 0, 1, 2, 3,  4,  5,
-		 0, 0, 2, 6, 12, 20;
-
-	// Coefficient Solver
-    Eigen::Matrix<double,6,1> b;
-	b << q0, qd0, qdd0, qf, qdf, qddf;
-    Eigen::Matrix<double,6,1> a = M.fullPivLu().solve(b);
-
-	quintic_spline_coeffs_t a_s;
-
-	a_s.a1 = a(0);
-	a_s.a2 = a(1);
-	a_s.a3 = a(2);
-	a_s.a4 = a(3);
-	a_s.a5 = a(4);
-	a_s.a6 = a(5);
-
-	return a_s;
+	//
+	// As the time is normalised, M is constant, and the system is solved
+	// with its closed-form inverse (see quintic_solve()):
+	// inv(M) = [   1,  0,    0,   0,  0,    0;
+	//              0,  1,    0,   0,  0,    0;
+	//              0,  0,  1/2,   0,  0,    0;
+	//            -10, -6, -3/2,  10, -4,  1/2;
+	//             15,  8,  3/2, -15,  7,   -1;
+	//             -6, -3, -1/2,   6, -3,  1/2];
+
+	return quintic_solve(q0, qd0, qdd0, qf, qdf, qddf);
 }
 
-quintic_spline_point_t QuinticSplineSolver::lookup(const double u, const quintic_spline_coeffs_t& c) {
-	quintic_spline_point_t p;
+void QuinticSplineSolver::solver_batch( const double* q,
+										const double* qd,
+										const double* qdd,
+										const size_t num_vias,
+										quintic_spline_coeffs_t* coeffs ) {
+	solver_batch(q, qd, qdd, NULL, num_vias, coeffs);
+}
+
+void QuinticSplineSolver::solver_batch( const double* q,
+										const double* qd,
+										const double* qdd,
+										const double* t,
+										const size_t num_vias,
+										quintic_spline_coeffs_t* coeffs ) {
+	// Solves every segment of a via list in a single pass
+	//
+	// The boundary data is given as structure-of-arrays, with segment i
+	// connecting vias i and i+1, so the start and end constraints for a
+	// block of segments are just two offset loads of the same arrays.
+	//
+	// If knot times are given, the derivatives are normalised by each
+	// segment's duration (qd*dt; qdd*dt^2) before solving.
+	if(num_vias < 2)
+		return;
+
+	const size_t num_seg = num_vias - 1;
+	size_t i = 0;
+
+#if CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 4
+	for(; (i + 4) <= num_seg; i += 4) {
+		__m256d qd0 = _mm256_loadu_pd(&qd[i]);
+		__m256d qdd0 = _mm256_loadu_pd(&qdd[i]);
+		__m256d qdf = _mm256_loadu_pd(&qd[i+1]);
+		__m256d qddf = _mm256_loadu_pd(&qdd[i+1]);
+
+		if(t) {
+			const __m256d dt = _mm256_sub_pd( _mm256_loadu_pd(&t[i+1]), _mm256_loadu_pd(&t[i]) );
+			const __m256d dt2 = _mm256_mul_pd(dt, dt);
+			qd0 = _mm256_mul_pd(qd0, dt);
+			qdf = _mm256_mul_pd(qdf, dt);
+			qdd0 = _mm256_mul_pd(qdd0, dt2);
+			qddf = _mm256_mul_pd(qddf, dt2);
+		}
+
+		__m256d a1, a2, a3, a4, a5, a6;
+		quintic_solve_x4( _mm256_loadu_pd(&q[i]), qd0, qdd0,
+						  _mm256_loadu_pd(&q[i+1]), qdf, qddf,
+						  a1, a2, a3, a4, a5, a6 );
+
+		double r[6][4];
+		_mm256_storeu_pd(r[0], a1);
+		_mm256_storeu_pd(r[1], a2);
+		_mm256_storeu_pd(r[2], a3);
+		_mm256_storeu_pd(r[3], a4);
+		_mm256_storeu_pd(r[4], a5);
+		_mm256_storeu_pd(r[5], a6);
+
+		for(size_t j = 0; j < 4; j++) {
+			quintic_spline_coeffs_t& c = coeffs[i + j];
+			c.a1 = r[0][j];
+			c.a2 = r[1][j];
+			c.a3 = r[2][j];
+			c.a4 = r[3][j];
+			c.a5 = r[4][j];
+			c.a6 = r[5][j];
+		}
+	}
+#elif CONTRAIL_SPLINE_LIB_SIMD_WIDTH == 2
+	for(; (i + 2) <= num_seg; i += 2) {
+		__m128d qd0 = _mm_loadu_pd(&qd[i]);
+		__m128d qdd0 = _mm_loadu_pd(&qdd[i]);
+		__m128d qdf = _mm_loadu_pd(&qd[i+1]);
+		__m128d qddf = _mm_loadu_pd(&qdd[i+1]);
+
+		if(t) {
+			const __m128d dt = _mm_sub_pd( _mm_loadu_pd(&t[i+1]), _mm_loadu_pd(&t[i]) );
+			const __m128d dt2 = _mm_mul_pd(dt, dt);
+			qd0 = _mm_mul_pd(qd0, dt);
+			qdf = _mm_mul_pd(qdf, dt);
+			qdd0 = _mm_mul_pd(qdd0, dt2);
+			qddf = _mm_mul_pd(qddf, dt2);
+		}
 
-	p.q =     c.a1 +     c.a2*u +    c.a3*pow(u,2) +    c.a4*pow(u,3) +   c.a5*pow(u,4) + c.a6*pow(u,5);
-	p.qd =    c.a2 +   2*c.a3*u +  3*c.a4*pow(u,2) +  4*c.a5*pow(u,3) + 5*c.a6*pow(u,4);
-	p.qdd = 2*c.a3 +   6*c.a4*u + 12*c.a5*pow(u,2) + 20*c.a6*pow(u,3);
+		__m128d a1, a2, a3, a4, a5, a6;
+		quintic_solve_x2( _mm_loadu_pd(&q[i]), qd0, qdd0,
+						  _mm_loadu_pd(&q[i+1]), qdf, qddf,
+						  a1, a2, a3, a4, a5, a6 );
+
+		double r[6][2];
+		_mm_storeu_pd(r[0], a1);
+		_mm_storeu_pd(r[1], a2);
+		_mm_storeu_pd(r[2], a3);
+		_mm_storeu_pd(r[3], a4);
+		_mm_storeu_pd(r[4], a5);
+		_mm_storeu_pd(r[5], a6);
+
+		for(size_t j = 0; j < 2; j++) {
+			quintic_spline_coeffs_t& c = coeffs[i + j];
+			c.a1 = r[0][j];
+			c.a2 = r[1][j];
+			c.a3 = r[2][j];
+			c.a4 = r[3][j];
+			c.a5 = r[4][j];
+			c.a6 = r[5][j];
+		}
+	}
+#endif
+
+	//Scalar fallback and remainder
+	for(; i < num_seg; i++) {
+		const double dt = t ? (t[i+1] - t[i]) : 1.0;
+		const double dt2 = dt*dt;
+
+		coeffs[i] = quintic_solve( q[i], qd[i]*dt, qdd[i]*dt2,
+								   q[i+1], qd[i+1]*dt, qdd[i+1]*dt2 );
+	}
+}
+
+void QuinticSplineSolver::min_jerk_derivatives( const double* q,
+												const double* t,
+												const size_t num_vias,
+												double* qd,
+												double* qdd,
+												double* work ) {
+	// Solves for the velocity and acceleration at each interior via so that
+	// the jerk and snap are also continuous. The resulting quintic spline is
+	// the one that minimises the integral of the squared jerk.
+	//
+	// For a normalised segment with D = qf - q0, V = qd*h, A = qdd*h^2, the
+	// (normalised) jerk and snap at each end are (from quintic_solve()):
+	//		J0 =   60D -  36V0 -  24Vf -  9A0 +  3Af
+	//		Jf =   60D -  24V0 -  36Vf -  3A0 +  9Af
+	//		S0 = -360D + 192V0 + 168Vf + 36A0 - 24Af
+	//		Sf =  360D - 168V0 - 192Vf - 24A0 + 36Af
+	//
+	// Matching Jf/hl^3 = J0/hr^3 and Sf/hl^4 = S0/hr^4 at each interior via
+	// (hl/hr being the durations of the segments either side) gives a
+	// block-tridiagonal system in x_i = [qd_i; qdd_i]:
+	//		L_i*x_(i-1) + D_i*x_i + U_i*x_(i+1) = r_i
+	// which is solved in O(n) with the block Thomas algorithm.
+	//
+	// The time is rescaled so the mean segment duration is 1, to keep the
+	// system well scaled regardless of the units of t.
+	if( num_vias < 3 )
+		return;
+
+	const size_t last = num_vias - 1;
+	const double ts = last / (t[last] - t[0]);	//Time scaling
+	const double ts2 = ts*ts;
+
+	//Work space: C_i = inv(D'_i)*U_i (4 values), y_i = inv(D'_i)*r'_i (2 values)
+	double* C = work;
+	double* y = work + 4*num_vias;
+
+	//Known end conditions, in scaled time
+	const double v0 = qd[0] / ts;
+	const double a0 = qdd[0] / ts2;
+	const double vf = qd[last] / ts;
+	const double af = qdd[last] / ts2;
+
+	for(size_t i = 1; i < last; i++) {
+		const double hl = (t[i] - t[i-1]) * ts;
+		const double hr = (t[i+1] - t[i]) * ts;
+		const double ihl = 1.0 / hl;
+		const double ihr = 1.0 / hr;
+		const double ihl2 = ihl*ihl;
+		const double ihr2 = ihr*ihr;
+		const double ihl3 = ihl2*ihl;
+		const double ihr3 = ihr2*ihr;
+		const double dl = q[i] - q[i-1];
+		const double dr = q[i+1] - q[i];
+
+		//Row 0 is jerk continuity, row 1 is snap continuity
+		const double L[4] = { -24.0*ihl2, -3.0*ihl,
+							  -168.0*ihl3, -24.0*ihl2 };
+		double D[4] = { 36.0*(ihr2 - ihl2), 9.0*(ihl + ihr),
+						-192.0*(ihl3 + ihr3), 36.0*(ihl2 - ihr2) };
+		const double U[4] = { 24.0*ihr2, -3.0*ihr,
+							  -168.0*ihr3, 24.0*ihr2 };
+		double r[2] = { 60.0*(dr*ihr3 - dl*ihl3),
+						-360.0*(dl*ihl3*ihl + dr*ihr3*ihr) };
+
+		if( i == 1 ) {
+			//Move the known start conditions to the right hand side
+			r[0] -= L[0]*v0 + L[1]*a0;
+			r[1] -= L[2]*v0 + L[3]*a0;
+		} else {
+			//Eliminate the previous row: D' = D - L*C_(i-1); r' = r - L*y_(i-1)
+			const double* Cp = &C[4*(i-1)];
+			const double* yp = &y[2*(i-1)];
+
+			D[0] -= L[0]*Cp[0] + L[1]*Cp[2];
+			D[1] -= L[0]*Cp[1] + L[1]*Cp[3];
+			D[2] -= L[2]*Cp[0] + L[3]*Cp[2];
+			D[3] -= L[2]*Cp[1] + L[3]*Cp[3];
+			r[0] -= L[0]*yp[0] + L[1]*yp[1];
+			r[1] -= L[2]*yp[0] + L[3]*yp[1];
+		}
+
+		if( (i + 1) == last ) {
+			//Move the known end conditions to the right hand side
+			r[0] -= U[0]*vf + U[1]*af;
+			r[1] -= U[2]*vf + U[3]*af;
+		}
+
+		//inv(D') for the 2x2 block
+		const double idet = 1.0 / (D[0]*D[3] - D[1]*D[2]);
+		const double Di[4] = { D[3]*idet, -D[1]*idet,
+							   -D[2]*idet, D[0]*idet };
+
+		double* Ci = &C[4*i];
+		double* yi = &y[2*i];
+		Ci[0] = Di[0]*U[0] + Di[1]*U[2];
+		Ci[1] = Di[0]*U[1] + Di[1]*U[3];
+		Ci[2] = Di[2]*U[0] + Di[3]*U[2];
+		Ci[3] = Di[2]*U[1] + Di[3]*U[3];
+		yi[0] = Di[0]*r[0] + Di[1]*r[1];
+		yi[1] = Di[2]*r[0] + Di[3]*r[1];
+	}
+
+	//Back substitution: x_i = y_i - C_i*x_(i+1), with the last interior
+	//via having no coupling to the (known) end via
+	double vn = 0.0;
+	double an = 0.0;
+	for(size_t i = last - 1; i > 0; i--) {
+		const double* Ci = &C[4*i];
+		const double* yi = &y[2*i];
+		double v = yi[0];
+		double a = yi[1];
+
+		if( (i + 1) < last ) {
+			v -= Ci[0]*vn + Ci[1]*an;
+			a -= Ci[2]*vn + Ci[3]*an;
+		}
+
+		qd[i] = v * ts;
+		qdd[i] = a * ts2;
+		vn = v;
+		an = a;
+	}
+}
+
+quintic_spline_point_t QuinticSplineSolver::lookup(const double u, const quintic_spline_coeffs_t& c) const {
+	//q =     a1 +     a2*u +    a3*u^2 +    a4*u^3 +   a5*u^4 + a6*u^5;
+	//qd =    a2 +   2*a3*u +  3*a4*u^2 +  4*a5*u^3 + 5*a6*u^4;
+	//qdd = 2*a3 +   6*a4*u + 12*a5*u^2 + 20*a6*u^3;
 	//qddd =   6*a(4).*c +  24*a(5).*t + 60*a(6).*t.^2;
 	//qdddd = 24*a(5).*c + 120*a(6).*t;
+	//Evaluated in Horner form (see quintic_spline_kernels.h)
 
-	return p;
+	return quintic_horner(u, c);
 }
-
@@ -0,0 +1,158 @@
+#include <contrail_spline_lib/streaming_quintic_spline.h>
+#include <contrail_spline_lib/quintic_spline_solver.h>
+#include <contrail_spline_lib/quintic_spline_kernels.h>
+
+#include <algorithm>
+
+using namespace contrail_spline_lib;
+
+template<class T>
+constexpr static const T& clamp(const T& i, const T& min, const T& max) {
+	return (i < min) ? min : ( (i > max) ? max : i );
+}
+
+StreamingQuinticSpline::StreamingQuinticSpline( const size_t capacity ) :
+	_capacity( std::max(capacity, (size_t)2) ),
+	_head(0),
+	_size(0) {
+
+	//All storage is allocated up front, nothing is allocated while streaming
+	_q.resize(_capacity);
+	_qd.resize(_capacity);
+	_qdd.resize(_capacity);
+	_t.resize(_capacity);
+	_coeffs.resize(_capacity);
+}
+
+StreamingQuinticSpline::~StreamingQuinticSpline( void ) {
+}
+
+bool StreamingQuinticSpline::append( const double q, const double t ) {
+	if( is_full() || ( ( _size > 0 ) && !( t > get_end_time() ) ) )
+		return false;
+
+	const size_t s = _slot(_size);
+	_q[s] = q;
+	_t[s] = t;
+	_qd[s] = 0.0;
+	_qdd[s] = 0.0;
+	_size++;
+
+	//Only the estimates next to the new tail (n) change:
+	//	qd(n-1) now has a neighbour on both sides
+	//	qdd(n-1) and qdd(n-2) depend on qd(n-1)
+	//The head via is never re-estimated, so it keeps its derivatives
+	const size_t n = _size - 1;
+
+	if( n >= 2 ) {
+		_estimate_qd(n - 1);
+		_estimate_qdd(n - 1);
+	}
+
+	if( n >= 3 )
+		_estimate_qdd(n - 2);
+
+	//...which affects the (up to) 3 segments that touch those vias
+	for(size_t i = (n >= 3) ? n - 3 : 0; i < n; i++)
+		_solve(i);
+
+	return true;
+}
+
+bool StreamingQuinticSpline::retire( void ) {
+	if( _size < 2 )
+		return false;
+
+	_head = _slot(1);
+	_size--;
+
+	return true;
+}
+
+size_t StreamingQuinticSpline::retire_before( const double t ) {
+	size_t num = 0;
+
+	while( ( _size >= 2 ) && ( _t[_slot(1)] <= t ) ) {
+		retire();
+		num++;
+	}
+
+	return num;
+}
+
+void StreamingQuinticSpline::clear( void ) {
+	_head = 0;
+	_size = 0;
+}
+
+quintic_spline_point_t StreamingQuinticSpline::lookup( const double t ) const {
+	quintic_spline_point_t point = {0.0, 0.0, 0.0};
+
+	if( _size == 1 ) {
+		point.q = _q[_head];
+	} else if( _size >= 2 ) {
+		const size_t i = _locate(t);
+		const size_t s0 = _slot(i);
+		const size_t s1 = _slot(i + 1);
+
+		const double inv_h = 1.0 / (_t[s1] - _t[s0]);
+		const double u = clamp( (t - _t[s0]) * inv_h, 0.0, 1.0 );
+
+		point = quintic_horner(u, _coeffs[s0]);
+		point.qd *= inv_h;
+		point.qdd *= inv_h*inv_h;
+	}
+
+	return point;
+}
+
+//=======================
+// Private
+//=======================
+
+void StreamingQuinticSpline::_estimate_qd( const size_t i ) {
+	const size_t sp = _slot(i - 1);
+	const size_t sc = _slot(i);
+	const size_t sn = _slot(i + 1);
+
+	_qd[sc] = _solver.linear_derivative_est( _q[sp], _q[sc], _q[sn], _t[sp], _t[sn] );
+}
+
+void StreamingQuinticSpline::_estimate_qdd( const size_t i ) {
+	const size_t sp = _slot(i - 1);
+	const size_t sc = _slot(i);
+	const size_t sn = _slot(i + 1);
+
+	_qdd[sc] = _solver.linear_derivative_est( _qd[sp], _qd[sc], _qd[sn], _t[sp], _t[sn] );
+}
+
+void StreamingQuinticSpline::_solve( const size_t i ) {
+	const size_t s0 = _slot(i);
+	const size_t s1 = _slot(i + 1);
+
+	//Normalise the derivatives by the segment duration
+	const double dt = _t[s1] - _t[s0];
+	const double dt2 = dt*dt;
+
+	_coeffs[s0] = _solver.solver( _q[s0], _qd[s0]*dt, _qdd[s0]*dt2,
+								  _q[s1], _qd[s1]*dt, _qdd[s1]*dt2 );
+}
+
+//Returns the (logical) index of the segment containing t
+//Binary search over the interior knots, so O(log n) in the window size
+size_t StreamingQuinticSpline::_locate( const double t ) const {
+	size_t lo = 1;
+	size_t hi = _size - 1;
+
+	while( lo < hi ) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if( _t[_slot(mid)] > t ) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo - 1;
+}
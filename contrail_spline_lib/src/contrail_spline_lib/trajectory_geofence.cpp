@@ -0,0 +1,268 @@
+#include <contrail_spline_lib/trajectory_geofence.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/polynomial_roots.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace contrail_spline_lib;
+
+//C(i,j)/C(5,j), which converts the power basis coefficients a_j of a
+//quintic on [0, 1] to its Bernstein control points b_i = sum(w_ij*a_j)
+static const double bernstein_weights[6][6] = { {1.0, 0.0, 0.0, 0.0, 0.0, 0.0},
+												 {1.0, 0.2, 0.0, 0.0, 0.0, 0.0},
+												 {1.0, 0.4, 0.1, 0.0, 0.0, 0.0},
+												 {1.0, 0.6, 0.3, 0.1, 0.0, 0.0},
+												 {1.0, 0.8, 0.6, 0.4, 0.2, 0.0},
+												 {1.0, 1.0, 1.0, 1.0, 1.0, 1.0} };
+
+//Path of segment i, one polynomial per axis, in absolute positions
+template<typename Scalar>
+static void _segment_axes( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const size_t i, double (&p)[3][6] ) {
+	const basic_packed_quintic_segment_t<Scalar>& s = trajectory.get_segment(i);
+	const double* origin = trajectory.get_origin(i);
+
+	for(size_t c = 0; c < 3; c++) {
+		for(size_t k = 0; k < 6; k++)
+			p[c][k] = s.a[k][c];
+
+		if( origin != NULL )
+			p[c][0] += origin[c];
+	}
+}
+
+//Box around the Bernstein control points, which holds the whole segment
+static aabb_t _control_bounds( const double (&p)[3][6] ) {
+	aabb_t box;
+
+	for(size_t c = 0; c < 3; c++) {
+		box.lo[c] = p[c][0];
+		box.hi[c] = p[c][0];
+
+		for(size_t i = 1; i < 6; i++) {
+			double b = 0.0;
+			for(size_t j = 0; j <= i; j++)
+				b += bernstein_weights[i][j]*p[c][j];
+
+			box.lo[c] = std::min(box.lo[c], b);
+			box.hi[c] = std::max(box.hi[c], b);
+		}
+	}
+
+	return box;
+}
+
+static aabb_t _exact_bounds( const double (&p)[3][6] ) {
+	aabb_t box;
+
+	for(size_t c = 0; c < 3; c++)
+		polynomial_range(p[c], 5, 0.0, 1.0, box.lo[c], box.hi[c]);
+
+	return box;
+}
+
+static bool _box_inside( const aabb_t& box, const aabb_t& bounds ) {
+	bool inside = true;
+
+	for(size_t c = 0; c < 3; c++)
+		inside &= ( box.lo[c] >= bounds.lo[c] ) && ( box.hi[c] <= bounds.hi[c] );
+
+	return inside;
+}
+
+//Overlap with the inside of a box (touching its faces is not an overlap)
+static bool _box_overlaps( const aabb_t& box, const aabb_t& other ) {
+	bool overlaps = true;
+
+	for(size_t c = 0; c < 3; c++)
+		overlaps &= ( box.lo[c] < other.hi[c] ) && ( box.hi[c] > other.lo[c] );
+
+	return overlaps;
+}
+
+//Largest value of normal.x - offset over a box
+static double _box_support( const aabb_t& box, const half_space_t& h ) {
+	double s = -h.offset;
+
+	for(size_t c = 0; c < 3; c++)
+		s += h.normal[c]*( ( h.normal[c] > 0.0 ) ? box.hi[c] : box.lo[c] );
+
+	return s;
+}
+
+//Earliest u in [0, 1] after which g (degree 5) is positive, or -1.0 if it
+//never is (g is allowed to touch zero). The sign of g only changes at its
+//roots, so it is checked once between each pair of roots
+static double _first_positive( const double* g ) {
+	double roots[5];
+	const size_t num = polynomial_roots(g, 5, 0.0, 1.0, roots);
+
+	double a = 0.0;
+	for(size_t i = 0; i <= num; i++) {
+		const double b = ( i < num ) ? roots[i] : 1.0;
+
+		if( ( b > a ) && ( polynomial_eval(g, 5, 0.5*(a + b)) > 0.0 ) )
+			return a;
+
+		a = std::max(a, b);
+	}
+
+	return -1.0;
+}
+
+//Earliest u in [0, 1] where the path enters the inside of a box, or -1.0
+//if it never does. Each axis only enters or leaves the box at the roots of
+//p - lo and p - hi, so it is checked once between each pair of those
+static double _first_inside( const double (&p)[3][6], const aabb_t& box ) {
+	double breaks[3*2*5 + 2];
+	size_t num = 0;
+
+	breaks[num++] = 0.0;
+	for(size_t c = 0; c < 3; c++) {
+		double g[6];
+		std::copy(p[c], p[c] + 6, g);
+
+		g[0] = p[c][0] - box.lo[c];
+		num += polynomial_roots(g, 5, 0.0, 1.0, &breaks[num]);
+
+		g[0] = p[c][0] - box.hi[c];
+		num += polynomial_roots(g, 5, 0.0, 1.0, &breaks[num]);
+	}
+	breaks[num++] = 1.0;
+
+	std::sort(breaks, breaks + num);
+
+	for(size_t i = 1; i < num; i++) {
+		if( !( breaks[i] > breaks[i-1] ) )
+			continue;
+
+		const double u = 0.5*(breaks[i-1] + breaks[i]);
+		bool inside = true;
+		for(size_t c = 0; c < 3; c++) {
+			const double x = polynomial_eval(p[c], 5, u);
+			inside &= ( x > box.lo[c] ) && ( x < box.hi[c] );
+		}
+
+		if( inside )
+			return breaks[i-1];
+	}
+
+	return -1.0;
+}
+
+//Keeps the earliest violation found within a segment
+static void _record_violation( const double u, const geofence_violation_t violation, const size_t constraint,
+							   double& u_first, geofence_result_t& result ) {
+	if( ( u >= 0.0 ) && ( u < u_first ) ) {
+		u_first = u;
+		result.violation = violation;
+		result.constraint = constraint;
+	}
+}
+
+template<typename Scalar>
+aabb_t contrail_spline_lib::segment_bounds( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const size_t i ) {
+	double p[3][6];
+	_segment_axes(trajectory, i, p);
+
+	return _exact_bounds(p);
+}
+
+template<typename Scalar>
+geofence_result_t contrail_spline_lib::trajectory_geofence_check( const BasicPackedQuinticTrajectory<Scalar>& trajectory,
+																  const geofence_t& geofence ) {
+	geofence_result_t result = {GEOFENCE_CLEAR, 0, 0, 0.0};
+
+	if( !trajectory.is_valid() )
+		return result;
+
+	const double* knots = trajectory.get_knots();
+
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		double p[3][6];
+		_segment_axes(trajectory, i, p);
+
+		const aabb_t broad = _control_bounds(p);
+		aabb_t exact;
+		bool has_exact = false;
+
+		double u_first = 2.0;
+
+		//The arena is 6 axis-aligned half spaces
+		if( geofence.has_arena && !_box_inside(broad, geofence.arena) ) {
+			exact = _exact_bounds(p);
+			has_exact = true;
+
+			if( !_box_inside(exact, geofence.arena) ) {
+				for(size_t c = 0; c < 3; c++) {
+					double g[6];
+
+					for(size_t k = 0; k < 6; k++)
+						g[k] = p[c][k];
+					g[0] -= geofence.arena.hi[c];
+					_record_violation(_first_positive(g), GEOFENCE_ARENA, 0, u_first, result);
+
+					for(size_t k = 0; k < 6; k++)
+						g[k] = -p[c][k];
+					g[0] += geofence.arena.lo[c];
+					_record_violation(_first_positive(g), GEOFENCE_ARENA, 0, u_first, result);
+				}
+			}
+		}
+
+		for(size_t j = 0; j < geofence.half_spaces.size(); j++) {
+			const half_space_t& h = geofence.half_spaces[j];
+
+			if( _box_support(broad, h) <= 0.0 )
+				continue;
+
+			if( !has_exact ) {
+				exact = _exact_bounds(p);
+				has_exact = true;
+			}
+
+			if( _box_support(exact, h) <= 0.0 )
+				continue;
+
+			//normal.p(u) - offset
+			double g[6];
+			for(size_t k = 0; k < 6; k++)
+				g[k] = h.normal[0]*p[0][k] + h.normal[1]*p[1][k] + h.normal[2]*p[2][k];
+			g[0] -= h.offset;
+
+			_record_violation(_first_positive(g), GEOFENCE_HALF_SPACE, j, u_first, result);
+		}
+
+		for(size_t j = 0; j < geofence.keep_out.size(); j++) {
+			const aabb_t& box = geofence.keep_out[j];
+
+			if( !_box_overlaps(broad, box) )
+				continue;
+
+			if( !has_exact ) {
+				exact = _exact_bounds(p);
+				has_exact = true;
+			}
+
+			if( !_box_overlaps(exact, box) )
+				continue;
+
+			_record_violation(_first_inside(p, box), GEOFENCE_KEEP_OUT, j, u_first, result);
+		}
+
+		if( result.violation != GEOFENCE_CLEAR ) {
+			result.segment = i;
+			result.t = knots[i] + u_first*( knots[i+1] - knots[i] );
+			break;
+		}
+	}
+
+	return result;
+}
+
+template aabb_t contrail_spline_lib::segment_bounds( const BasicPackedQuinticTrajectory<double>& trajectory, const size_t i );
+template aabb_t contrail_spline_lib::segment_bounds( const BasicPackedQuinticTrajectory<float>& trajectory, const size_t i );
+template geofence_result_t contrail_spline_lib::trajectory_geofence_check( const BasicPackedQuinticTrajectory<double>& trajectory,
+																			const geofence_t& geofence );
+template geofence_result_t contrail_spline_lib::trajectory_geofence_check( const BasicPackedQuinticTrajectory<float>& trajectory,
+																			const geofence_t& geofence );
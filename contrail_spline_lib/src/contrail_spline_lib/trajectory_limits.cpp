@@ -0,0 +1,422 @@
+#include <contrail_spline_lib/trajectory_limits.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+#include <contrail_spline_lib/polynomial_roots.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace contrail_spline_lib;
+
+//Sum of the squares of the first 3 (x, y, z) channels of a packed polynomial at u
+template<size_t N>
+static double _packed_norm2( const double (&p)[N][packed_channels], const double u ) {
+	double n = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		double v = p[N-1][c];
+		for(size_t k = N-1; k > 0; k--)
+			v = v*u + p[k-1][c];
+
+		n += v*v;
+	}
+
+	return n;
+}
+
+//Peak of sum(p_c^2) over u in [0, 1], given dn = sum(p_c*dp_c) (degree nd)
+template<size_t N>
+static double _packed_peak_norm2( const double (&p)[N][packed_channels], const double* dn, const size_t nd ) {
+	double roots[polynomial_roots_max_degree];
+	const size_t num = polynomial_roots(dn, nd, 0.0, 1.0, roots);
+
+	double peak = std::max( _packed_norm2(p, 0.0), _packed_norm2(p, 1.0) );
+	for(size_t i = 0; i < num; i++)
+		peak = std::max( peak, _packed_norm2(p, roots[i]) );
+
+	return peak;
+}
+
+//Coefficients of the velocity and acceleration, from a2.. and a3..
+static const double _velocity_weights[5] = {1.0, 2.0, 3.0, 4.0, 5.0};
+static const double _acceleration_weights[4] = {2.0, 6.0, 12.0, 20.0};
+
+//Reciprocals of the binomial coefficients, 1/C(n, k)
+static const double _inv_binomial_4[5] = {1.0, 1.0/4, 1.0/6, 1.0/4, 1.0};
+static const double _inv_binomial_6[7] = {1.0, 1.0/6, 1.0/15, 1.0/20, 1.0/15, 1.0/6, 1.0};
+static const double _inv_binomial_8[9] = {1.0, 1.0/8, 1.0/28, 1.0/56, 1.0/70, 1.0/56, 1.0/28, 1.0/8, 1.0};
+
+//Halvings of a segment tried before finding its turning points
+static const size_t bound_max_depth = 4;
+
+//Raises "peak" towards the maximum of a polynomial over [0, 1], from its
+//Bernstein coefficients (degree N), by halving it (de Casteljau) wherever
+//the coefficients are still over the peak. The ends of each half are exact
+//values, so they raise the peak as they are found. Returns false if it may
+//still be over the peak after "depth" halvings (so its turning points must
+//be found)
+template<size_t N>
+static bool _bernstein_refine_peak( const double* b, const size_t depth, double& peak ) {
+	peak = std::max( peak, std::max(b[0], b[N]) );
+
+	double max = b[0];
+	for(size_t k = 1; k <= N; k++)
+		max = std::max(max, b[k]);
+
+	if( max <= peak )
+		return true;
+
+	if( depth == 0 )
+		return false;
+
+	double t[N+1];
+	double l[N+1];
+	double r[N+1];
+	std::copy(b, b + N + 1, t);
+
+	l[0] = t[0];
+	r[N] = t[N];
+	for(size_t j = 1; j <= N; j++) {
+		for(size_t k = 0; k + j <= N; k++)
+			t[k] = 0.5*(t[k] + t[k+1]);
+
+		l[j] = t[0];
+		r[N-j] = t[N-j];
+	}
+
+	return _bernstein_refine_peak<N>(l, depth - 1, peak) &&
+		   _bernstein_refine_peak<N>(r, depth - 1, peak);
+}
+
+//Segments bounded at once, one per lane (the bounds are plain arithmetic
+//over the lanes, so they are vectorised across the segments)
+static const size_t bound_lanes = 8;
+
+//Converts the coefficients of a polynomial (degree N, ascending powers) in
+//each lane into Bernstein coefficients in place, with inv_binomial holding 1/C(N, k).
+//A polynomial lies within the range of these over u in [0, 1], and the first
+//and last are its values at each end
+template<size_t N>
+static inline void _bernstein( double (&c)[N+1][bound_lanes], const double* inv_binomial ) {
+	for(size_t k = 1; k < N; k++) {
+		for(size_t l = 0; l < bound_lanes; l++)
+			c[k][l] *= inv_binomial[k];
+	}
+
+	for(size_t r = 1; r <= N; r++) {
+		for(size_t k = N; k >= r; k--) {
+			for(size_t l = 0; l < bound_lanes; l++)
+				c[k][l] += c[k-1][l];
+		}
+	}
+}
+
+//Largest Bernstein coefficient in each lane
+template<size_t N>
+static inline void _bernstein_max( const double (&b)[N+1][bound_lanes], double* max ) {
+	for(size_t l = 0; l < bound_lanes; l++)
+		max[l] = b[0][l];
+
+	for(size_t k = 1; k <= N; k++) {
+		for(size_t l = 0; l < bound_lanes; l++)
+			max[l] = std::max(max[l], b[k][l]);
+	}
+}
+
+//Refines one lane (see below) if its bound is over the peak
+template<size_t N>
+static inline bool _bernstein_refine_lane( const double (&b)[N+1][bound_lanes], const double max,
+										   const size_t l, double& peak ) {
+	if( max <= peak )
+		return true;
+
+	double bl[N+1];
+	for(size_t k = 0; k <= N; k++)
+		bl[k] = b[k][l];
+
+	return _bernstein_refine_peak<N>(bl, bound_max_depth, peak);
+}
+
+//Exact values at the start and middle of a segment (squared for the velocity
+//and acceleration), which are lower bounds on the peaks
+template<typename Scalar>
+static kinematic_peaks_t _segment_samples( const basic_packed_quintic_segment_t<Scalar>& s, const double inv_h ) {
+	double v0[packed_channels];
+	double vm[packed_channels];
+	double a0[packed_channels];
+	double am[packed_channels];
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		v0[c] = s.a[1][c];
+		a0[c] = 2.0*s.a[2][c];
+		vm[c] = s.a[1][c] + s.a[2][c] + 0.75*s.a[3][c] + 0.5*s.a[4][c] + 0.3125*s.a[5][c];
+		am[c] = 2.0*s.a[2][c] + 3.0*s.a[3][c] + 3.0*s.a[4][c] + 2.5*s.a[5][c];
+	}
+
+	double v0n = 0.0;
+	double vmn = 0.0;
+	double a0n = 0.0;
+	double amn = 0.0;
+	for(size_t c = 0; c < 3; c++) {
+		v0n += v0[c]*v0[c];
+		vmn += vm[c]*vm[c];
+		a0n += a0[c]*a0[c];
+		amn += am[c]*am[c];
+	}
+
+	const double inv_h2 = inv_h*inv_h;
+
+	kinematic_peaks_t lower;
+	lower.velocity = std::max(v0n, vmn) * inv_h2;
+	lower.acceleration = std::max(a0n, amn) * inv_h2*inv_h2;
+	lower.yaw_rate = std::max( std::fabs(v0[CHANNEL_YAW]), std::fabs(vm[CHANNEL_YAW]) ) * inv_h;
+
+	return lower;
+}
+
+//Exact peaks of a segment, only finding the turning points of each peak
+//that is asked for (the others are left as zero)
+template<typename Scalar>
+static kinematic_peaks_t _segment_peaks( const basic_packed_quintic_segment_t<Scalar>& s, const double inv_h,
+										 const bool velocity, const bool acceleration, const bool yaw_rate ) {
+	kinematic_peaks_t peaks = {0.0, 0.0, 0.0};
+
+	//Derivative polynomials (normalised time) for all channels at once
+	//v = a2 + 2a3*u + ...; a = 2a3 + 6a4*u + ...; j = 6a4 + 24a5*u + ...
+	double v[5][packed_channels];
+	double a[4][packed_channels];
+	double j[3][packed_channels];
+
+	for(size_t c = 0; c < packed_channels; c++) {
+		v[0][c] = s.a[1][c];
+		v[1][c] = 2.0*s.a[2][c];
+		v[2][c] = 3.0*s.a[3][c];
+		v[3][c] = 4.0*s.a[4][c];
+		v[4][c] = 5.0*s.a[5][c];
+
+		a[0][c] = 2.0*s.a[2][c];
+		a[1][c] = 6.0*s.a[3][c];
+		a[2][c] = 12.0*s.a[4][c];
+		a[3][c] = 20.0*s.a[5][c];
+
+		j[0][c] = 6.0*s.a[3][c];
+		j[1][c] = 24.0*s.a[4][c];
+		j[2][c] = 60.0*s.a[5][c];
+	}
+
+	//d(|v|^2)/2 = v.a (degree 7), and d(|a|^2)/2 = a.j (degree 5)
+	if( velocity ) {
+		double va[8] = {0.0};
+
+		for(size_t c = 0; c < 3; c++) {
+			for(size_t m = 0; m < 5; m++)
+				for(size_t n = 0; n < 4; n++)
+					va[m+n] += v[m][c]*a[n][c];
+		}
+
+		peaks.velocity = std::sqrt( _packed_peak_norm2(v, va, 7) ) * inv_h;
+	}
+
+	if( acceleration ) {
+		double aj[6] = {0.0};
+
+		for(size_t c = 0; c < 3; c++) {
+			for(size_t m = 0; m < 4; m++)
+				for(size_t n = 0; n < 3; n++)
+					aj[m+n] += a[m][c]*j[n][c];
+		}
+
+		peaks.acceleration = std::sqrt( _packed_peak_norm2(a, aj, 5) ) * inv_h*inv_h;
+	}
+
+	//Yaw rate turns where the yaw acceleration is zero
+	if( yaw_rate ) {
+		double yv[5];
+		double ya[4];
+		for(size_t k = 0; k < 5; k++)
+			yv[k] = v[k][CHANNEL_YAW];
+		for(size_t k = 0; k < 4; k++)
+			ya[k] = a[k][CHANNEL_YAW];
+
+		double roots[polynomial_roots_max_degree];
+		const size_t num = polynomial_roots(ya, 3, 0.0, 1.0, roots);
+
+		double rp = std::max( std::fabs(yv[0]), std::fabs( polynomial_eval(yv, 4, 1.0) ) );
+		for(size_t k = 0; k < num; k++)
+			rp = std::max( rp, std::fabs( polynomial_eval(yv, 4, roots[k]) ) );
+
+		peaks.yaw_rate = rp * inv_h;
+	}
+
+	return peaks;
+}
+
+template<typename Scalar>
+kinematic_peaks_t contrail_spline_lib::trajectory_segment_peaks( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const size_t i ) {
+	kinematic_peaks_t peaks = {0.0, 0.0, 0.0};
+
+	if( !trajectory.is_valid() || ( i >= trajectory.get_num_segments() ) )
+		return peaks;
+
+	const double* knots = trajectory.get_knots();
+
+	return _segment_peaks( trajectory.get_segment(i), 1.0 / ( knots[i+1] - knots[i] ), true, true, true );
+}
+
+template<typename Scalar>
+kinematic_peaks_t contrail_spline_lib::trajectory_peaks( const BasicPackedQuinticTrajectory<Scalar>& trajectory ) {
+	//Squared for the velocity and acceleration until the end
+	kinematic_peaks_t peaks = {0.0, 0.0, 0.0};
+
+	if( !trajectory.is_valid() )
+		return peaks;
+
+	const double* knots = trajectory.get_knots();
+	const size_t num_seg = trajectory.get_num_segments();
+
+	//Start from the values at the knots and the middle of each segment
+	for(size_t i = 0; i < num_seg; i++) {
+		const kinematic_peaks_t lower = _segment_samples( trajectory.get_segment(i), 1.0 / ( knots[i+1] - knots[i] ) );
+
+		peaks.velocity = std::max(peaks.velocity, lower.velocity);
+		peaks.acceleration = std::max(peaks.acceleration, lower.acceleration);
+		peaks.yaw_rate = std::max(peaks.yaw_rate, lower.yaw_rate);
+	}
+
+	//Then bound each segment, which only finds the turning points of those
+	//that (after a few halvings) could still go over the peak so far
+	for(size_t first = 0; first < num_seg; first += bound_lanes) {
+		const size_t num = std::min(bound_lanes, num_seg - first);
+
+		//Coefficients of each lane's segment (any spare lanes repeat the last)
+		double p[6][packed_channels][bound_lanes];
+		double inv_h[bound_lanes];
+
+		for(size_t l = 0; l < bound_lanes; l++) {
+			const size_t i = first + std::min(l, num - 1);
+			const basic_packed_quintic_segment_t<Scalar>& s = trajectory.get_segment(i);
+			inv_h[l] = 1.0 / ( knots[i+1] - knots[i] );
+
+			for(size_t k = 1; k < 6; k++) {
+				for(size_t c = 0; c < packed_channels; c++)
+					p[k][c][l] = s.a[k][c];
+			}
+		}
+
+		//Velocity (degree 4) and acceleration (degree 3) in normalised time
+		double v[5][packed_channels][bound_lanes];
+		double a[4][packed_channels][bound_lanes];
+
+		for(size_t k = 0; k < 5; k++) {
+			for(size_t c = 0; c < packed_channels; c++)
+				for(size_t l = 0; l < bound_lanes; l++)
+					v[k][c][l] = _velocity_weights[k]*p[k+1][c][l];
+		}
+
+		for(size_t k = 0; k < 4; k++) {
+			for(size_t c = 0; c < packed_channels; c++)
+				for(size_t l = 0; l < bound_lanes; l++)
+					a[k][c][l] = _acceleration_weights[k]*p[k+2][c][l];
+		}
+
+		//|v|^2 (degree 8) and |a|^2 (degree 6) are bounded as a whole, as
+		//the channels rarely peak together
+		double vv[9][bound_lanes] = {};
+		double aa[7][bound_lanes] = {};
+		double yv[5][bound_lanes];
+
+		//(each cross term appears twice)
+		for(size_t c = 0; c < 3; c++) {
+			for(size_t m = 0; m < 5; m++) {
+				for(size_t l = 0; l < bound_lanes; l++)
+					vv[2*m][l] += v[m][c][l]*v[m][c][l];
+
+				for(size_t n = m + 1; n < 5; n++)
+					for(size_t l = 0; l < bound_lanes; l++)
+						vv[m+n][l] += 2.0*v[m][c][l]*v[n][c][l];
+			}
+
+			for(size_t m = 0; m < 4; m++) {
+				for(size_t l = 0; l < bound_lanes; l++)
+					aa[2*m][l] += a[m][c][l]*a[m][c][l];
+
+				for(size_t n = m + 1; n < 4; n++)
+					for(size_t l = 0; l < bound_lanes; l++)
+						aa[m+n][l] += 2.0*a[m][c][l]*a[n][c][l];
+			}
+		}
+
+		for(size_t l = 0; l < bound_lanes; l++) {
+			const double inv_h2 = inv_h[l]*inv_h[l];
+
+			for(size_t k = 0; k < 9; k++)
+				vv[k][l] *= inv_h2;
+
+			for(size_t k = 0; k < 7; k++)
+				aa[k][l] *= inv_h2*inv_h2;
+
+			for(size_t k = 0; k < 5; k++)
+				yv[k][l] = v[k][CHANNEL_YAW][l]*inv_h[l];
+		}
+
+		_bernstein<8>(vv, _inv_binomial_8);
+		_bernstein<6>(aa, _inv_binomial_6);
+		_bernstein<4>(yv, _inv_binomial_4);
+
+		double yn[5][bound_lanes];
+		for(size_t k = 0; k < 5; k++) {
+			for(size_t l = 0; l < bound_lanes; l++)
+				yn[k][l] = -yv[k][l];
+		}
+
+		double v_max[bound_lanes];
+		double a_max[bound_lanes];
+		double y_max[bound_lanes];
+		double n_max[bound_lanes];
+		_bernstein_max<8>(vv, v_max);
+		_bernstein_max<6>(aa, a_max);
+		_bernstein_max<4>(yv, y_max);
+		_bernstein_max<4>(yn, n_max);
+
+		for(size_t l = 0; l < num; l++) {
+			const bool velocity = !_bernstein_refine_lane<8>(vv, v_max[l], l, peaks.velocity);
+			const bool acceleration = !_bernstein_refine_lane<6>(aa, a_max[l], l, peaks.acceleration);
+			const bool yaw_rate = !( _bernstein_refine_lane<4>(yv, y_max[l], l, peaks.yaw_rate) &&
+									 _bernstein_refine_lane<4>(yn, n_max[l], l, peaks.yaw_rate) );
+
+			if( !( velocity || acceleration || yaw_rate ) )
+				continue;
+
+			const kinematic_peaks_t pk = _segment_peaks(trajectory.get_segment(first + l), inv_h[l], velocity, acceleration, yaw_rate);
+			peaks.velocity = std::max(peaks.velocity, pk.velocity*pk.velocity);
+			peaks.acceleration = std::max(peaks.acceleration, pk.acceleration*pk.acceleration);
+			peaks.yaw_rate = std::max(peaks.yaw_rate, pk.yaw_rate);
+		}
+	}
+
+	peaks.velocity = std::sqrt(peaks.velocity);
+	peaks.acceleration = std::sqrt(peaks.acceleration);
+
+	return peaks;
+}
+
+template kinematic_peaks_t contrail_spline_lib::trajectory_segment_peaks( const BasicPackedQuinticTrajectory<double>& trajectory, const size_t i );
+template kinematic_peaks_t contrail_spline_lib::trajectory_segment_peaks( const BasicPackedQuinticTrajectory<float>& trajectory, const size_t i );
+template kinematic_peaks_t contrail_spline_lib::trajectory_peaks( const BasicPackedQuinticTrajectory<double>& trajectory );
+template kinematic_peaks_t contrail_spline_lib::trajectory_peaks( const BasicPackedQuinticTrajectory<float>& trajectory );
+
+double contrail_spline_lib::trajectory_limit_scale( const kinematic_peaks_t& peaks,
+													const kinematic_peaks_t& limits ) {
+	double k = 1.0;
+
+	if( limits.velocity > 0.0 )
+		k = std::max( k, peaks.velocity / limits.velocity );
+
+	if( limits.acceleration > 0.0 )
+		k = std::max( k, std::sqrt( peaks.acceleration / limits.acceleration ) );
+
+	if( limits.yaw_rate > 0.0 )
+		k = std::max( k, peaks.yaw_rate / limits.yaw_rate );
+
+	return k;
+}
@@ -0,0 +1,151 @@
+#include <contrail_spline_lib/trajectory_sampling.h>
+#include <contrail_spline_lib/packed_quintic_trajectory.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace contrail_spline_lib;
+
+//Deepest that a segment is halved (2^16 samples per segment)
+static const size_t sampling_max_depth = 16;
+//Most samples merged into one line (bounds the merge to linear time)
+static const size_t sampling_max_run = 256;
+//Speeds below this have no meaningful heading
+static const double sampling_min_speed = 1e-6;
+
+//Squared distance from x to the line segment a-b
+static double _chord_dist2( const packed_quintic_point_t& a, const packed_quintic_point_t& b, const packed_quintic_point_t& x ) {
+	double ab[3];
+	double ax[3];
+	double ab2 = 0.0;
+	double abx = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		ab[c] = b.q[c] - a.q[c];
+		ax[c] = x.q[c] - a.q[c];
+		ab2 += ab[c]*ab[c];
+		abx += ab[c]*ax[c];
+	}
+
+	const double s = ( ab2 > 0.0 ) ? std::min( std::max( abx / ab2, 0.0 ), 1.0 ) : 0.0;
+
+	double d2 = 0.0;
+	for(size_t c = 0; c < 3; c++) {
+		const double d = ax[c] - s*ab[c];
+		d2 += d*d;
+	}
+
+	return d2;
+}
+
+//Checks the heading and yaw turn by no more than max_angle from a to b
+static bool _within_angle( const packed_quintic_point_t& a, const packed_quintic_point_t& b, const double cos_max_angle, const double max_angle ) {
+	double va2 = 0.0;
+	double vb2 = 0.0;
+	double vab = 0.0;
+
+	for(size_t c = 0; c < 3; c++) {
+		va2 += a.qd[c]*a.qd[c];
+		vb2 += b.qd[c]*b.qd[c];
+		vab += a.qd[c]*b.qd[c];
+	}
+
+	const double min_v2 = sampling_min_speed*sampling_min_speed;
+	const bool heading = ( va2 < min_v2 ) || ( vb2 < min_v2 ) || ( vab >= cos_max_angle*std::sqrt(va2*vb2) );
+
+	return heading && ( std::fabs(b.q[3] - a.q[3]) <= max_angle );
+}
+
+//Adds the samples over (ta, tb], halving the interval until it is close
+//enough to a straight line
+template<typename Scalar>
+static void _refine( const BasicPackedQuinticTrajectory<Scalar>& trajectory, const sampling_tolerance_t& tolerance,
+					 const double cos_max_angle, const double ta, const packed_quintic_point_t& pa,
+					 const double tb, const packed_quintic_point_t& pb, const size_t depth,
+					 std::vector<double>& times, std::vector<packed_quintic_point_t>& points ) {
+	const double h = tb - ta;
+	const double tm = ta + 0.5*h;
+	const packed_quintic_point_t pm = trajectory.lookup(tm);
+
+	bool split = ( depth < sampling_max_depth ) && ( h >= 2.0*tolerance.min_dt );
+
+	if( split ) {
+		const double tol2 = 0.25*tolerance.tolerance*tolerance.tolerance;
+		const packed_quintic_point_t p1 = trajectory.lookup(ta + 0.25*h);
+		const packed_quintic_point_t p3 = trajectory.lookup(ta + 0.75*h);
+
+		split = ( _chord_dist2(pa, pb, p1) > tol2 ) ||
+				( _chord_dist2(pa, pb, pm) > tol2 ) ||
+				( _chord_dist2(pa, pb, p3) > tol2 ) ||
+				!_within_angle(pa, pm, cos_max_angle, tolerance.max_angle) ||
+				!_within_angle(pm, pb, cos_max_angle, tolerance.max_angle);
+	}
+
+	if( split ) {
+		_refine(trajectory, tolerance, cos_max_angle, ta, pa, tm, pm, depth + 1, times, points);
+		_refine(trajectory, tolerance, cos_max_angle, tm, pm, tb, pb, depth + 1, times, points);
+	} else {
+		times.push_back(tb);
+		points.push_back(pb);
+	}
+}
+
+template<typename Scalar>
+void contrail_spline_lib::adaptive_sample( const BasicPackedQuinticTrajectory<Scalar>& trajectory,
+										   const sampling_tolerance_t& tolerance,
+										   std::vector<double>& times,
+										   std::vector<packed_quintic_point_t>& points ) {
+	times.clear();
+	points.clear();
+
+	if( !trajectory.is_valid() )
+		return;
+
+	const double cos_max_angle = std::cos( std::min( tolerance.max_angle, M_PI ) );
+	const double* knots = trajectory.get_knots();
+
+	//Refine each segment (a quintic can't be relied on to be straight
+	//across a knot, so the knots are always sampled at first)
+	times.push_back(knots[0]);
+	points.push_back( trajectory.lookup(knots[0]) );
+
+	for(size_t i = 0; i < trajectory.get_num_segments(); i++) {
+		const packed_quintic_point_t pa = points.back();
+		_refine(trajectory, tolerance, cos_max_angle, knots[i], pa, knots[i+1], trajectory.lookup(knots[i+1]), 0, times, points);
+	}
+
+	//Merge runs of samples that stay close to the line between their ends,
+	//compacting the samples in place
+	const double tol2 = 0.25*tolerance.tolerance*tolerance.tolerance;
+	const size_t n = times.size();
+	size_t kept = 1;
+	size_t a = 0;
+
+	for(size_t j = 2; j <= n; j++) {
+		//Sample j - 1 can be dropped if every sample from a to j stays close
+		//to the line from a to j
+		bool merge = ( j < n ) && ( ( j - a ) <= sampling_max_run ) && _within_angle(points[a], points[j], cos_max_angle, tolerance.max_angle);
+		for(size_t k = a + 1; merge && ( k < j ); k++)
+			merge = ( _chord_dist2(points[a], points[j], points[k]) <= tol2 );
+
+		if( !merge ) {
+			//Keep sample j - 1, and start the next run from it
+			a = j - 1;
+			times[kept] = times[a];
+			points[kept] = points[a];
+			kept++;
+		}
+	}
+
+	times.resize(kept);
+	points.resize(kept);
+}
+
+template void contrail_spline_lib::adaptive_sample( const BasicPackedQuinticTrajectory<double>& trajectory,
+													 const sampling_tolerance_t& tolerance,
+													 std::vector<double>& times,
+													 std::vector<packed_quintic_point_t>& points );
+template void contrail_spline_lib::adaptive_sample( const BasicPackedQuinticTrajectory<float>& trajectory,
+													 const sampling_tolerance_t& tolerance,
+													 std::vector<double>& times,
+													 std::vector<packed_quintic_point_t>& points );
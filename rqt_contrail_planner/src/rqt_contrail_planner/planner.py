@@ -3,6 +3,7 @@ import math
 import rospkg
 import rospy
 import yaml
+import numpy
 
 # Qt ROS binding for GUI
 from qt_gui.plugin import Plugin
@@ -342,31 +343,31 @@ class Planner(Plugin):
 					psid = [i/d for i in iqs_psi.get_dvias()]
 					psidd = [i/d2 for i in iqs_psi.get_ddvias()]
 
+					# Each lookup gives an (ni,3) array of [q, qd, qdd]
 					ni = n*self.num_interp
-					ui = [float(i) / (ni-1) for i in range(ni)]
-					xvi = [iqs_x.lookup(u) for u in ui]
-					yvi = [iqs_y.lookup(u) for u in ui]
-					zvi = [iqs_z.lookup(u) for u in ui]
-					psivi = [iqs_psi.lookup(u) for u in ui]
-
-					xi = [i[0] for i in xvi]
-					xdi = [i[1]/d for i in xvi]
-					xddi = [i[2]/d2 for i in xvi]
-
-					yi = [i[0] for i in yvi]
-					ydi = [i[1]/d for i in yvi]
-					yddi = [i[2]/d2 for i in yvi]
-
-					zi = [i[0] for i in zvi]
-					zdi = [i[1]/d for i in zvi]
-					zddi = [i[2]/d2 for i in zvi]
-
-					psii = [i[0] for i in psivi]
-					psidi = [i[1]/d for i in psivi]
-					psiddi = [i[2]/d2 for i in psivi]
-
-					dti = d / (ni-1)
-					ti = [dti * i for i in range(ni)]
+					ui = numpy.linspace(0.0, 1.0, ni)
+					xvi = iqs_x.lookup_many(ui)
+					yvi = iqs_y.lookup_many(ui)
+					zvi = iqs_z.lookup_many(ui)
+					psivi = iqs_psi.lookup_many(ui)
+
+					xi = xvi[:,0]
+					xdi = xvi[:,1] / d
+					xddi = xvi[:,2] / d2
+
+					yi = yvi[:,0]
+					ydi = yvi[:,1] / d
+					yddi = yvi[:,2] / d2
+
+					zi = zvi[:,0]
+					zdi = zvi[:,1] / d
+					zddi = zvi[:,2] / d2
+
+					psii = psivi[:,0]
+					psidi = psivi[:,1] / d
+					psiddi = psivi[:,2] / d2
+
+					ti = ui * d
 				else:
 					rospy.logerr("Could not interpolate spline!")
 